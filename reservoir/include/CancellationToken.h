@@ -0,0 +1,83 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+
+/**
+ * \file CancellationToken.h
+ * \brief defines CancellationToken
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#ifndef CANCELLATIONTOKEN_H
+#define CANCELLATIONTOKEN_H
+
+#include <QAtomicInt>
+
+/**
+ * @brief The CancellationToken class
+ * Stop request of a computation, set by any thread and polled without lock by the computing loops.
+ */
+class CancellationToken
+{
+    public :
+
+        /**
+         * @brief CancellationToken constructor
+         */
+        CancellationToken() : m_cancelled(0)
+        {}
+
+        /**
+         * @brief cancel : request the stop of the computations using the token
+         */
+        void cancel()
+        {
+            m_cancelled.fetchAndStoreOrdered(1);
+        }
+
+        /**
+         * @brief reset : cancel a stop request
+         */
+        void reset()
+        {
+            m_cancelled.fetchAndStoreOrdered(0);
+        }
+
+        /**
+         * @brief isCancelled
+         * @return true if a stop has been requested
+         */
+        bool isCancelled() const
+        {
+            return m_cancelled != 0;
+        }
+
+    private :
+
+        CancellationToken(const CancellationToken &);
+        CancellationToken &operator=(const CancellationToken &);
+
+        QAtomicInt m_cancelled;     /**< 1 if a stop has been requested */
+};
+
+#endif // CANCELLATIONTOKEN_H
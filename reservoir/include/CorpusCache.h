@@ -0,0 +1,171 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+/**
+ * \file CorpusCache.h
+ * \brief defines CompiledCorpus and CorpusCache
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#ifndef CORPUSCACHE_H
+#define CORPUSCACHE_H
+
+#include "CorpusProcessing.h"
+
+/**
+ * @brief Parts of a corpus file, in the order of the outputs of extractAllDataFromCorpusFile
+ */
+enum CorpusPart
+{
+    CORPUS_TRAIN_DATA = 0, CORPUS_TRAIN_INFO, CORPUS_TRAIN_MEANING, CORPUS_TEST_DATA, CORPUS_TEST_INFO, CORPUS_TEST_MEANING, CORPUS_PARTS_NB
+};
+
+/**
+ * @brief Tokenized corpus : the words of all the parts are interned in one vocabulary
+ */
+struct CompiledCorpus
+{
+    Vocabulary m_vocabulary;                        /**< words of the corpus */
+    TokenizedSentences m_parts[CORPUS_PARTS_NB];    /**< lines of each part, one sentence per line */
+    quint64 m_contentHash;                          /**< FNV-1a hash of the corpus text file */
+    qint64 m_sourceTime;                            /**< modification time of the text file (ms since epoch) */
+    qint64 m_sourceSize;                            /**< size of the text file */
+};
+
+/**
+ * @brief State of a corpus text file when it was last read by the cache
+ */
+struct CorpusSource
+{
+    quint64 m_contentHash;                          /**< hash of the text, key of its compiled corpus */
+    qint64 m_sourceTime;                            /**< modification time of the text file (ms since epoch) */
+    qint64 m_sourceSize;                            /**< size of the text file */
+};
+
+/**
+ * @brief compileCorpus : parse a corpus text file and tokenize it
+ * @param [in] pathFileCorpus
+ * @param [out] corpus
+ * @return false if the file can't be read
+ */
+bool compileCorpus(const QString &pathFileCorpus, CompiledCorpus &corpus);
+
+/**
+ * @brief saveCompiledCorpus : binary format made of flat arrays, loaded without any parsing
+ * @param [in] pathFile
+ * @param [in] corpus
+ * @return false if the file can't be written
+ */
+bool saveCompiledCorpus(const QString &pathFile, const CompiledCorpus &corpus);
+
+/**
+ * @brief loadCompiledCorpus : the file is mapped in memory and its arrays are copied
+ * @param [in] pathFile
+ * @param [out] corpus
+ * @return false if the file can't be read, is not a compiled corpus or has offsets / ids out of its arrays
+ */
+bool loadCompiledCorpus(const QString &pathFile, CompiledCorpus &corpus);
+
+/**
+ * @brief The CorpusCache class
+ * Compiled corpora of the process, keyed on the hash of the content of the text files : the copies of a same corpus (e.g. the corpus file
+ * of each yarp job) share one entry. A corpus is parsed at most once per process : it's then retrieved from memory, or from its compiled
+ * file (text path + ".compiled") for the next processes. Only the most recently used corpora are kept and the paths of the removed files are forgotten.
+ */
+class CorpusCache
+{
+    public :
+
+        /**
+         * @brief CorpusCache destructor
+         */
+        ~CorpusCache();
+
+        /**
+         * @brief instance
+         * @return cache shared by the whole process
+         */
+        static CorpusCache *instance();
+
+        /**
+         * @brief sentences : retrieve a part of a corpus
+         * @param [in] pathFileCorpus
+         * @param [in] part
+         * @param [out] sentences
+         * @return false if the corpus can't be read
+         */
+        bool sentences(const QString &pathFileCorpus, const CorpusPart part, Sentences &sentences);
+
+        /**
+         * @brief sentences : Qt version, the lines are appended as extractAllDataFromCorpusFile does
+         * @param [in] pathFileCorpus
+         * @param [in] part
+         * @param [out] sentences
+         * @return false if the corpus can't be read
+         */
+        bool sentences(const QString &pathFileCorpus, const CorpusPart part, QVector<QStringList> &sentences);
+
+        /**
+         * @brief tokens : retrieve a part of a corpus without converting its words
+         * @param [in] pathFileCorpus
+         * @param [in] part
+         * @param [out] vocabulary : words of the corpus, the ids of the tokens
+         * @param [out] tokens
+         * @return false if the corpus can't be read
+         */
+        bool tokens(const QString &pathFileCorpus, const CorpusPart part, Vocabulary &vocabulary, TokenizedSentences &tokens);
+
+        /**
+         * @brief contentHash
+         * @param [in] pathFileCorpus
+         * @return hash of the corpus text, 0 if it can't be read
+         */
+        quint64 contentHash(const QString &pathFileCorpus);
+
+        /**
+         * @brief forget : the next read of the file hashes its text again, must be called after rewriting a corpus file
+         * @param [in] pathFileCorpus
+         */
+        void forget(const QString &pathFileCorpus);
+
+    private :
+
+        /**
+         * @brief corpus : entry of a file, compiled or loaded if needed, must be called with m_lock locked
+         * @param [in] pathFileCorpus
+         * @return NULL if the corpus can't be read, the pointer is valid until the next call
+         */
+        const CompiledCorpus *corpus(const QString &pathFileCorpus);
+
+        /**
+         * @brief evict : forget the paths whose file has been removed and delete the least recently used corpora over the bound
+         */
+        void evict();
+
+        QMutex m_lock;                              /**< protects the entries */
+        QHash<QString, CorpusSource> m_sources;     /**< content of each absolute path when it was last read */
+        QHash<quint64, CompiledCorpus*> m_corpora;  /**< corpora keyed on the hash of their text */
+        QList<quint64> m_recentCorpora;             /**< hashes of the corpora, from the least to the most recently used */
+};
+
+#endif // CORPUSCACHE_H
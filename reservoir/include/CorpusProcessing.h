@@ -31,6 +31,13 @@
 #define CORPUSPROCESSING_H
 
 #include "Utility.h"
+#include "Vocabulary.h"
+#include "TaskScheduler.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define CORPUS_PROCESSING_SSE2
+#endif
 
 
 /**
@@ -549,48 +556,236 @@ static void convertOneOutputActivityInConstruction(cv::Mat &outAct, const Senten
     }
 }
 
+template<typename T>
 /**
- * @brief convertLOutputActivityInConstruction
+ * @brief outputActivityIdxMax : same signal as convertOutputActivityInSignalIdxMax computed in one pass on the rows, the activity is not modified
+ * @param [in] outAct       : [timesteps x dimOutput] contiguous rows
+ * @param [in] nbSteps
+ * @param [in] dimOutput
+ * @param [out] indices     : for each timestep the index of the max activity above thres, -1 if none, -2 if the max is reached several times
+ * @param [in] thres
+ * @param [in] eps
  */
-static void convertLOutputActivityInConstruction(cv::Mat &outAct, const Sentence &constructionWords, Sentences &sent, cint minNbValUpperThres = 1)
+static void outputActivityIdxMax(const T *outAct, cint nbSteps, cint dimOutput, int *indices, const T thres, const T eps)
 {
-    sent.clear();
-
-    for(int ii = 0; ii < outAct.size[0]; ++ii)
+    for(int ii = 0; ii < nbSteps; ++ii)
     {
-        Sentence l_sent;
-        cv::Mat l_subOutAct;
+        const T *l_row = outAct + ii * dimOutput;
+
+        T l_max = static_cast<T>(0);
+        for(int jj = 0; jj < dimOutput; ++jj)
+        {
+            if(l_row[jj] >= thres && l_row[jj] > l_max)
+            {
+                l_max = l_row[jj];
+            }
+        }
+
+        indices[ii] = -1;
+        if(l_max < eps)
+        {
+            continue;
+        }
 
-        if(outAct.depth() == CV_32FC1)
+        for(int jj = 0; jj < dimOutput; ++jj)
         {
-            l_subOutAct = cv::Mat(outAct.size[1], outAct.size[2], CV_32FC1);
-            for(int jj = 0; jj < outAct.size[1]; ++jj)
+            if(l_row[jj] == l_max)
+            {
+                if(indices[ii] >= 0)
+                {
+                    indices[ii] = -2;
+                    break;
+                }
+                indices[ii] = jj;
+            }
+        }
+    }
+}
+
+#ifdef CORPUS_PROCESSING_SSE2
+/**
+ * @brief outputActivityIdxMax : float version, the thresholded max of each row is computed 4 values at a time with SSE2
+ */
+static void outputActivityIdxMax(const float *outAct, cint nbSteps, cint dimOutput, int *indices, const float thres, const float eps)
+{
+    __m128 l_thres = _mm_set1_ps(thres);
+
+    for(int ii = 0; ii < nbSteps; ++ii)
+    {
+        const float *l_row = outAct + ii * dimOutput;
+
+        // values under the threshold are masked to 0
+            __m128 l_max4 = _mm_setzero_ps();
+            int jj = 0;
+            for(; jj + 4 <= dimOutput; jj += 4)
+            {
+                __m128 l_values = _mm_loadu_ps(l_row + jj);
+                l_max4 = _mm_max_ps(l_max4, _mm_and_ps(l_values, _mm_cmpge_ps(l_values, l_thres)));
+            }
+
+            l_max4 = _mm_max_ps(l_max4, _mm_shuffle_ps(l_max4, l_max4, _MM_SHUFFLE(1,0,3,2)));
+            l_max4 = _mm_max_ps(l_max4, _mm_shuffle_ps(l_max4, l_max4, _MM_SHUFFLE(2,3,0,1)));
+            float l_max = _mm_cvtss_f32(l_max4);
+
+            for(; jj < dimOutput; ++jj)
             {
-                for(int kk = 0; kk < outAct.size[2]; ++kk)
+                if(l_row[jj] >= thres && l_row[jj] > l_max)
                 {
-                    l_subOutAct.at<float>(jj,kk) = outAct.at<float>(ii,jj,kk);
+                    l_max = l_row[jj];
                 }
             }
 
-            convertOneOutputActivityInConstruction<float>(l_subOutAct, constructionWords, l_sent, minNbValUpperThres);
+        indices[ii] = -1;
+        if(l_max < eps)
+        {
+            continue;
         }
-        else
+
+        // first location of the max and tie detection
+            for(jj = 0; jj < dimOutput; ++jj)
+            {
+                if(l_row[jj] == l_max)
+                {
+                    if(indices[ii] >= 0)
+                    {
+                        indices[ii] = -2;
+                        break;
+                    }
+                    indices[ii] = jj;
+                }
+            }
+    }
+}
+#endif
+
+/**
+ * @brief signalIndicesToWordIds : keep the indices of a signal which last at least minNbValUpperThres timesteps, as convertOneOutputActivityInConstruction
+ * @param [in] indices
+ * @param [in] nbSteps
+ * @param [out] wordIds : indices of the construction words, the ambiguous timesteps (-2) are skipped
+ * @param [in] minNbValUpperThres
+ */
+static void signalIndicesToWordIds(const int *indices, cint nbSteps, std::vector<int> &wordIds, cint minNbValUpperThres = 1)
+{
+    int l_previous = -1;
+    int l_keepInMemory = -1;
+    int l_nbOccurrenceSameIndex = 0;
+    wordIds.clear();
+
+    for(int ii = 0; ii < nbSteps; ++ii)
+    {
+        if(indices[ii] != l_previous)
         {
-            l_subOutAct = cv::Mat(outAct.size[1], outAct.size[2], CV_64FC1);
+            if(indices[ii] == l_keepInMemory)
+            {
+                ++l_nbOccurrenceSameIndex;
+            }
 
-            for(int jj = 0; jj < outAct.size[1]; ++jj)
+            if(minNbValUpperThres - 1 - l_nbOccurrenceSameIndex > 0)
+            {
+                l_keepInMemory = indices[ii];
+            }
+            else
             {
-                for(int kk = 0; kk < outAct.size[2]; ++kk)
+                if(indices[ii] >= 0)
                 {
-                    l_subOutAct.at<double>(jj,kk) = outAct.at<double>(ii,jj,kk);
+                    wordIds.push_back(indices[ii]);
                 }
+
+                l_previous = indices[ii];
+                l_nbOccurrenceSameIndex = 0;
+                l_keepInMemory = -1;
             }
+        }
+    }
+}
+
+/**
+ * @brief Decode the construction word ids of a range of sentences directly in the output tensor
+ */
+class DecodeOutputTask : public SentenceTask
+{
+    public :
+
+        DecodeOutputTask(const cv::Mat &outAct, std::vector<std::vector<int> > &wordIds, cint minNbValUpperThres) :
+            m_outAct(outAct), m_wordIds(wordIds), m_minNbValUpperThres(minNbValUpperThres)
+        {}
+
+        void run(cint begin, cint end)
+        {
+            int l_nbSteps = m_outAct.size[1], l_dimOutput = m_outAct.size[2];
+            if(l_nbSteps == 0)
+            {
+                return;
+            }
+
+            std::vector<int> l_indices(l_nbSteps);
+            for(int ii = begin; ii < end; ++ii)
+            {
+                if(m_outAct.depth() == CV_32F)
+                {
+                    outputActivityIdxMax(reinterpret_cast<const float*>(m_outAct.data + m_outAct.step[0] * ii), l_nbSteps, l_dimOutput, &l_indices[0], 0.4f, 1e-12f);
+                }
+                else
+                {
+                    outputActivityIdxMax<double>(reinterpret_cast<const double*>(m_outAct.data + m_outAct.step[0] * ii), l_nbSteps, l_dimOutput, &l_indices[0], 0.4, 1e-12);
+                }
 
-            convertOneOutputActivityInConstruction<double>(l_subOutAct, constructionWords, l_sent, minNbValUpperThres);
+                signalIndicesToWordIds(&l_indices[0], l_nbSteps, m_wordIds[ii], m_minNbValUpperThres);
+            }
         }
 
+    private :
 
-        sent.push_back(l_sent);
+        const cv::Mat &m_outAct;
+        std::vector<std::vector<int> > &m_wordIds;
+        int m_minNbValUpperThres;
+};
+
+/**
+ * @brief decodeOutputActivity : construction word ids of all the sentences, decoded in parallel (thread budget of the calling thread) directly in the output tensor
+ * @param [in] outAct   : [sentences x timesteps x dimOutput] (CV_32FC1 or CV_64FC1)
+ * @param [out] wordIds : ids of the construction words of each sentence
+ * @param [in] minNbValUpperThres
+ */
+static void decodeOutputActivity(const cv::Mat &outAct, std::vector<std::vector<int> > &wordIds, cint minNbValUpperThres = 1)
+{
+    if(outAct.dims != 3)
+    {
+        wordIds.clear();
+        return;
+    }
+
+    wordIds.assign(outAct.size[0], std::vector<int>());
+
+    DecodeOutputTask l_task(outAct, wordIds, minNbValUpperThres);
+    TaskScheduler::instance()->parallelFor(l_task, outAct.size[0]);
+}
+
+/**
+ * @brief convertLOutputActivityInConstruction : the word ids are decoded with decodeOutputActivity and only mapped to the words at the end
+ */
+static void convertLOutputActivityInConstruction(cv::Mat &outAct, const Sentence &constructionWords, Sentences &sent, cint minNbValUpperThres = 1)
+{
+    sent.clear();
+
+    if(outAct.dims != 3)
+    {
+        return;
+    }
+
+    cv::Mat l_outAct = outAct.isContinuous() ? outAct : outAct.clone();
+
+    std::vector<std::vector<int> > l_wordIds;
+    decodeOutputActivity(l_outAct, l_wordIds, minNbValUpperThres);
+
+    sent.resize(l_wordIds.size());
+    for(size_t ii = 0; ii < l_wordIds.size(); ++ii)
+    {
+        for(size_t jj = 0; jj < l_wordIds[ii].size(); ++jj)
+        {
+            sent[ii].push_back(constructionWords[l_wordIds[ii][jj]]);
+        }
     }
 }
 
@@ -658,6 +853,40 @@ static void attributeOcwToConstructions(const Sentences &constructions, const Se
     }
 }
 
+/**
+ * @brief attributeOcwToConstructions : ids version, each OCW id of a construction is replaced by the next OCW of its sentence
+ * @param [in] constructions
+ * @param [in] OCW
+ * @param [in] ocwId  : id of the OCW placeholder, also used when a sentence has less OCW than the construction
+ * @param [out] sent
+ */
+static void attributeOcwToConstructions(const TokenizedSentences &constructions, const TokenizedSentences &OCW, cint ocwId, TokenizedSentences &sent)
+{
+    sent.clear();
+    sent.m_tokens.reserve(constructions.m_tokens.size());
+
+    for(int ii = 0; ii < constructions.nbSentences(); ++ii)
+    {
+        const int *l_construction = constructions.words(ii), *l_ocw = OCW.words(ii);
+        int l_nbOCW = OCW.length(ii);
+
+        int l_offset = 0;
+        for(int jj = 0; jj < constructions.length(ii); ++jj)
+        {
+            if(l_construction[jj] == ocwId)
+            {
+                sent.m_tokens.push_back(l_offset < l_nbOCW ? l_ocw[l_offset] : ocwId);
+                ++l_offset;
+            }
+            else
+            {
+                sent.m_tokens.push_back(l_construction[jj]);
+            }
+        }
+        sent.m_offsets.push_back(static_cast<int>(sent.m_tokens.size()));
+    }
+}
+
 /**
  * @brief convertLineCorpusInfo
  */
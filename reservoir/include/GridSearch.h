@@ -134,6 +134,17 @@ class GridSearch : public QObject
          */
         bool setParameterValues(const ReservoirParameter parameterId, cdouble startValue, cdouble endValue, const std::string operation = "*2", cbool useOnlyStartValue = false, cint nbOfTimesForEachValues = 1);
 
+        /**
+         * @brief Compute the values of a range by applying the operation from the start value until the end value.
+         * @param [in] startValue        : the starting value
+         * @param [in] endValue          : the ending value
+         * @param [in] operation         : operator to apply to the value : ex "+2" "*5.1" -"2.3"
+         * @param [in] useOnlyStartValue : uses only the start value
+         * @param [out] values           : values of the range
+         * @return false if the operation doesn't reach the end value
+         */
+        static bool rangeValues(cdouble startValue, cdouble endValue, const std::string &operation, cbool useOnlyStartValue, std::vector<double> &values);
+
         /**
          * @brief deleteParameterValues
          */
@@ -177,7 +188,7 @@ class GridSearch : public QObject
          * @param operation  : operation to be applied on the value
          * @return the result
          */
-        T applyOperation(const T value, const std::string operation)
+        static T applyOperation(const T value, const std::string operation)
         {
             std::string l_number = operation;
             l_number.erase(0,1);
@@ -291,6 +291,7 @@ class InterfaceWorker : public QObject
     private :
 
         cv::Mat m_xTot; /**< loaded x tot matrice for the replay */
+        ReplayStore m_replayStore; /**< loaded tiled replay file, used instead of m_xTot when opened */
 
         int m_nbOfCorpus;                       /**< number of corpus loaded */
 
@@ -0,0 +1,196 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+
+/**
+ * \file LinearAlgebra.h
+ * \brief defines the linear algebra backends used by the reservoir
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#ifndef LINEARALGEBRA_H
+#define LINEARALGEBRA_H
+
+#include "Utility.h"
+#include "gpuMat/configCuda.h"
+#include "CancellationToken.h"
+
+/**
+ * @brief The LinearAlgebraBackend class
+ * Heavy linear algebra of the reservoir (the readout solve), the backend is selected at runtime with instance().
+ * The matrices are row-major cv::Mat (CV_32FC1, CV_64FC1 is managed by the OpenCV backend).
+ */
+class LinearAlgebraBackend
+{
+    public :
+
+        /**
+         * @brief Available backends
+         */
+        enum Type
+        {
+            OPENCV,     /**< OpenCV operators, always available */
+            LAPACK,     /**< multithreaded panels products and CLAPACK factorizations */
+            CUDA        /**< CUDA block products and CULA SVD, only if built with USE_CUDA, else LAPACK is used */
+        };
+
+        virtual ~LinearAlgebraBackend(){}
+
+        /**
+         * @brief instance
+         * @param [in] type
+         * @return backend shared by the whole process
+         */
+        static LinearAlgebraBackend *instance(const Type type);
+
+        /**
+         * @brief initThread : must be called by each thread using the CUDA backend before its first use
+         */
+        static void initThread();
+
+        /**
+         * @brief releaseThread : must be called by the threads which called initThread before their end
+         */
+        static void releaseThread();
+
+        /**
+         * @brief name
+         * @return name of the backend
+         */
+        virtual QString name() const = 0;
+
+        /**
+         * @brief gemm : res = op(A) * op(B)
+         * @param [in] A
+         * @param [in] B
+         * @param [out] res      : the OpenCV and LAPACK backends keep its buffer if it already has the size and the type of the product
+         * @param [in] flags    : cv::GEMM_1_T / cv::GEMM_2_T for using the transposes
+         * @param [in] cancel   : if not NULL, checked during the product
+         * @return false if the product has been cancelled or has failed
+         */
+        virtual bool gemm(const cv::Mat &A, const cv::Mat &B, cv::Mat &res, cint flags = 0, const CancellationToken *cancel = NULL) = 0;
+
+        /**
+         * @brief syrk : res = A * A^T
+         * @param [in] A
+         * @param [out] res
+         * @param [in] cancel
+         * @param [in] mirror : copy the lower triangle in the upper one, if false only the lower triangle is valid
+         *                      (the backends computing the whole matrix ignore it)
+         * @return false if the product has been cancelled or has failed
+         */
+        virtual bool syrk(const cv::Mat &A, cv::Mat &res, const CancellationToken *cancel = NULL, cbool mirror = true) = 0;
+
+        /**
+         * @brief svd : M = U * diag(S) * VT
+         * @param [in] M        : [m x n]
+         * @param [out] S       : [min(m,n) x 1], decreasing singular values
+         * @param [out] U       : [m x m]
+         * @param [out] VT      : [n x n]
+         * @return false if the decomposition has failed
+         */
+        virtual bool svd(const cv::Mat &M, cv::Mat &S, cv::Mat &U, cv::Mat &VT) = 0;
+
+        /**
+         * @brief cholesky : solve A * X = B with a Cholesky factorization of A
+         * @param [in] A    : symmetric positive definite [n x n]
+         * @param [in] B    : [n x nrhs]
+         * @param [out] X   : [n x nrhs]
+         * @return false if A is not positive definite
+         */
+        virtual bool cholesky(const cv::Mat &A, const cv::Mat &B, cv::Mat &X) = 0;
+
+        /**
+         * @brief eigen : eigendecomposition of a symmetric matrix
+         * @param [in] A                : symmetric [n x n]
+         * @param [out] eigenValues     : [n x 1], decreasing order
+         * @param [out] eigenVectors    : [n x n], one eigenvector per row
+         * @return false if the decomposition has failed
+         */
+        virtual bool eigen(const cv::Mat &A, cv::Mat &eigenValues, cv::Mat &eigenVectors) = 0;
+};
+
+/**
+ * @brief The OpenCVBackend class
+ */
+class OpenCVBackend : public LinearAlgebraBackend
+{
+    public :
+
+        QString name() const;
+        bool gemm(const cv::Mat &A, const cv::Mat &B, cv::Mat &res, cint flags = 0, const CancellationToken *cancel = NULL);
+        bool syrk(const cv::Mat &A, cv::Mat &res, const CancellationToken *cancel = NULL, cbool mirror = true);
+        bool svd(const cv::Mat &M, cv::Mat &S, cv::Mat &U, cv::Mat &VT);
+        bool cholesky(const cv::Mat &A, const cv::Mat &B, cv::Mat &X);
+        bool eigen(const cv::Mat &A, cv::Mat &eigenValues, cv::Mat &eigenVectors);
+};
+
+/**
+ * @brief The LapackBackend class
+ * The products are cut in panels of rows computed in parallel by the TaskScheduler within the thread budget of the calling thread,
+ * syrk only computes the tiles of the lower triangle,
+ * the factorizations are done by CLAPACK.
+ * The f2c CLAPACK is not reentrant : its calls are serialized.
+ * The matrices which are not CV_32FC1 are sent to the OpenCV backend.
+ */
+class LapackBackend : public LinearAlgebraBackend
+{
+    public :
+
+        QString name() const;
+        bool gemm(const cv::Mat &A, const cv::Mat &B, cv::Mat &res, cint flags = 0, const CancellationToken *cancel = NULL);
+        bool syrk(const cv::Mat &A, cv::Mat &res, const CancellationToken *cancel = NULL, cbool mirror = true);
+        bool svd(const cv::Mat &M, cv::Mat &S, cv::Mat &U, cv::Mat &VT);
+        bool cholesky(const cv::Mat &A, const cv::Mat &B, cv::Mat &X);
+        bool eigen(const cv::Mat &A, cv::Mat &eigenValues, cv::Mat &eigenVectors);
+
+    private :
+
+        OpenCVBackend m_fallback;   /**< backend used for the types not managed */
+};
+
+#ifdef USE_CUDA
+
+/**
+ * @brief The CudaBackend class
+ * Block products with CUDA and SVD of the square matrices with CULA, the other operations are done by the LAPACK backend.
+ */
+class CudaBackend : public LinearAlgebraBackend
+{
+    public :
+
+        QString name() const;
+        bool gemm(const cv::Mat &A, const cv::Mat &B, cv::Mat &res, cint flags = 0, const CancellationToken *cancel = NULL);
+        bool syrk(const cv::Mat &A, cv::Mat &res, const CancellationToken *cancel = NULL, cbool mirror = true);
+        bool svd(const cv::Mat &M, cv::Mat &S, cv::Mat &U, cv::Mat &VT);
+        bool cholesky(const cv::Mat &A, const cv::Mat &B, cv::Mat &X);
+        bool eigen(const cv::Mat &A, cv::Mat &eigenValues, cv::Mat &eigenVectors);
+
+    private :
+
+        LapackBackend m_fallback;   /**< backend used for the operations not done on the GPU */
+};
+
+#endif
+
+#endif // LINEARALGEBRA_H
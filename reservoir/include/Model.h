@@ -31,6 +31,9 @@
 
 #include "Reservoir.h"
 #include "CorpusProcessing.h"
+#include "CorpusCache.h"
+#include "NpyIO.h"
+#include "ReplayStore.h"
 
 
 /**
@@ -164,6 +167,12 @@ class Model : public QObject
          */
         void setCCWAndStructure(const Sentence &CCW, const Sentence &structure);
 
+        /**
+         * @brief setStimulusDirectory
+         * @param [in] directory : directory where the python script writes the stimulus files (default : ../data/input/)
+         */
+        void setStimulusDirectory(const std::string &directory);
+
         /**
          * @brief launchTraining
          * @return
@@ -183,7 +192,21 @@ class Model : public QObject
          * @param trainResults
          * @param testResults
          */
-        void sentences(Sentences &trainSentences, Sentences &trainResults, Sentences &testResults);
+        void sentences(Sentences &trainSentences, Sentences &trainResults, Sentences &testResults) const;
+
+        /**
+         * @brief tokenizedSentences : sentences() as ids of vocabulary()
+         * @param [out] trainSentences
+         * @param [out] trainResults
+         * @param [out] testResults
+         */
+        void tokenizedSentences(TokenizedSentences &trainSentences, TokenizedSentences &trainResults, TokenizedSentences &testResults) const;
+
+        /**
+         * @brief vocabulary : words of the corpus (same ids as in the corpus cache), followed by the closed class words and the words of the results
+         * @return
+         */
+        const Vocabulary &vocabulary() const;
 
         /**
          * @brief displayResults
@@ -223,14 +246,16 @@ class Model : public QObject
         /**
          * @brief saveTraining
          * @param pathDirectory
+         * @return false if the training can't be saved
          */
-        void saveTraining(const std::string &pathDirectory);
+        bool saveTraining(const std::string &pathDirectory);
 
         /**
          * @brief saveReplay
          * @param pathDirectory
+         * @return false if the replay file can't be written
          */
-        void saveReplay(const std::string &pathDirectory);
+        bool saveReplay(const std::string &pathDirectory);
 
         /**
          * @brief loadTraining
@@ -250,6 +275,43 @@ class Model : public QObject
          */
         void loadWIn(const std::string &pathDirectory);
 
+        /**
+         * @brief setTraining : use matrices already in memory as the current training, no file is read and the data is not copied
+         * @param [in] w
+         * @param [in] wIn
+         * @param [in] wOut
+         */
+        void setTraining(const cv::Mat &w, const cv::Mat &wIn, const cv::Mat &wOut);
+
+        /**
+         * @brief setSketchRank : rank of the randomized subspace used by an approximate readout
+         * @param [in] rank : if <= 0 the readout is exact
+         */
+        void setSketchRank(cint rank);
+
+        /**
+         * @brief setIterativeSolver : conjugate gradient readout, the gram matrix is not built
+         * @param [in] enabled
+         * @param [in] maxIterations
+         * @param [in] tolerance : relative residual
+         */
+        void setIterativeSolver(cbool enabled, cint maxIterations = 50, cfloat tolerance = 1e-4f);
+
+        /**
+         * @brief setReadoutWarmStart : the iterative readout of the next training starts from the current one
+         * @param [in] enabled
+         */
+        void setReadoutWarmStart(cbool enabled);
+
+        /**
+         * @brief setStreamingTraining : stream the stimulus files by chunks of sentences and learn W OUT with mini-batch Adam instead of the closed-form readout,
+         *  the outputs of the training sentences are not available in this mode
+         * @param [in] chunkSize    : sentences per chunk, if <= 0 the whole corpus is loaded
+         * @param [in] epochs
+         * @param [in] learningRate
+         */
+        void setStreamingTraining(cint chunkSize, cint epochs = 1, cfloat learningRate = 1e-3f);
+
         /**
          * @brief saveParamFile
          * @param pathDirectory
@@ -283,7 +345,7 @@ class Model : public QObject
 
         Sentences m_recoveredSentencesTrain;    /**< ... */
         Sentences m_recoveredSentencesTest;     /**< ... */
-        Sentences m_testSentence;               /**< corpus test sentence */
+        Sentences m_testSentence;               /**< corpus test sentence, tokenized once per corpus : must be set before resetModelParameters */
 
 
     signals :
@@ -315,6 +377,27 @@ class Model : public QObject
          */
         void retrieveTestsSentences();
 
+        /**
+         * @brief recoverSentences : put the OCW in the decoded constructions, the processing is done on the vocabulary ids
+         * @param [in] constructionIds : indices of the closed class words of each sentence
+         * @param [in] OCW             : open class words of each sentence
+         * @param [out] recovered
+         * @param [out] recoveredTokens : recovered as ids of the vocabulary
+         */
+        void recoverSentences(const std::vector<std::vector<int> > &constructionIds, const Sentences &OCW, Sentences &recovered, TokenizedSentences &recoveredTokens);
+
+        /**
+         * @brief updateVocabulary : take the vocabulary and the train sentences of the corpus cache when the corpus has changed
+         */
+        void updateVocabulary();
+
+        /**
+         * @brief launchStreamingTraining : end of launchTraining when the stim files are streamed by chunks
+         * @param [in] trainingTime : start of the training
+         * @return false if the training has been aborted
+         */
+        bool launchStreamingTraining(const clock_t trainingTime);
+
 
     private :
 
@@ -326,6 +409,20 @@ class Model : public QObject
         Sentence m_structure;                   /**< structure used in the corpus */
         Sentence m_closedClassWords;            /**< closed class words */
 
+        std::string m_stimulusDirectory;        /**< directory of the stimulus files generated by the python script */
+        Vocabulary m_vocabulary;                /**< ids of the words of the current corpus */
+        quint64 m_vocabularyHash;               /**< content hash of the corpus of m_vocabulary, 0 if it must be retrieved */
+        bool m_testSentenceTokenized;           /**< is m_testSentenceTokens up to date */
+        TokenizedSentences m_trainSentenceTokens;   /**< m_trainSentence ids */
+        TokenizedSentences m_testSentenceTokens;    /**< ids of the test goal sentences */
+        TokenizedSentences m_recoveredTokensTrain;  /**< m_recoveredSentencesTrain ids */
+        TokenizedSentences m_recoveredTokensTest;   /**< m_recoveredSentencesTest ids */
+
+        // streaming training
+        int m_streamChunkSize;                  /**< sentences per chunk of the streaming training, <= 0 to load the whole corpus */
+        int m_streamEpochs;                     /**< passes on the stimulus files */
+        float m_streamLearningRate;             /**< Adam step size */
+
         // corpus train data
         Sentences m_trainMeaning;               /**< corpus train meaning    -> ex : gave dog toy girl , chase dog cat  */
         Sentences m_trainInfo;                  /**< corpus train info    -> ex : [A-_-_-P-O-R-_-_][A-P-O-_-_-_-_-_] */
@@ -0,0 +1,657 @@
+
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+/**
+ * \file NpyIO.h
+ * \brief defines functions for reading/writing 2D and 3D matrices with the NumPy binary formats (.npy, .npz)
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#ifndef NPYIO_H
+#define NPYIO_H
+
+#include "Utility.h"
+
+
+/**
+ * @brief npyCrc32 : CRC-32 (zip polynomial) of a buffer, needed for the npz archive entries
+ * @param [in] data
+ * @param [in] size
+ * @param [in] crc  : crc of the previous buffers, for computing the crc of consecutive buffers
+ * @return crc
+ */
+static quint32 npyCrc32(const char *data, const qint64 size, const quint32 crc = 0)
+{
+    quint32 l_table[256];
+    for(quint32 ii = 0; ii < 256; ++ii)
+    {
+        quint32 l_value = ii;
+        for(int jj = 0; jj < 8; ++jj)
+        {
+            l_value = (l_value & 1) ? (0xEDB88320u ^ (l_value >> 1)) : (l_value >> 1);
+        }
+        l_table[ii] = l_value;
+    }
+
+    quint32 l_crc = crc ^ 0xFFFFFFFFu;
+    for(qint64 ii = 0; ii < size; ++ii)
+    {
+        l_crc = l_table[(l_crc ^ static_cast<uchar>(data[ii])) & 0xFF] ^ (l_crc >> 8);
+    }
+
+    return l_crc ^ 0xFFFFFFFFu;
+}
+
+/**
+ * @brief generateNpyHeader : build the .npy header of a 2D or 3D float/double matrix, the raw data of the matrix follows it in the file
+ * @param [in] mat
+ * @param [out] header
+ * @return false if the type or the dimensions of the matrix are not managed
+ */
+static bool generateNpyHeader(const cv::Mat &mat, QByteArray &header)
+{
+    if(mat.depth() != CV_32F && mat.depth() != CV_64F)
+    {
+        std::cerr << "-ERROR : generateNpyHeader -> only float and double matrices can be saved. " << std::endl;
+        return false;
+    }
+
+    if(mat.dims != 2 && mat.dims != 3)
+    {
+        std::cerr << "-ERROR : generateNpyHeader -> only 2D and 3D matrices can be saved. " << std::endl;
+        return false;
+    }
+
+    // header dictionnary
+        QString l_shape;
+        for(int ii = 0; ii < mat.dims; ++ii)
+        {
+            l_shape += QString::number(mat.size[ii]) + ", ";
+        }
+        l_shape.chop(2);
+
+        QByteArray l_dictionnary = QString("{'descr': '%1', 'fortran_order': False, 'shape': (%2), }")
+                .arg(mat.depth() == CV_32F ? "<f4" : "<f8").arg(l_shape).toAscii();
+
+    // pad the header with spaces, magic string (6) + version (2) + length (2) + header + '\n' must be aligned on 64 bytes
+        int l_totalHeaderSize = 10 + l_dictionnary.size() + 1;
+        l_dictionnary.append(QByteArray((64 - l_totalHeaderSize % 64) % 64, ' '));
+        l_dictionnary.append('\n');
+
+    header.clear();
+    header.append("\x93NUMPY", 6);
+    header.append(static_cast<char>(1));
+    header.append(static_cast<char>(0));
+    header.append(static_cast<char>(l_dictionnary.size() & 0xFF));
+    header.append(static_cast<char>((l_dictionnary.size() >> 8) & 0xFF));
+    header.append(l_dictionnary);
+
+    return true;
+}
+
+/**
+ * @brief parseNpyHeader : read the header of a .npy buffer
+ * @param [in] data
+ * @param [in] size         : size of the buffer, at least the size of the header
+ * @param [out] shape       : 1D arrays are returned as 1xN, the fortran 2D shapes are swapped
+ * @param [out] type        : CV_32FC1 or CV_64FC1
+ * @param [out] fortranOrder
+ * @param [out] dataOffset  : offset of the raw data in the buffer
+ * @return false if the buffer is not a managed .npy array
+ */
+static bool parseNpyHeader(const char *data, const qint64 size, std::vector<int> &shape, int &type, bool &fortranOrder, qint64 &dataOffset)
+{
+    if(size < 10 || memcmp(data, "\x93NUMPY", 6) != 0)
+    {
+        std::cerr << "-ERROR : parseNpyHeader -> not a npy array. " << std::endl;
+        return false;
+    }
+
+    // header
+        int l_majorVersion = static_cast<uchar>(data[6]);
+        qint64 l_headerStart, l_headerSize;
+        if(l_majorVersion == 1)
+        {
+            l_headerStart = 10;
+            l_headerSize  = qFromLittleEndian<quint16>(reinterpret_cast<const uchar*>(data + 8));
+        }
+        else
+        {
+            if(size < 12)
+            {
+                std::cerr << "-ERROR : parseNpyHeader -> truncated header. " << std::endl;
+                return false;
+            }
+            l_headerStart = 12;
+            l_headerSize  = qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(data + 8));
+        }
+
+        if(l_headerStart + l_headerSize > size)
+        {
+            std::cerr << "-ERROR : parseNpyHeader -> truncated header. " << std::endl;
+            return false;
+        }
+
+        QString l_header = QString::fromAscii(data + l_headerStart, static_cast<int>(l_headerSize));
+        dataOffset = l_headerStart + l_headerSize;
+
+    // type
+        QRegExp l_descrRx("'descr'\\s*:\\s*'([^']*)'");
+        if(l_descrRx.indexIn(l_header) < 0)
+        {
+            std::cerr << "-ERROR : parseNpyHeader -> no descr in header. " << std::endl;
+            return false;
+        }
+
+        QString l_descr = l_descrRx.cap(1);
+        if(l_descr == "<f4")
+        {
+            type = CV_32FC1;
+        }
+        else if(l_descr == "<f8")
+        {
+            type = CV_64FC1;
+        }
+        else
+        {
+            std::cerr << "-ERROR : parseNpyHeader -> type " << l_descr.toStdString() << " not managed. " << std::endl;
+            return false;
+        }
+
+    // order
+        fortranOrder = l_header.contains(QRegExp("'fortran_order'\\s*:\\s*True"));
+
+    // shape
+        QRegExp l_shapeRx("'shape'\\s*:\\s*\\(([^\\)]*)\\)");
+        if(l_shapeRx.indexIn(l_header) < 0)
+        {
+            std::cerr << "-ERROR : parseNpyHeader -> no shape in header. " << std::endl;
+            return false;
+        }
+
+        shape.clear();
+        QStringList l_dims = l_shapeRx.cap(1).split(',', QString::SkipEmptyParts);
+        for(int ii = 0; ii < l_dims.size(); ++ii)
+        {
+            if(l_dims[ii].trimmed().size() > 0)
+            {
+                shape.push_back(l_dims[ii].trimmed().toInt());
+            }
+        }
+
+        if(shape.size() == 1)
+        {
+            shape.insert(shape.begin(), 1);
+        }
+
+        if(shape.size() < 2 || shape.size() > 3 || (fortranOrder && shape.size() == 3))
+        {
+            std::cerr << "-ERROR : parseNpyHeader -> shape not managed. " << std::endl;
+            return false;
+        }
+
+        if(fortranOrder)
+        {
+            std::swap(shape[0], shape[1]);
+        }
+
+    return true;
+}
+
+/**
+ * @brief parseNpyData : create a matrix from a .npy buffer (C order, little endian float32/float64, 1 to 3 dimensions)
+ * @param [in] data
+ * @param [in] size
+ * @param [out] mat : 1D arrays are returned as a 1xN matrix
+ * @return false if the buffer is not a managed .npy array
+ */
+static bool parseNpyData(const char *data, const qint64 size, cv::Mat &mat)
+{
+    std::vector<int> l_shape;
+    int l_type;
+    bool l_fortranOrder;
+    qint64 l_dataOffset;
+    if(!parseNpyHeader(data, size, l_shape, l_type, l_fortranOrder, l_dataOffset))
+    {
+        return false;
+    }
+
+    // data
+        mat = cv::Mat(static_cast<int>(l_shape.size()), &l_shape[0], l_type);
+
+        qint64 l_dataSize = static_cast<qint64>(mat.total() * mat.elemSize());
+        if(l_dataOffset + l_dataSize > size)
+        {
+            std::cerr << "-ERROR : parseNpyData -> truncated data. " << std::endl;
+            mat = cv::Mat();
+            return false;
+        }
+
+        memcpy(mat.data, data + l_dataOffset, static_cast<size_t>(l_dataSize));
+
+        if(l_fortranOrder)
+        {
+            mat = mat.t();
+        }
+
+    return true;
+}
+
+/**
+ * @brief saveMatrixToNpy
+ * @param [in] pathFile
+ * @param [in] mat : 2D or 3D float/double matrix
+ * @return false if the file can't be written
+ */
+static bool saveMatrixToNpy(const QString &pathFile, const cv::Mat &mat)
+{
+    QByteArray l_header;
+    if(!generateNpyHeader(mat, l_header))
+    {
+        return false;
+    }
+
+    cv::Mat l_mat = mat.isContinuous() ? mat : mat.clone();
+    qint64 l_dataSize = static_cast<qint64>(l_mat.total() * l_mat.elemSize());
+
+    QFile l_file(pathFile);
+    if(!l_file.open(QIODevice::WriteOnly) || l_file.write(l_header) != l_header.size() ||
+       l_file.write(reinterpret_cast<const char*>(l_mat.data), l_dataSize) != l_dataSize)
+    {
+        std::cerr << "-ERROR : saveMatrixToNpy -> can not write npy file. " << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief loadMatrixFromNpy : the file is mapped in memory, the data is copied without any parsing
+ * @param [in] pathFile
+ * @param [out] mat
+ * @return false if the file can't be read
+ */
+static bool loadMatrixFromNpy(const QString &pathFile, cv::Mat &mat)
+{
+    QFile l_file(pathFile);
+    if(!l_file.open(QIODevice::ReadOnly))
+    {
+        std::cerr << "-ERROR : loadMatrixFromNpy -> can not open npy file. " << std::endl;
+        return false;
+    }
+
+    qint64 l_fileSize = l_file.size();
+    uchar *l_mappedData = l_fileSize > 0 ? l_file.map(0, l_fileSize) : NULL;
+
+    bool l_success;
+    if(l_mappedData)
+    {
+        l_success = parseNpyData(reinterpret_cast<const char*>(l_mappedData), l_fileSize, mat);
+        l_file.unmap(l_mappedData);
+    }
+    else
+    {
+        QByteArray l_data = l_file.readAll();
+        l_success = parseNpyData(l_data.constData(), l_data.size(), mat);
+    }
+
+    return l_success;
+}
+
+/**
+ * @brief saveMatricesToNpz : save several matrices in a npz archive (stored zip, readable with numpy.load)
+ * @param [in] pathFile
+ * @param [in] names    : name of each array in the archive
+ * @param [in] matrices : 2D or 3D float/double matrices
+ * @return false if the file can't be written
+ */
+static bool saveMatricesToNpz(const QString &pathFile, const QStringList &names, const std::vector<cv::Mat> &matrices)
+{
+    if(names.size() != static_cast<int>(matrices.size()))
+    {
+        std::cerr << "-ERROR : saveMatricesToNpz -> names and matrices sizes are different. " << std::endl;
+        return false;
+    }
+
+    QFile l_file(pathFile);
+    if(!l_file.open(QIODevice::WriteOnly))
+    {
+        std::cerr << "-ERROR : saveMatricesToNpz -> can not write npz file. " << std::endl;
+        return false;
+    }
+
+    QDataStream l_out(&l_file);
+    l_out.setByteOrder(QDataStream::LittleEndian);
+
+    QByteArray l_centralDirectory;
+    QDataStream l_outDirectory(&l_centralDirectory, QIODevice::WriteOnly);
+    l_outDirectory.setByteOrder(QDataStream::LittleEndian);
+
+    for(int ii = 0; ii < names.size(); ++ii)
+    {
+        QByteArray l_header;
+        if(!generateNpyHeader(matrices[ii], l_header))
+        {
+            return false;
+        }
+
+        cv::Mat l_mat = matrices[ii].isContinuous() ? matrices[ii] : matrices[ii].clone();
+        const char *l_data     = reinterpret_cast<const char*>(l_mat.data);
+        qint64 l_dataSize      = static_cast<qint64>(l_mat.total() * l_mat.elemSize());
+        qint64 l_entrySize     = l_header.size() + l_dataSize;
+        if(l_entrySize > 0xFFFFFFFFll || l_file.pos() > 0xFFFFFFFFll)
+        {
+            std::cerr << "-ERROR : saveMatricesToNpz -> the archive exceeds the zip size limit (4 GB). " << std::endl;
+            return false;
+        }
+
+        QByteArray l_name      = (names[ii] + ".npy").toAscii();
+        quint32 l_crc          = npyCrc32(l_data, l_dataSize, npyCrc32(l_header.constData(), l_header.size()));
+        quint32 l_offset       = static_cast<quint32>(l_file.pos());
+
+        // local file header, the data is written from the matrix without any copy
+            l_out << quint32(0x04034b50) << quint16(20) << quint16(0) << quint16(0) << quint16(0) << quint16(0x21)
+                  << l_crc << quint32(l_entrySize) << quint32(l_entrySize)
+                  << quint16(l_name.size()) << quint16(0);
+            l_out.writeRawData(l_name.constData(), l_name.size());
+            l_out.writeRawData(l_header.constData(), l_header.size());
+            if(l_file.write(l_data, l_dataSize) != l_dataSize)
+            {
+                std::cerr << "-ERROR : saveMatricesToNpz -> can not write npz file. " << std::endl;
+                return false;
+            }
+
+        // central directory entry
+            l_outDirectory << quint32(0x02014b50) << quint16(20) << quint16(20) << quint16(0) << quint16(0) << quint16(0) << quint16(0x21)
+                           << l_crc << quint32(l_entrySize) << quint32(l_entrySize)
+                           << quint16(l_name.size()) << quint16(0) << quint16(0) << quint16(0) << quint16(0) << quint32(0)
+                           << l_offset;
+            l_outDirectory.writeRawData(l_name.constData(), l_name.size());
+    }
+
+    if(l_file.pos() > 0xFFFFFFFFll)
+    {
+        std::cerr << "-ERROR : saveMatricesToNpz -> the archive exceeds the zip size limit (4 GB). " << std::endl;
+        return false;
+    }
+
+    quint32 l_directoryOffset = static_cast<quint32>(l_file.pos());
+    l_out.writeRawData(l_centralDirectory.constData(), l_centralDirectory.size());
+
+    // end of central directory
+        l_out << quint32(0x06054b50) << quint16(0) << quint16(0) << quint16(names.size()) << quint16(names.size())
+              << quint32(l_centralDirectory.size()) << l_directoryOffset << quint16(0);
+
+    return l_out.status() == QDataStream::Ok;
+}
+
+/**
+ * @brief loadMatricesFromNpz : load all the arrays of a npz archive, only stored entries are managed (numpy.savez, not numpy.savez_compressed)
+ * @param [in] pathFile
+ * @param [out] names
+ * @param [out] matrices
+ * @return false if the archive can't be read
+ */
+static bool loadMatricesFromNpz(const QString &pathFile, QStringList &names, std::vector<cv::Mat> &matrices)
+{
+    names.clear();
+    matrices.clear();
+
+    QFile l_file(pathFile);
+    if(!l_file.open(QIODevice::ReadOnly))
+    {
+        std::cerr << "-ERROR : loadMatricesFromNpz -> can not open npz file. " << std::endl;
+        return false;
+    }
+
+    qint64 l_fileSize = l_file.size();
+    uchar *l_mappedData = l_fileSize > 0 ? l_file.map(0, l_fileSize) : NULL;
+    QByteArray l_readData;
+    bool l_isMapped = l_mappedData != NULL;
+    if(!l_isMapped)
+    {
+        l_readData = l_file.readAll();
+        l_mappedData = reinterpret_cast<uchar*>(l_readData.data());
+        l_fileSize = l_readData.size();
+    }
+
+    const uchar *l_data = l_mappedData;
+    bool l_success = true;
+
+    // find end of central directory
+        qint64 l_endDirectory = -1;
+        for(qint64 ii = l_fileSize - 22; ii >= 0 && ii >= l_fileSize - 22 - 0xFFFF; --ii)
+        {
+            if(qFromLittleEndian<quint32>(l_data + ii) == 0x06054b50)
+            {
+                l_endDirectory = ii;
+                break;
+            }
+        }
+
+        if(l_endDirectory < 0)
+        {
+            std::cerr << "-ERROR : loadMatricesFromNpz -> not a zip archive. " << std::endl;
+            l_success = false;
+        }
+
+    // read entries
+        if(l_success)
+        {
+            int l_nbEntries           = qFromLittleEndian<quint16>(l_data + l_endDirectory + 10);
+            qint64 l_directoryOffset  = qFromLittleEndian<quint32>(l_data + l_endDirectory + 16);
+
+            for(int ii = 0; ii < l_nbEntries && l_success; ++ii)
+            {
+                if(l_directoryOffset + 46 > l_fileSize || qFromLittleEndian<quint32>(l_data + l_directoryOffset) != 0x02014b50)
+                {
+                    std::cerr << "-ERROR : loadMatricesFromNpz -> invalid central directory. " << std::endl;
+                    l_success = false;
+                    break;
+                }
+
+                int l_method          = qFromLittleEndian<quint16>(l_data + l_directoryOffset + 10);
+                qint64 l_dataSize     = qFromLittleEndian<quint32>(l_data + l_directoryOffset + 20);
+                int l_nameSize        = qFromLittleEndian<quint16>(l_data + l_directoryOffset + 28);
+                int l_extraSize       = qFromLittleEndian<quint16>(l_data + l_directoryOffset + 30);
+                int l_commentSize     = qFromLittleEndian<quint16>(l_data + l_directoryOffset + 32);
+                qint64 l_localOffset  = qFromLittleEndian<quint32>(l_data + l_directoryOffset + 42);
+                if(l_directoryOffset + 46 + l_nameSize > l_fileSize)
+                {
+                    std::cerr << "-ERROR : loadMatricesFromNpz -> invalid central directory. " << std::endl;
+                    l_success = false;
+                    break;
+                }
+
+                QString l_name        = QString::fromAscii(reinterpret_cast<const char*>(l_data + l_directoryOffset + 46), l_nameSize);
+
+                if(l_method != 0)
+                {
+                    std::cerr << "-ERROR : loadMatricesFromNpz -> compressed entries are not managed (" << l_name.toStdString() << "). " << std::endl;
+                    l_success = false;
+                    break;
+                }
+
+                if(l_localOffset + 30 > l_fileSize || qFromLittleEndian<quint32>(l_data + l_localOffset) != 0x04034b50)
+                {
+                    std::cerr << "-ERROR : loadMatricesFromNpz -> invalid local header (" << l_name.toStdString() << "). " << std::endl;
+                    l_success = false;
+                    break;
+                }
+
+                qint64 l_localNameSize  = qFromLittleEndian<quint16>(l_data + l_localOffset + 26);
+                qint64 l_localExtraSize = qFromLittleEndian<quint16>(l_data + l_localOffset + 28);
+                qint64 l_dataStart      = l_localOffset + 30 + l_localNameSize + l_localExtraSize;
+
+                cv::Mat l_mat;
+                if(l_dataStart + l_dataSize > l_fileSize || !parseNpyData(reinterpret_cast<const char*>(l_data + l_dataStart), l_dataSize, l_mat))
+                {
+                    l_success = false;
+                    break;
+                }
+
+                if(l_name.endsWith(".npy"))
+                {
+                    l_name.chop(4);
+                }
+
+                names << l_name;
+                matrices.push_back(l_mat);
+
+                l_directoryOffset += 46 + l_nameSize + l_extraSize + l_commentSize;
+            }
+        }
+
+    if(l_isMapped)
+    {
+        l_file.unmap(l_mappedData);
+    }
+
+    return l_success;
+}
+
+/**
+ * @brief save3DMatrix : save a matrix, the format is defined by the file extension (.npy or python text format)
+ * @param [in] pathFile
+ * @param [in] mat3D
+ * @return false if the file can't be written
+ */
+static bool save3DMatrix(const QString &pathFile, const cv::Mat &mat3D)
+{
+    if(pathFile.endsWith(".npy", Qt::CaseInsensitive))
+    {
+        return saveMatrixToNpy(pathFile, mat3D);
+    }
+
+    return save3DMatrixToText(pathFile, mat3D);
+}
+
+/**
+ * @brief load3DMatrixF : load a float matrix, the format is defined by the file extension (.npy or python text format)
+ * @param [in] pathFile
+ * @param [out] mat3D
+ * @return false if the file can't be read
+ */
+static bool load3DMatrixF(const QString &pathFile, cv::Mat &mat3D)
+{
+    if(pathFile.endsWith(".npy", Qt::CaseInsensitive))
+    {
+        if(!loadMatrixFromNpy(pathFile, mat3D))
+        {
+            return false;
+        }
+
+        if(mat3D.depth() != CV_32F)
+        {
+            cv::Mat l_matF;
+            mat3D.convertTo(l_matF, CV_32F);
+            mat3D = l_matF;
+        }
+
+        return true;
+    }
+
+    return load3DMatrixFromNpPythonSaveTextF(pathFile, mat3D);
+}
+
+/**
+ * @brief loadNpyChunkF : load the items [first, first + count[ of the first dimension of a C order .npy 3D matrix as floats,
+ *  only the header and the requested items are read from the file
+ * @param [in] pathFile
+ * @param [in] first
+ * @param [in] count    : clamped to the number of items of the file
+ * @param [out] chunk   : [count x dim1 x dim2]
+ * @param [out] nbItems : size of the first dimension of the file (optional)
+ * @return false if the file can't be read or is not a C order 3D matrix
+ */
+static bool loadNpyChunkF(const QString &pathFile, const int first, const int count, cv::Mat &chunk, int *nbItems = NULL)
+{
+    QFile l_file(pathFile);
+    if(!l_file.open(QIODevice::ReadOnly))
+    {
+        std::cerr << "-ERROR : loadNpyChunkF -> can not open npy file. " << std::endl;
+        return false;
+    }
+
+    // header, its size is stored after the magic string and the version
+        QByteArray l_header = l_file.read(12);
+        if(l_header.size() >= 10)
+        {
+            qint64 l_headerSize = (static_cast<uchar>(l_header[6]) == 1) ? 10 + qFromLittleEndian<quint16>(reinterpret_cast<const uchar*>(l_header.constData() + 8)) :
+                                                                           12 + qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(l_header.constData() + 8));
+            l_file.seek(0);
+            l_header = l_file.read(l_headerSize);
+        }
+
+        std::vector<int> l_shape;
+        int l_type;
+        bool l_fortranOrder;
+        qint64 l_dataOffset;
+        if(!parseNpyHeader(l_header.constData(), l_header.size(), l_shape, l_type, l_fortranOrder, l_dataOffset))
+        {
+            return false;
+        }
+
+        if(l_shape.size() != 3)
+        {
+            std::cerr << "-ERROR : loadNpyChunkF -> only 3D matrices can be loaded by chunks. " << std::endl;
+            return false;
+        }
+
+        if(l_fortranOrder)
+        {
+            std::cerr << "-ERROR : loadNpyChunkF -> the items of a fortran order matrix are not contiguous. " << std::endl;
+            return false;
+        }
+
+        if(nbItems)
+        {
+            *nbItems = l_shape[0];
+        }
+
+    // items
+        int l_count = std::max(0, std::min(count, l_shape[0] - first));
+        int l_sizes[3] = {l_count, l_shape[1], l_shape[2]};
+        cv::Mat l_chunk(3, l_sizes, l_type);
+
+        qint64 l_itemSize = static_cast<qint64>(l_shape[1]) * l_shape[2] * CV_ELEM_SIZE(l_type);
+        qint64 l_chunkSize = l_itemSize * l_count;
+        if(!l_file.seek(l_dataOffset + l_itemSize * first) || l_file.read(reinterpret_cast<char*>(l_chunk.data), l_chunkSize) != l_chunkSize)
+        {
+            std::cerr << "-ERROR : loadNpyChunkF -> truncated data. " << std::endl;
+            return false;
+        }
+
+        if(l_type != CV_32FC1)
+        {
+            l_chunk.convertTo(chunk, CV_32F);
+        }
+        else
+        {
+            chunk = l_chunk;
+        }
+
+    return true;
+}
+
+#endif // NPYIO_H
@@ -0,0 +1,165 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+/**
+ * \file PackedSequences.h
+ * \brief defines the packed representation of variable-length sequences and the functions for packing the padded 3D matrices
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#ifndef PACKEDSEQUENCES_H
+#define PACKEDSEQUENCES_H
+
+#include "Utility.h"
+#include "TaskScheduler.h"
+
+
+/**
+ * @brief Variable-length sequences stored without padding
+ */
+struct PackedSequences
+{
+    cv::Mat m_data;                 /**< concatenated timesteps of all the sequences */
+    std::vector<int> m_offsets;     /**< first timestep of each sequence in m_data, the last value is the total number of timesteps */
+};
+
+/**
+ * @brief packedOffsets
+ * @param [in] lengths
+ * @param [out] offsets : first timestep of each sequence, the last value is the total
+ */
+static void packedOffsets(const std::vector<int> &lengths, std::vector<int> &offsets)
+{
+    offsets.resize(lengths.size() + 1);
+    offsets[0] = 0;
+    for(size_t ii = 0; ii < lengths.size(); ++ii)
+    {
+        offsets[ii + 1] = offsets[ii] + lengths[ii];
+    }
+}
+
+/**
+ * @brief Copy of a range of sequences between a padded 3D matrix and a packed 2D matrix
+ */
+class PackTask : public SentenceTask
+{
+    public :
+
+        /**
+         * @brief Available copies
+         */
+        enum Copy
+        {
+            PACK_COLUMNS,   /**< sentence [dim x timesteps] -> columns of the packed data */
+            PACK_ROWS,      /**< sentence [timesteps x dim] -> rows of the packed data */
+            UNPACK_ROWS     /**< rows of the packed data -> sentence [timesteps x dim] */
+        };
+
+        /**
+         * @brief PackTask constructor, the matrices are headers sharing the data of the caller
+         * @param [in] copy
+         * @param [in] padded   : [sentences x d1 x d2]
+         * @param [in] packed   : packed data
+         * @param [in] offsets  : first timestep of each sequence in the packed data
+         */
+        PackTask(const Copy copy, const cv::Mat &padded, const cv::Mat &packed, const std::vector<int> &offsets) : m_copy(copy), m_padded(padded),
+            m_packed(packed), m_offsets(offsets)
+        {}
+
+        void run(cint begin, cint end)
+        {
+            for(int ii = begin; ii < end; ++ii)
+            {
+                cv::Mat l_sentence(m_padded.size[1], m_padded.size[2], CV_32FC1, m_padded.data + m_padded.step[0] * ii);
+                int l_first = m_offsets[ii], l_last = m_offsets[ii + 1];
+
+                switch(m_copy)
+                {
+                    case PACK_COLUMNS :
+                        l_sentence.colRange(0, l_last - l_first).copyTo(m_packed.colRange(l_first, l_last));
+                    break;
+                    case PACK_ROWS :
+                        l_sentence.rowRange(0, l_last - l_first).copyTo(m_packed.rowRange(l_first, l_last));
+                    break;
+                    case UNPACK_ROWS :
+                        m_packed.rowRange(l_first, l_last).copyTo(l_sentence.rowRange(0, l_last - l_first));
+                    break;
+                }
+            }
+        }
+
+    private :
+
+        Copy m_copy;
+        cv::Mat m_padded;
+        cv::Mat m_packed;
+        const std::vector<int> &m_offsets;
+};
+
+/**
+ * @brief packStates : pack the states of the sentences in the columns of a 2D matrix
+ * @param [in] xTot     : [sentences x dimState x timesteps]
+ * @param [in] lengths  : length of each sentence
+ * @param [out] packed  : m_data is [dimState x total timesteps]
+ */
+static void packStates(const cv::Mat &xTot, const std::vector<int> &lengths, PackedSequences &packed)
+{
+    packedOffsets(lengths, packed.m_offsets);
+    packed.m_data = cv::Mat(xTot.size[1], packed.m_offsets.back(), CV_32FC1);
+
+    PackTask l_task(PackTask::PACK_COLUMNS, xTot, packed.m_data, packed.m_offsets);
+    TaskScheduler::instance()->parallelFor(l_task, xTot.size[0], &lengths);
+}
+
+/**
+ * @brief packTeacher : pack the teacher of the sentences in the rows of a 2D matrix
+ * @param [in] teacher  : [sentences x timesteps x dimOutput]
+ * @param [in] lengths  : length of each sentence
+ * @param [out] packed  : m_data is [total timesteps x dimOutput]
+ */
+static void packTeacher(const cv::Mat &teacher, const std::vector<int> &lengths, PackedSequences &packed)
+{
+    packedOffsets(lengths, packed.m_offsets);
+    packed.m_data = cv::Mat(packed.m_offsets.back(), teacher.size[2], CV_32FC1);
+
+    PackTask l_task(PackTask::PACK_ROWS, teacher, packed.m_data, packed.m_offsets);
+    TaskScheduler::instance()->parallelFor(l_task, teacher.size[0], &lengths);
+}
+
+/**
+ * @brief unpackRows : copy the rows of each packed sequence at the beginning of its sentence in a padded 3D matrix, the padding is left untouched
+ * @param [in] packed   : m_data is [total timesteps x dim]
+ * @param [out] output  : [sentences x timesteps x dim] already allocated, nothing is copied if it already shares the packed data
+ */
+static void unpackRows(const PackedSequences &packed, cv::Mat &output)
+{
+    if(packed.m_data.data == output.data)
+    {
+        return;
+    }
+
+    PackTask l_task(PackTask::UNPACK_ROWS, output, packed.m_data, packed.m_offsets);
+    TaskScheduler::instance()->parallelFor(l_task, output.size[0]);
+}
+
+#endif // PACKEDSEQUENCES_H
@@ -0,0 +1,155 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+
+/**
+ * \file ProgressReporter.h
+ * \brief defines ProgressCounter and ProgressReporter
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#ifndef PROGRESSREPORTER_H
+#define PROGRESSREPORTER_H
+
+#include "Utility.h"
+#include "gpuMat/configCuda.h"
+
+/**
+ * @brief The ProgressCounter class
+ * Progress of a computation : the phase (label and total) is changed by the computing thread, the steps done are
+ * counted without lock by any thread.
+ */
+class ProgressCounter
+{
+    public :
+
+        /**
+         * @brief ProgressCounter constructor
+         */
+        ProgressCounter();
+
+        /**
+         * @brief set the progress and start a new phase
+         * @param [in] done
+         * @param [in] total
+         * @param [in] label
+         */
+        void set(cint done, cint total, const QString &label);
+
+        /**
+         * @brief advance the steps done of the current phase, can be called concurrently
+         * @param [in] steps
+         */
+        void advance(cint steps = 1);
+
+        /**
+         * @brief sample the current progress
+         * @param [out] done
+         * @param [out] total
+         * @param [out] label
+         * @return true if the progress has changed since the last sample
+         */
+        bool sample(int &done, int &total, QString &label);
+
+    private :
+
+        QAtomicInt m_done;          /**< steps done */
+        QAtomicInt m_version;       /**< incremented at each new phase */
+
+        QMutex m_phaseLock;         /**< lock of the phase */
+        QString m_label;            /**< label of the phase */
+        int m_total;                /**< total steps of the phase */
+
+        int m_sampledVersion;       /**< phase of the last sample */
+        int m_sampledDone;          /**< steps done of the last sample */
+};
+
+/**
+ * @brief Receiver of the progress sampled by a ProgressReporter
+ */
+class ProgressListener
+{
+    public :
+
+        virtual ~ProgressListener(){}
+
+        /**
+         * @brief reportProgress, called from the reporter thread
+         * @param [in] done
+         * @param [in] total
+         * @param [in] label
+         */
+        virtual void reportProgress(cint done, cint total, const QString &label) = 0;
+};
+
+/**
+ * @brief The ProgressReporter class
+ * Thread sampling a progress counter at a fixed rate and sending it to a listener when it has changed,
+ * the last progress is sent when the reporter is stopped.
+ */
+class ProgressReporter : public QThread
+{
+    public :
+
+        /**
+         * @brief ProgressReporter constructor
+         * @param [in] counter
+         * @param [in] listener
+         * @param [in] periodMs : sampling period
+         */
+        ProgressReporter(ProgressCounter *counter, ProgressListener *listener, cint periodMs = 100);
+
+        /**
+         * @brief ProgressReporter destructor, stops the thread
+         */
+        ~ProgressReporter();
+
+        /**
+         * @brief stop the sampling and wait for the end of the thread
+         */
+        void stop();
+
+    protected :
+
+        /**
+         * @brief run the sampling loop
+         */
+        void run();
+
+    private :
+
+        /**
+         * @brief send the progress to the listener if it has changed
+         */
+        void report();
+
+        ProgressCounter *m_counter;     /**< sampled counter */
+        ProgressListener *m_listener;   /**< receiver of the progress */
+        int m_periodMs;                 /**< sampling period */
+
+        QMutex m_lock;                  /**< lock of m_stopped */
+        QWaitCondition m_stopCondition; /**< wakes the thread up when it's stopped */
+        bool m_stopped;                 /**< the thread must stop */
+};
+
+#endif // PROGRESSREPORTER_H
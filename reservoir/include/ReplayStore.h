@@ -0,0 +1,137 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+/**
+ * \file ReplayStore.h
+ * \brief defines ReplayStore
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#ifndef REPLAYSTORE_H
+#define REPLAYSTORE_H
+
+#include "Utility.h"
+#include "gpuMat/configCuda.h"
+
+/**
+ * @brief The ReplayStore class
+ * Binary replay file of the internal states (x tot matrix [sentences, neurons, time]), split in tiles of (sentence, neurons block).
+ * Each tile can be compressed with zlib (lossless) and an index of the tiles is stored after the header, so the replay
+ * only reads the tiles of the selected sentences and neurons.
+ *
+ * File layout (little endian) :
+ *  - header : "RPLSTORE", version, sentences number, neurons number, time steps number, neurons per tile, compression, tiles number
+ *  - index  : for each tile (sentence major), offset (quint64) and stored size (quint32)
+ *  - tiles  : float32 [neurons of the block, time] (compressed or not)
+ */
+class ReplayStore
+{
+    public :
+
+        /**
+         * @brief ReplayStore constructor
+         * @param [in] cacheSizeMB : maximum size of the decoded tiles kept in memory
+         */
+        ReplayStore(cint cacheSizeMB = 64);
+
+        /**
+         * @brief save a 3D float matrix in a replay store file
+         * @param [in] pathFile
+         * @param [in] xTot           : 3D float matrix [sentences, neurons, time]
+         * @param [in] neuronsPerTile : number of neurons in each tile
+         * @param [in] compress       : compress the tiles with zlib
+         * @return false if the file can't be written
+         */
+        static bool save(const QString &pathFile, const cv::Mat &xTot, cint neuronsPerTile = 64, cbool compress = true);
+
+        /**
+         * @brief open a replay store file, only the header and the index are read
+         * @param [in] pathFile
+         * @return false if the file is not a valid replay store
+         */
+        bool open(const QString &pathFile);
+
+        /**
+         * @brief close the current file and clear the cache
+         */
+        void close();
+
+        /**
+         * @brief isOpen
+         * @return true if a replay store file is opened
+         */
+        bool isOpen() const;
+
+        /**
+         * @brief sentencesNumber
+         * @return
+         */
+        int sentencesNumber() const;
+
+        /**
+         * @brief neuronsNumber
+         * @return
+         */
+        int neuronsNumber() const;
+
+        /**
+         * @brief timeStepsNumber
+         * @return
+         */
+        int timeStepsNumber() const;
+
+        /**
+         * @brief read the activity of one neuron during one sentence, only the corresponding tile is read (or taken from the cache)
+         * @param [in] idSentence
+         * @param [in] idNeuron
+         * @param [out] activity : values for each time step
+         * @return false if the tile can't be read
+         */
+        bool neuronActivity(cint idSentence, cint idNeuron, QVector<double> &activity);
+
+    private :
+
+        /**
+         * @brief read and decode a tile
+         * @param [in] idSentence
+         * @param [in] idBlock
+         * @return tile matrix [neurons of the block, time], NULL if it can't be read (owned by the cache)
+         */
+        cv::Mat *tile(cint idSentence, cint idBlock);
+
+        QFile m_file;                           /**< opened replay file */
+
+        quint32 m_nbSentences;                  /**< sentences number */
+        quint32 m_nbNeurons;                    /**< neurons number */
+        quint32 m_nbTimeSteps;                  /**< time steps number */
+        quint32 m_neuronsPerTile;               /**< neurons number per tile */
+        quint32 m_nbBlocks;                     /**< neurons blocks number */
+        bool m_compressed;                      /**< are the tiles compressed ? */
+
+        std::vector<quint64> m_tilesOffset;     /**< offset of each tile in the file */
+        std::vector<quint32> m_tilesSize;       /**< stored size of each tile */
+
+        QCache<int, cv::Mat> m_tilesCache;      /**< decoded tiles, the cost is in KB */
+};
+
+#endif // REPLAYSTORE_H
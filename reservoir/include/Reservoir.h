@@ -73,13 +73,17 @@
 #include "opencv2/imgproc/imgproc.hpp"
 
 #include "Utility.h"
-#include "gpuMat/cudaInversions.h"
-#include "gpuMat/cudaMultiplications.h"
+#include "TrajectoryCache.h"
+#include "PackedSequences.h"
+#include "ProgressReporter.h"
+#include "CancellationToken.h"
+#include "LinearAlgebra.h"
+#include "SentenceSource.h"
 
 /**
  * @brief The Reservoir class
  */
-class Reservoir  : public QObject
+class Reservoir  : public QObject, public ProgressListener
 {
 
     Q_OBJECT
@@ -133,13 +137,46 @@ class Reservoir  : public QObject
          */
         void generateWIn(cuint dimInput);
 
+        /**
+         * @brief checkLoadedMatrices : check the number of neurons of the loaded W / W IN
+         * @return false if they don't match
+         */
+        bool checkLoadedMatrices();
+
         /**
          * @brief tikhonovRegularization
-         * @param xTot
-         * @param yTeacher
-         * @param dimInput
+         * @param [in] states   : [(1 + dimInput + N) x timesteps], one column per packed timestep
+         * @param [in] yTeacher : [timesteps x dimOutput]
+         */
+        bool tikhonovRegularization(const cv::Mat &states, const cv::Mat &yTeacher);
+
+        /**
+         * @brief dualTikhonovRegularization : sample space form of the regularization, used when there are less timesteps than features,
+         *  solves (X^T * X + ridge * I) * alpha = Y and sets W OUT = alpha^T * X^T
+         * @param [in] states   : [(1 + dimInput + N) x timesteps], one column per packed timestep
+         * @param [in] yTeacher : [timesteps x dimOutput]
+         * @return false if cancelled or if the Cholesky factorization has failed
+         */
+        bool dualTikhonovRegularization(const cv::Mat &states, const cv::Mat &yTeacher);
+
+        /**
+         * @brief sketchedTikhonovRegularization : approximate regularization in the span of a randomized rank m_sketchRank basis Q of the states,
+         *  Z = Q^T * X, solves (Z * Z^T + ridge * I) * B = Z * Y and sets W OUT = B^T * Q^T, the D x D gram matrix is never built.
+         *  The rank used is lower than m_sketchRank if the states have less singular values above the float precision
+         * @param [in] states   : [(1 + dimInput + N) x timesteps], one column per packed timestep
+         * @param [in] yTeacher : [timesteps x dimOutput]
+         * @return false if cancelled or if a factorization has failed
          */
-        bool tikhonovRegularization(const cv::Mat &xTot, const cv::Mat &yTeacher, cuint dimInput);
+        bool sketchedTikhonovRegularization(const cv::Mat &states, const cv::Mat &yTeacher);
+
+        /**
+         * @brief conjugateGradientRegularization : matrix-free solve of W OUT * (X * X^T + ridge * I) = Y^T * X^T, one conjugate gradient per output row,
+         *  the operator is applied as (P * X) * X^T + ridge * P so the gram matrix is never built
+         * @param [in] states   : [(1 + dimInput + N) x timesteps], one column per packed timestep
+         * @param [in] yTeacher : [timesteps x dimOutput]
+         * @return false if cancelled
+         */
+        bool conjugateGradientRegularization(const cv::Mat &states, const cv::Mat &yTeacher);
 
         /**
          * @brief train
@@ -151,6 +188,17 @@ class Reservoir  : public QObject
          */
         bool train(const cv::Mat &meaningInputTrain, const cv::Mat &teacher, cv::Mat &sentencesOutputTrain, cv::Mat &xTot);
 
+        /**
+         * @brief trainStreaming : out-of-core training, the sentences are simulated by chunks and W OUT is updated with mini-batch Adam,
+         *  the memory is bounded by the chunk size and W OUT, the outputs of the training sentences are not kept
+         * @param [in] source       : sentences to be streamed
+         * @param [in] chunkSize    : number of sentences of a mini-batch
+         * @param [in] epochs       : number of passes on the source
+         * @param [in] learningRate : Adam step size
+         * @return false if cancelled or if a chunk can't be read
+         */
+        bool trainStreaming(SentenceSource &source, cint chunkSize, cint epochs, cfloat learningRate);
+
         /**
          * @brief test
          * @param meaningInputTest
@@ -162,8 +210,9 @@ class Reservoir  : public QObject
         /**
          * @brief Save the current state of internal matrices m_wF m_wInF, m_wOutF
          * @param [in] path : path of the directory where the files m_w.txt, m_wIn.txt, m_wOut.txt will be saved
+         * @return false if a file can't be written or if the save is cancelled, the training files of the directory are then removed
          */
-        void saveTraining(const std::string &path);
+        bool saveTraining(const std::string &path);
 
         /**
          * @brief loadTraining
@@ -188,6 +237,14 @@ class Reservoir  : public QObject
          */
         void updateMatricesWithLoadedTraining();
 
+        /**
+         * @brief setTraining : share the matrices of a training kept in memory (they are never modified in place by the reservoir)
+         * @param [in] w
+         * @param [in] wIn
+         * @param [in] wOut
+         */
+        void setTraining(const cv::Mat &w, const cv::Mat &wIn, const cv::Mat &wOut);
+
         /**
          * @brief setMatricesUse
          * @param useCustomW
@@ -195,6 +252,46 @@ class Reservoir  : public QObject
          */
         void setMatricesUse(cbool useCustomW, cbool useCustomWIn);
 
+        /**
+         * @brief setCpuBackend : linear algebra backend used by the readout when the CUDA flags are disabled
+         * @param [in] backend
+         */
+        void setCpuBackend(const LinearAlgebraBackend::Type backend);
+
+        /**
+         * @brief setSketchRank : approximate the readout in a randomized subspace of the states, see sketchedTikhonovRegularization
+         * @param [in] rank : dimension of the subspace, if <= 0 the readout is exact
+         */
+        void setSketchRank(cint rank);
+
+        /**
+         * @brief setIterativeSolver : use conjugateGradientRegularization for the readout
+         * @param [in] enabled
+         * @param [in] maxIterations : maximum number of iterations
+         * @param [in] tolerance     : relative residual stopping each output row
+         */
+        void setIterativeSolver(cbool enabled, cint maxIterations = 50, cfloat tolerance = 1e-4f);
+
+        /**
+         * @brief setWarmStart : the iterative solver starts from the current W OUT if its size matches the new problem
+         * @param [in] enabled
+         */
+        void setWarmStart(cbool enabled);
+
+        /**
+         * @brief sketchError : relative Frobenius error ||X - Q * Q^T * X|| / ||X|| of the states projection used by the last training
+         * @return -1 if the last training was exact
+         */
+        float sketchError() const;
+
+        /**
+         * @brief reportProgress : send the progress sampled by the reporter thread of train / test
+         * @param [in] done
+         * @param [in] total
+         * @param [in] label
+         */
+        void reportProgress(cint done, cint total, const QString &label);
+
         /**
          * @brief saveW
          * @param path
@@ -222,8 +319,8 @@ class Reservoir  : public QObject
     public slots :
 
         /**
-         * @brief enableMaxOmpThreadNumber
-         * @param enable
+         * @brief enableMaxOmpThreadNumber : thread budget of the next train and test calls
+         * @param enable : all the threads of the TaskScheduler, else only the calling thread
          */
         void enableMaxOmpThreadNumber(bool enable);
 
@@ -232,6 +329,11 @@ class Reservoir  : public QObject
          */
         void stopLoop();
 
+        /**
+         * @brief resetStopLoop : cancel a stop request which has not been handled by a loop
+         */
+        void resetStopLoop();
+
 
     signals :
 
@@ -286,6 +388,15 @@ class Reservoir  : public QObject
          */
         bool checkStop();
 
+        /**
+         * @brief buildStates : compute the internal states of the reservoir with the trajectory cache
+         * @param [in] meaningInput : [sentences x timesteps x dimInput]
+         * @param [out] xTot        : [sentences x (1 + dimInput + N) x timesteps]
+         * @param [in] lengths      : if not NULL, timesteps computed for each sentence
+         * @param [in] progress     : if not NULL, advanced of one step per timestep of the sentences
+         */
+        void buildStates(const cv::Mat &meaningInput, cv::Mat &xTot, const std::vector<int> *lengths = NULL, ProgressCounter *progress = NULL);
+
 
     private :
 
@@ -306,6 +417,13 @@ class Reservoir  : public QObject
         float m_inputScaling;           /**< input scaling used to multiply the matrice W IN */
         float m_leakRate;               /**< leak rate used to build X tot in the training and the test */
         float m_ridge;                  /**< ridge value used in the tychonov regularization */
+        LinearAlgebraBackend::Type m_cpuBackend; /**< backend used by the readout without CUDA */
+        int m_sketchRank;               /**< rank of the approximate readout, <= 0 for the exact one */
+        float m_sketchError;            /**< relative projection error of the last approximate readout, -1 if exact */
+        bool m_iterativeSolver;         /**< conjugate gradient readout */
+        bool m_warmStart;               /**< the conjugate gradient starts from the current W OUT */
+        int m_maxIterations;            /**< maximum conjugate gradient iterations */
+        float m_tolerance;              /**< relative residual of the conjugate gradient */
 
         cv::Mat m_w;                    /**< W matrice */
         cv::Mat m_wIn;                  /**< W IN matrice */
@@ -315,11 +433,13 @@ class Reservoir  : public QObject
         cv::Mat m_wInLoaded;            /**< loaded W IN matrice  */
         cv::Mat m_wOutLoaded;           /**< loaded W OUT matrice */
 
-        int m_numThread;                /**< number of threads to be used by openmp */
+        TrajectoryCache m_trajectoryCache;  /**< states of the input prefixes already simulated with the current W / W IN */
+
+        int m_numThread;                /**< thread budget of the train and test loops in the TaskScheduler, 0 : all the threads, 1 : only the calling thread */
         bool m_sendMatrices;            /**< send matrices to be displayed in the interface */
 
-        bool m_stopLoop;                /**< is the loop must be stoped ? */
-        QReadWriteLock m_stopLocker;    /**< stop loop locker */
+        CancellationToken m_cancel;     /**< stop request of the loops */
+        ProgressCounter m_progress;     /**< progress of the current computation */
 };
 
 
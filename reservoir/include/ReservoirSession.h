@@ -0,0 +1,137 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+/**
+ * \file ReservoirSession.h
+ * \brief defines ReservoirSession
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#ifndef RESERVOIRSESSION_H
+#define RESERVOIRSESSION_H
+
+#include "Utility.h"
+#include "gpuMat/configCuda.h"
+
+/**
+ * @brief The ReservoirSession class
+ * Runs a trained reservoir one timestep at a time and keeps its internal state between the steps.
+ * All the buffers are allocated at the construction, a step only does the products W IN * [1;u], W * x and W OUT * [1;u;x].
+ * A session is not thread-safe, it must be used by one thread at a time.
+ */
+class ReservoirSession
+{
+    public :
+
+        /**
+         * @brief ReservoirSession constructor, the matrices are shared, not copied
+         * @param [in] w        : reservoir matrix [N x N]
+         * @param [in] wIn      : input matrix [N x (1 + dimInput)]
+         * @param [in] wOut     : readout matrix [dimOutput x (1 + dimInput + N)]
+         * @param [in] leakRate : leak rate used for the training
+         */
+        ReservoirSession(const cv::Mat &w, const cv::Mat &wIn, const cv::Mat &wOut, cfloat leakRate);
+
+        /**
+         * @brief isValid
+         * @return false if the dimensions of the matrices don't match
+         */
+        bool isValid() const;
+
+        /**
+         * @brief inputDimension
+         * @return size of the input vector of a step
+         */
+        int inputDimension() const;
+
+        /**
+         * @brief outputDimension
+         * @return size of the readout vector of a step
+         */
+        int outputDimension() const;
+
+        /**
+         * @brief reset the internal state to zero, as at the beginning of a sentence
+         */
+        void reset();
+
+        /**
+         * @brief step : push one timestep and compute the readout
+         * @param [in] input   : inputDimension() values
+         * @param [out] output : outputDimension() values
+         */
+        void step(const float *input, float *output);
+
+        /**
+         * @brief sharesTraining
+         * @param [in] other
+         * @return true if the two sessions use the same matrices and leak rate, their steps can be computed in the same batch
+         */
+        bool sharesTraining(const ReservoirSession &other) const;
+
+    private :
+
+        friend class ReservoirSessionBatch;
+
+        bool m_isValid;                 /**< are the dimensions of the matrices consistent ? */
+        float m_leakRate;               /**< leak rate */
+
+        cv::Mat m_w;                    /**< W matrice */
+        cv::Mat m_wIn;                  /**< W IN matrice */
+        cv::Mat m_wOut;                 /**< W OUT matrice */
+
+        cv::Mat m_extendedState;        /**< [1;u;x] column */
+        cv::Mat m_input;                /**< [1;u] rows of m_extendedState */
+        cv::Mat m_x;                    /**< x rows of m_extendedState */
+        cv::Mat m_inputProduct;         /**< W IN * [1;u] */
+        cv::Mat m_recurrentProduct;     /**< W * x */
+        cv::Mat m_y;                    /**< W OUT * [1;u;x] */
+};
+
+/**
+ * @brief The ReservoirSessionBatch class
+ * Computes one step of several sessions sharing the same training with one product per matrix,
+ * the states are gathered in the columns of a matrix and scattered back to the sessions after the step.
+ * The buffers only grow, a batch of an already seen size makes no allocation.
+ */
+class ReservoirSessionBatch
+{
+    public :
+
+        /**
+         * @brief step : push one timestep in each session and compute their readouts
+         * @param [in,out] sessions : valid sessions sharing the same training, each one appears only once
+         * @param [in] inputs       : input vector of each session
+         * @param [out] outputs     : output vector of each session
+         */
+        void step(const std::vector<ReservoirSession*> &sessions, const std::vector<const float*> &inputs, const std::vector<float*> &outputs);
+
+    private :
+
+        cv::Mat m_extendedStates;       /**< [1;u;x] columns of the sessions */
+        cv::Mat m_inputProducts;        /**< W IN * [1;u] */
+        cv::Mat m_recurrentProducts;    /**< W * x */
+        cv::Mat m_y;                    /**< W OUT * [1;u;x] */
+};
+
+#endif // RESERVOIRSESSION_H
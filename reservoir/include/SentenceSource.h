@@ -0,0 +1,92 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+/**
+ * \file SentenceSource.h
+ * \brief defines SentenceSource
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#ifndef SENTENCESOURCE_H
+#define SENTENCESOURCE_H
+
+#include "Utility.h"
+#include "gpuMat/configCuda.h"
+
+/**
+ * @brief The SentenceSource class
+ * Training sentences read by chunks, used by the out-of-core training of the reservoir.
+ */
+class SentenceSource
+{
+    public :
+
+        /**
+         * @brief SentenceSource destructor
+         */
+        virtual ~SentenceSource(){}
+
+        /**
+         * @brief nbSentences
+         * @return total number of sentences of the source
+         */
+        virtual int nbSentences() const = 0;
+
+        /**
+         * @brief chunk : read the sentences [first, first + count[, the last chunk can be smaller
+         * @param [in] first
+         * @param [in] count
+         * @param [out] meaningInput : [sentences x timesteps x dimInput]
+         * @param [out] teacher      : [sentences x timesteps x dimOutput]
+         * @return false if the sentences can't be read
+         */
+        virtual bool chunk(cint first, cint count, cv::Mat &meaningInput, cv::Mat &teacher) = 0;
+};
+
+/**
+ * @brief The NpySentenceSource class
+ * Reads the chunks directly in the .npy stimulus files generated by the python script, only the requested sentences are loaded.
+ */
+class NpySentenceSource : public SentenceSource
+{
+    public :
+
+        /**
+         * @brief NpySentenceSource constructor
+         * @param [in] meaningPath : .npy file of the meaning inputs
+         * @param [in] teacherPath : .npy file of the teacher outputs
+         */
+        NpySentenceSource(const QString &meaningPath, const QString &teacherPath);
+
+        int nbSentences() const;
+
+        bool chunk(cint first, cint count, cv::Mat &meaningInput, cv::Mat &teacher);
+
+    private :
+
+        QString m_meaningPath;  /**< meaning inputs file */
+        QString m_teacherPath;  /**< teacher outputs file */
+        int m_nbSentences;      /**< number of sentences of the files, 0 if they can't be read */
+};
+
+#endif // SENTENCESOURCE_H
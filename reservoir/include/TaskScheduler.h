@@ -0,0 +1,211 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+
+/**
+ * \file TaskScheduler.h
+ * \brief defines TaskScheduler
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <deque>
+#include <algorithm>
+
+#include "Utility.h"
+#include "gpuMat/configCuda.h"
+
+class TaskScheduler;
+
+/**
+ * @brief Work done on a range of sentences
+ */
+class SentenceTask
+{
+    public :
+
+        virtual ~SentenceTask(){}
+
+        /**
+         * @brief run the task on the sentences [begin, end[, several ranges can be run at the same time by different threads
+         * @param [in] begin
+         * @param [in] end
+         */
+        virtual void run(cint begin, cint end) = 0;
+};
+
+/**
+ * @brief State of a parallelFor call shared by its chunks
+ */
+struct TaskCall
+{
+    SentenceTask *m_task;       /**< task to run */
+    QAtomicInt m_remaining;     /**< chunks of the call not finished yet */
+    QAtomicInt m_running;       /**< chunks of the call being run */
+    int m_maxThreads;           /**< maximum number of chunks of the call run at the same time */
+};
+
+/**
+ * @brief Range of sentences of a parallelFor call waiting in a queue
+ */
+struct TaskChunk
+{
+    TaskCall *m_call;           /**< call of the chunk */
+    int m_begin;                /**< first sentence */
+    int m_end;                  /**< last sentence + 1 */
+};
+
+/**
+ * @brief Worker thread of TaskScheduler
+ */
+class TaskSchedulerThread : public QThread
+{
+    public :
+
+        /**
+         * @brief Constructor of TaskSchedulerThread
+         * @param [in] scheduler
+         * @param [in] id : index of the queue of the thread
+         */
+        TaskSchedulerThread(TaskScheduler *scheduler, cint id);
+
+    protected :
+
+        /**
+         * @brief run the chunks until the scheduler is closed
+         */
+        void run();
+
+    private :
+
+        TaskScheduler *m_scheduler;     /**< owner */
+        int m_id;                       /**< queue of the thread */
+};
+
+/**
+ * @brief The TaskScheduler class
+ * Pool of threads owning the thread budget of the sentence loops. The sentences of a call are cut in chunks of similar cost
+ * (the costs are usually the lengths of the sentences) and dealt in the queues of the threads, a thread runs its own chunks
+ * from the front and steals the chunks of the other queues from the back once its queue is empty.
+ * Several threads can call parallelFor at the same time, the calling thread runs chunks while it waits.
+ * Each calling thread has its own thread budget (setThreadBudget) : the chunks of its calls are never run by more threads,
+ * so the concurrent jobs of a process can share the cores without changing any process-wide setting.
+ */
+class TaskScheduler
+{
+    public :
+
+        /**
+         * @brief TaskScheduler constructor
+         * @param [in] nbThreads : total number of threads running the chunks, the calling thread included
+         */
+        TaskScheduler(cint nbThreads);
+
+        /**
+         * @brief TaskScheduler destructor, stops the threads
+         */
+        ~TaskScheduler();
+
+        /**
+         * @brief instance
+         * @return scheduler shared by the whole process, with one thread per core
+         */
+        static TaskScheduler *instance();
+
+        /**
+         * @brief threadNumber
+         * @return total number of threads running the chunks
+         */
+        int threadNumber() const;
+
+        /**
+         * @brief setThreadBudget : set the thread budget of the calling thread
+         * @param [in] nbThreads : maximum number of threads running the chunks of the calls of the calling thread, 0 : all the threads
+         */
+        void setThreadBudget(cint nbThreads);
+
+        /**
+         * @brief threadBudget
+         * @return number of threads which can run the chunks of the calls of the calling thread
+         */
+        int threadBudget() const;
+
+        /**
+         * @brief parallelFor : run the task on the sentences [0, nbSentences[ and wait for the end
+         * @param [in] task
+         * @param [in] nbSentences
+         * @param [in] costs        : if not NULL, cost of each sentence used for balancing the chunks, else all the sentences have the same cost
+         * @param [in] maxThreads   : maximum number of threads running the task, 0 : the thread budget of the calling thread, 1 : the calling thread only
+         */
+        void parallelFor(SentenceTask &task, cint nbSentences, const std::vector<int> *costs = NULL, cint maxThreads = 0);
+
+    private :
+
+        friend class TaskSchedulerThread;
+
+        /**
+         * @brief takeChunk : take the first chunk of a queue whose call is below its maximum number of threads
+         * @param [in] queue
+         * @param [in] front : search from the front (own queue) or from the back (stolen chunk)
+         * @param [out] chunk
+         * @return false if no chunk can be run
+         */
+        bool takeChunk(cint queue, cbool front, TaskChunk &chunk);
+
+        /**
+         * @brief popChunk : take a chunk from the front of a queue, or steal a chunk from the back of another queue
+         * @param [in] queue : queue of the thread, -1 for a thread without queue
+         * @param [out] chunk
+         * @param [in] wait  : wait for a chunk if no chunk can be run
+         * @return false if there is no chunk (or if the scheduler is closed)
+         */
+        bool popChunk(cint queue, TaskChunk &chunk, cbool wait);
+
+        /**
+         * @brief wakeUp : wake up the threads waiting for a chunk
+         */
+        void wakeUp();
+
+        /**
+         * @brief runChunk
+         * @param [in] chunk
+         */
+        void runChunk(const TaskChunk &chunk);
+
+        std::vector<TaskSchedulerThread*> m_threads;    /**< worker threads */
+        std::vector<std::deque<TaskChunk> > m_queues;   /**< chunks of each thread */
+        std::vector<QMutex*> m_queuesLocks;             /**< one lock per queue */
+
+        QAtomicInt m_queuedChunks;                      /**< chunks in the queues */
+        QMutex m_sleepLock;                             /**< lock for waiting for chunks */
+        QWaitCondition m_chunksAdded;                   /**< wakes the threads up when chunks are added or can be run */
+        int m_wakeUps;                                  /**< number of wake ups, a thread only sleeps if nothing changed since its search */
+        bool m_closed;                                  /**< the threads must stop */
+
+        QMutex m_doneLock;                              /**< lock for waiting for the end of a call */
+        QWaitCondition m_chunkDone;                     /**< a call is finished */
+};
+
+#endif // TASKSCHEDULER_H
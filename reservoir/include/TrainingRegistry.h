@@ -0,0 +1,130 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+/**
+ * \file TrainingRegistry.h
+ * \brief defines TrainingRegistry
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#ifndef TRAININGREGISTRY_H
+#define TRAININGREGISTRY_H
+
+#include "Utility.h"
+#include "gpuMat/configCuda.h"
+
+/**
+ * @brief Matrices of a trained reservoir kept in memory
+ */
+struct ResidentTraining
+{
+    cv::Mat m_w;                /**< reservoir matrix [N x N] */
+    cv::Mat m_wIn;              /**< input matrix [N x (1 + dimInput)] */
+    cv::Mat m_wOut;             /**< readout matrix [dimOutput x (1 + dimInput + N)] */
+    QStringList m_parameters;   /**< content of the param.txt file */
+};
+
+/**
+ * @brief The TrainingRegistry class
+ * Keeps several trained reservoirs in memory, keyed by name (or by the training directory when no name is given).
+ * The least recently used trainings are evicted when the memory budget is exceeded. All the methods are thread-safe,
+ * the returned matrices share the data of the registry (cv::Mat reference counting) and stay valid after an eviction.
+ */
+class TrainingRegistry
+{
+    public :
+
+        /**
+         * @brief TrainingRegistry constructor
+         * @param [in] budgetMB : maximum memory used by the resident trainings
+         */
+        TrainingRegistry(cint budgetMB = 1024);
+
+        /**
+         * @brief load a training directory (wOut.txt, wIn.txt, w.txt, param.txt) and keep it resident, replaces an existing training with the same name
+         * @param [in] name : name of the training in the registry
+         * @param [in] path : training directory
+         * @return false if the training can't be loaded
+         */
+        bool load(const QString &name, const QString &path);
+
+        /**
+         * @brief unload a resident training
+         * @param [in] name
+         * @return false if there is no training with this name
+         */
+        bool unload(const QString &name);
+
+        /**
+         * @brief retrieve a resident training, if it's not resident and the key is a training directory, it's loaded first
+         * @param [in] nameOrPath
+         * @param [out] training
+         * @return false if the training is not resident and can't be loaded
+         */
+        bool acquire(const QString &nameOrPath, ResidentTraining &training);
+
+        /**
+         * @brief names of the resident trainings
+         * @return
+         */
+        QStringList names();
+
+        /**
+         * @brief memory used by the resident trainings
+         * @return size in bytes
+         */
+        qint64 usedMemory();
+
+    private :
+
+        /**
+         * @brief insert a training in the registry and evict the old ones if needed
+         * @param [in] name
+         * @param [in] training
+         */
+        void insert(const QString &name, const ResidentTraining &training);
+
+        /**
+         * @brief evict the least recently used trainings until the budget is respected, m_lock must be locked
+         * @param [in] keptName : training which must not be evicted
+         */
+        void evict(const QString &keptName);
+
+        /**
+         * @brief A resident training and its LRU information
+         */
+        struct Entry
+        {
+            ResidentTraining m_training;    /**< matrices */
+            qint64 m_bytes;                 /**< memory used by the matrices */
+            quint64 m_lastUse;              /**< value of the use counter at the last access */
+        };
+
+        qint64 m_budget;                /**< memory budget in bytes */
+        qint64 m_usedMemory;            /**< memory used by the entries */
+        quint64 m_useCounter;           /**< incremented at each access */
+        QHash<QString, Entry> m_entries;/**< resident trainings */
+        QMutex m_lock;                  /**< mutex lock for the entries */
+};
+
+#endif // TRAININGREGISTRY_H
@@ -0,0 +1,129 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+/**
+ * \file TrajectoryCache.h
+ * \brief defines TrajectoryCache
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#ifndef TRAJECTORYCACHE_H
+#define TRAJECTORYCACHE_H
+
+#include "Utility.h"
+#include "gpuMat/configCuda.h"
+#include "CancellationToken.h"
+#include "ProgressReporter.h"
+
+/**
+ * @brief The TrajectoryCache class
+ * Trie of the input sequences given to a reservoir : a node is an input row following the sequence of its parent and keeps the
+ * reservoir state reached after it. The sentences sharing a prefix (between them or with the previous calls) only compute their suffix,
+ * the new nodes of a same depth are computed together with one product per matrix.
+ * The cache is kept while the W / W IN matrices and the leak rate don't change.
+ */
+class TrajectoryCache
+{
+    public :
+
+        /**
+         * @brief TrajectoryCache constructor
+         * @param [in] budgetMB : maximum memory used by the stored states, the cache is cleared when it's exceeded
+         */
+        TrajectoryCache(cint budgetMB = 512);
+
+        /**
+         * @brief clear all the stored trajectories
+         */
+        void clear();
+
+        /**
+         * @brief bind the reservoir matrices, the cache is cleared if they are different from the previous ones
+         * @param [in] w        : reservoir matrix [N x N]
+         * @param [in] wIn      : input matrix [N x (1 + dimInput)]
+         * @param [in] leakRate
+         */
+        void bind(const cv::Mat &w, const cv::Mat &wIn, cfloat leakRate);
+
+        /**
+         * @brief computeStates : compute the internal states of the reservoir for all the sentences and all the timesteps
+         * @param [in] meaningInput : [sentences x timesteps x dimInput] (CV_32FC1)
+         * @param [out] xTot        : [sentences x (1 + dimInput + N) x timesteps], each column is [1;u;x]
+         * @param [in] lengths      : if not NULL, only the first lengths[ii] timesteps of the sentence ii are computed, the next columns are zero
+         * @param [in] cancel       : if not NULL, checked between the blocks of nodes of each depth, a cancelled call clears the cache and returns zero states
+         * @param [in] progress     : if not NULL, advanced of one step per timestep reused or computed
+         */
+        void computeStates(const cv::Mat &meaningInput, cv::Mat &xTot, const std::vector<int> *lengths = NULL, const CancellationToken *cancel = NULL,
+                           ProgressCounter *progress = NULL);
+
+        /**
+         * @brief reusedSteps
+         * @return number of timesteps of the last call retrieved from the cache
+         */
+        int reusedSteps() const;
+
+        /**
+         * @brief computedSteps
+         * @return number of timesteps of the last call computed by the reservoir
+         */
+        int computedSteps() const;
+
+    private :
+
+        /**
+         * @brief retrieve the child of a node with this input, or create it
+         * @param [in] parent
+         * @param [in] input : dimInput values
+         * @param [out] created : is the node new ?
+         * @return id of the node
+         */
+        int child(cint parent, const float *input, bool &created);
+
+        /**
+         * @brief compute the states of new nodes of the same depth, block by block
+         * @param [in] nodes
+         * @param [in] cancel   : if not NULL, checked before each block
+         * @param [in] progress : if not NULL, advanced of the nodes of each block
+         * @return false if the computation has been cancelled
+         */
+        bool computeNodes(const std::vector<int> &nodes, const CancellationToken *cancel, ProgressCounter *progress);
+
+        qint64 m_budget;                    /**< memory budget in bytes */
+
+        cv::Mat m_w;                        /**< bound W matrice */
+        cv::Mat m_wIn;                      /**< bound W IN matrice */
+        float m_leakRate;                   /**< bound leak rate */
+
+        int m_dimInput;                     /**< size of the inputs of the nodes */
+        int m_nbNeurons;                    /**< size of the states of the nodes */
+
+        std::vector<int> m_parents;         /**< parent of each node, -1 for the root */
+        std::vector<float> m_inputs;        /**< input of each node [nodes x dimInput] */
+        std::vector<float> m_states;        /**< state of each node [nodes x N], the root state is zero */
+        QMultiHash<quint64, int> m_children;/**< children of the nodes, keyed by the hash of the parent id and of the input */
+
+        int m_reusedSteps;                  /**< timesteps of the last call retrieved from the cache */
+        int m_computedSteps;                /**< timesteps of the last call computed */
+};
+
+#endif // TRAJECTORYCACHE_H
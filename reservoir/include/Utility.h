@@ -36,11 +36,15 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <cstring>
+#include <cmath>
 
 
 // qt
 #include <QtGui>
 
+#include "CancellationToken.h"
+
 // opencv
 #include "opencv2/highgui/highgui.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
@@ -395,8 +399,9 @@ template<typename T>
  * @brief load2DMatrixStd
  * @param pathFile
  * @param mat2D
+ * @param cancel : if not NULL, checked at each line, nothing is loaded if it's cancelled
  */
-static void load2DMatrixStd(const std::string &pathFile, cv::Mat &mat2D)
+static void load2DMatrixStd(const std::string &pathFile, cv::Mat &mat2D, const CancellationToken *cancel = NULL)
 {
     std::ifstream  l_fileStream(pathFile);
     std::vector<std::vector<T> > l_2DArray;
@@ -406,6 +411,12 @@ static void load2DMatrixStd(const std::string &pathFile, cv::Mat &mat2D)
     {
         while(!l_endFile)
         {
+            if(cancel && cancel->isCancelled())
+            {
+                std::cerr << "-ERROR : load2DMatrixStd -> loading cancelled. " << std::endl;
+                return;
+            }
+
             std::vector<T> l_1DArray;
 
             std::string l_line;
@@ -490,13 +501,16 @@ static void load2DMatrixStd(const std::string &pathFile, cv::Mat &mat2D)
 
 
 /**
- * @brief save2DMatrixToTextStd
+ * @brief save2DMatrixToTextStd : the matrix is written in a temporary file renamed at the end, an existing file is replaced only by a complete one
  * @param pathFile
  * @param mat2D
+ * @param cancel : if not NULL, checked at each row, nothing is saved if it's cancelled
+ * @return false if the file can't be written or if the save is cancelled
  */
-static void save2DMatrixToTextStd(const std::string &pathFile, const cv::Mat &mat2D)
+static bool save2DMatrixToTextStd(const std::string &pathFile, const cv::Mat &mat2D, const CancellationToken *cancel = NULL)
 {
-    std::ofstream l_oFlowFile(pathFile);
+    std::string l_tempPath = pathFile + ".tmp";
+    std::ofstream l_oFlowFile(l_tempPath.c_str());
 
     // check depth input data
         bool l_32b = false;
@@ -505,43 +519,57 @@ static void save2DMatrixToTextStd(const std::string &pathFile, const cv::Mat &ma
             l_32b = true;
         }
 
-    if(l_oFlowFile)
+    if(!l_oFlowFile)
     {
-        if(l_32b)
-        {
-            for(int ii = 0; ii < mat2D.size[0]; ++ii)
-            {
-                for(int jj = 0; jj < mat2D.size[1]; ++jj)
-                {
-                    std::ostringstream l_osV1;
-                    l_osV1.precision(15);
-                    l_osV1 << mat2D.at<float>(ii,jj) << " ";
-                    l_oFlowFile << l_osV1.str();
-                }
+        std::cerr << "-ERROR : save2DMatrixToTextStd -> can not write 2D matrix in file. " << std::endl;
+        return false;
+    }
 
-                l_oFlowFile << "\n";
-            }
+    bool l_cancelled = false;
+    for(int ii = 0; ii < mat2D.size[0] && l_oFlowFile; ++ii)
+    {
+        if(cancel && cancel->isCancelled())
+        {
+            l_cancelled = true;
+            break;
         }
-        else
+
+        for(int jj = 0; jj < mat2D.size[1]; ++jj)
         {
-            for(int ii = 0; ii < mat2D.size[0]; ++ii)
+            std::ostringstream l_osV1;
+            l_osV1.precision(15);
+            if(l_32b)
             {
-                for(int jj = 0; jj < mat2D.size[1]; ++jj)
-                {
-                    std::ostringstream l_osV1;
-                    l_osV1.precision(15);
-                    l_osV1 << mat2D.at<double>(ii,jj) << " ";
-                    l_oFlowFile << l_osV1.str();
-                }
-
-                l_oFlowFile << "\n";
+                l_osV1 << mat2D.at<float>(ii,jj) << " ";
+            }
+            else
+            {
+                l_osV1 << mat2D.at<double>(ii,jj) << " ";
             }
+            l_oFlowFile << l_osV1.str();
         }
+
+        l_oFlowFile << "\n";
     }
-    else
+
+    l_oFlowFile.close();
+    bool l_written = !l_cancelled && !l_oFlowFile.fail();
+
+    // replace the previous file
+        QString l_path = QString::fromStdString(pathFile), l_temp = QString::fromStdString(l_tempPath);
+        if(l_written)
+        {
+            QFile::remove(l_path);
+            l_written = QFile::rename(l_temp, l_path);
+        }
+
+    if(!l_written)
     {
-        std::cerr << "Can not write éD matrix in file. " << std::endl;
+        QFile::remove(l_temp);
+        std::cerr << "-ERROR : save2DMatrixToTextStd -> " << (l_cancelled ? "save cancelled" : "can not write 2D matrix in file") << " (" << pathFile << "). " << std::endl;
     }
+
+    return l_written;
 }
 
 /**
@@ -671,8 +699,9 @@ static void save3DMatrixToTextStd(const std::string &pathFile, const cv::Mat &ma
  * @brief save3DMatrixToText
  * @param pathFile
  * @param mat3D
+ * @return false if the file can't be written, a partial file is removed
  */
-static void save3DMatrixToText(const QString &pathFile, const cv::Mat &mat3D)
+static bool save3DMatrixToText(const QString &pathFile, const cv::Mat &mat3D)
 {
     // check depth input data
         bool l_32b = false;
@@ -718,175 +747,297 @@ static void save3DMatrixToText(const QString &pathFile, const cv::Mat &mat3D)
                 }
             }
         }
+
+        out.flush();
+        if(l_file.flush() && l_file.error() == QFile::NoError)
+        {
+            return true;
+        }
+
+        l_file.close();
+        l_file.remove();
     }
-    else
-    {
-        std::cerr << "Can not write 3D matrix in file. " << std::endl;
-    }
+
+    std::cerr << "Can not write 3D matrix in file. " << std::endl;
+    return false;
 }
 
 /**
- * @brief load3DMatrixFromNpPythonSaveText
- * @param pathFile
- * @param mat3D
+ * @brief parseTextReal : parse one real value from a text buffer, move the pointer just after it (locale independent, no allocation)
+ * @param [in,out] ptr   : current position, must not be on a end of line
+ * @param [in] end       : end of the buffer
+ * @param [out] value    : parsed value
+ * @return false if no value has been found before the end of the line
  */
-static void load3DMatrixFromNpPythonSaveText(const QString &pathFile, std::vector<cv::Mat> &mat3D)
+static bool parseTextReal(const char *&ptr, const char *end, double &value)
 {
-    QFile l_file(pathFile);
+    static const double l_pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                     1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
 
-    if(l_file.open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        QTextStream in(&l_file), inLine;
-        in.setRealNumberPrecision(15);
-        inLine.setRealNumberPrecision(15);
-
-        int l_sizesMat[3];
-
-        QString l_separator, l_size;
-        in >> l_separator;
-        in >> l_size;
-        l_sizesMat[0] = l_size.toInt();
-        in >> l_size;
-        l_sizesMat[1] = l_size.toInt();
-        in >> l_size;
-        l_sizesMat[2] = l_size.toInt();
+    // skip separators
+        while(ptr < end && (*ptr == ' ' || *ptr == '\t' || *ptr == '\r'))
+        {
+            ++ptr;
+        }
 
-        QString l_line = in.readLine();
-        l_separator ="";
+        if(ptr >= end || *ptr == '\n')
+        {
+            return false;
+        }
 
-        mat3D = std::vector<cv::Mat>(l_sizesMat[0], cv::Mat(l_sizesMat[1],l_sizesMat[2], CV_64FC1));
+    const char *l_tokenStart = ptr;
 
-        int ii = -1, jj = 0, kk = 0;
+    // sign
+        bool l_negative = false;
+        if(*ptr == '-')
+        {
+            l_negative = true;
+            ++ptr;
+        }
+        else if(*ptr == '+')
+        {
+            ++ptr;
+        }
 
+    // mantissa, only the first 19 significant digits are accumulated (exact in a 64 bits integer), the others only shift the exponent
+        quint64 l_mantissa = 0;
+        int l_exp10 = 0, l_nbDigits = 0, l_nbSignificant = 0;
 
-        while (!in.atEnd())
+        while(ptr < end && *ptr >= '0' && *ptr <= '9')
         {
-            QString l_line = in.readLine();
-
-            if(l_line[0] == '#')
+            if(l_nbSignificant < 19)
             {
-                ++ii;
-                jj = 0;
-
-                continue;
+                l_mantissa = l_mantissa * 10 + (*ptr - '0');
+                l_nbSignificant += (l_mantissa > 0);
             }
-            else if(l_line[0] == '\0')
+            else
             {
-                break;
+                ++l_exp10;
             }
+            ++ptr;
+            ++l_nbDigits;
+        }
 
-            inLine.setString(&l_line);
-
-            while(!inLine.atEnd())
+        if(ptr < end && *ptr == '.')
+        {
+            ++ptr;
+            while(ptr < end && *ptr >= '0' && *ptr <= '9')
             {
-                QString l_value;
-                inLine >> l_value;
-
-                if(l_value[0] == '\0')
+                if(l_nbSignificant < 19)
                 {
-                    continue;
+                    l_mantissa = l_mantissa * 10 + (*ptr - '0');
+                    l_nbSignificant += (l_mantissa > 0);
+                    --l_exp10;
                 }
+                ++ptr;
+                ++l_nbDigits;
+            }
+        }
 
-                mat3D[ii].at<double>(jj,kk) = l_value.toDouble();
+    // not a plain number (nan, inf...) : use the C library on the token
+        if(l_nbDigits == 0)
+        {
+            ptr = l_tokenStart;
+            std::string l_token;
+            while(ptr < end && *ptr != ' ' && *ptr != '\t' && *ptr != '\r' && *ptr != '\n')
+            {
+                l_token += *ptr++;
+            }
+            value = strtod(l_token.c_str(), NULL);
+            return true;
+        }
 
-                ++kk;
+    // exponent
+        if(ptr < end && (*ptr == 'e' || *ptr == 'E'))
+        {
+            ++ptr;
+            bool l_negativeExp = false;
+            if(ptr < end && (*ptr == '-' || *ptr == '+'))
+            {
+                l_negativeExp = (*ptr == '-');
+                ++ptr;
             }
 
-            ++jj;
-            kk = 0;
+            int l_exp = 0;
+            while(ptr < end && *ptr >= '0' && *ptr <= '9')
+            {
+                // far beyond the double range, the value is already inf or 0
+                    if(l_exp < 100000)
+                    {
+                        l_exp = l_exp * 10 + (*ptr - '0');
+                    }
+                ++ptr;
+            }
+
+            l_exp10 += l_negativeExp ? -l_exp : l_exp;
         }
-    }
-    else
-    {
-        std::cerr << "Can not open python 3D file. " << std::endl;
-    }
+
+    // scale, out of the table the power is applied in two steps : 10^|exp| alone can be inf (or 0) while the value is representable
+        double l_value = static_cast<double>(l_mantissa);
+        if(l_exp10 >= 0)
+        {
+            if(l_exp10 <= 22)
+            {
+                l_value *= l_pow10[l_exp10];
+            }
+            else
+            {
+                l_value *= pow(10.0, l_exp10 / 2);
+                l_value *= pow(10.0, l_exp10 - l_exp10 / 2);
+            }
+        }
+        else
+        {
+            if(-l_exp10 <= 22)
+            {
+                l_value /= l_pow10[-l_exp10];
+            }
+            else
+            {
+                l_value /= pow(10.0, -l_exp10 / 2);
+                l_value /= pow(10.0, -l_exp10 + l_exp10 / 2);
+            }
+        }
+
+    value = l_negative ? -l_value : l_value;
+
+    return true;
 }
 
+template<typename T>
 /**
- * @brief load3DMatrixFromNpPythonSaveText
- * @param pathFile
- * @param mat3D
+ * @brief parse3DMatrixNpPythonSaveText : parse a 3D matrix saved with the python stimulus format ("# d0 d1 d2" header, "# i" line before each slice),
+ *  the slices are located in a first pass and then parsed in parallel directly in the matrix data.
+ * @param [in] begin   : start of the text buffer
+ * @param [in] end     : end of the text buffer
+ * @param [in] cvType  : CV_32FC1 or CV_64FC1
+ * @param [out] mat3D  : 3D matrix
+ * @return false if the header is invalid
  */
-static void load3DMatrixFromNpPythonSaveText(const QString &pathFile, cv::Mat &mat3D)
+static bool parse3DMatrixNpPythonSaveText(const char *begin, const char *end, const int cvType, cv::Mat &mat3D)
 {
-    QFile l_file(pathFile);
-
-    if(l_file.open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        QTextStream in(&l_file), inLine;
-        in.setRealNumberPrecision(15);
-        inLine.setRealNumberPrecision(15);
+    // read header
+        const char *l_ptr = begin;
+        while(l_ptr < end && (*l_ptr == '#' || *l_ptr == ' '))
+        {
+            ++l_ptr;
+        }
 
         int l_sizesMat[3];
+        for(int ii = 0; ii < 3; ++ii)
+        {
+            double l_size;
+            if(!parseTextReal(l_ptr, end, l_size) || l_size < 0)
+            {
+                std::cerr << "-ERROR : parse3DMatrixNpPythonSaveText -> invalid header. " << std::endl;
+                return false;
+            }
+            l_sizesMat[ii] = static_cast<int>(l_size);
+        }
 
-        QString l_separator, l_size;
-        in >> l_separator;
-        in >> l_size;
-        l_sizesMat[0] = l_size.toInt();
-        in >> l_size;
-        l_sizesMat[1] = l_size.toInt();
-        in >> l_size;
-        l_sizesMat[2] = l_size.toInt();
-
-        QString l_line = in.readLine();
-        l_separator ="";
-
-        mat3D = cv::Mat(3, l_sizesMat, CV_64FC1);
-
-        int ii = -1, jj = 0, kk = 0;
+        mat3D = cv::Mat(3, l_sizesMat, cvType, cv::Scalar(0));
 
+    // retrieve the start of each slice, an empty line ends the data
+        std::vector<const char*> l_slicesStart;
+        l_slicesStart.reserve(l_sizesMat[0]);
 
-        while (!in.atEnd())
+        const char *l_endData = end;
+        bool l_headerLine = true;
+        while(l_ptr < end)
         {
-            QString l_line = in.readLine();
+            const char *l_endLine = static_cast<const char*>(memchr(l_ptr, '\n', end - l_ptr));
+            const char *l_nextLine = l_endLine ? l_endLine + 1 : end;
 
-            if(l_line[0] == '#')
+            if(*l_ptr == '#')
             {
-                ++ii;
-                jj = 0;
-
-                continue;
+                l_slicesStart.push_back(l_nextLine);
             }
-            else if(l_line[0] == '\0')
+            else if(!l_headerLine && (*l_ptr == '\n' || (*l_ptr == '\r' && l_ptr + 1 < end && l_ptr[1] == '\n')))
             {
+                l_endData = l_ptr;
                 break;
             }
 
-            inLine.setString(&l_line);
+            l_headerLine = false;
+            l_ptr = l_nextLine;
+        }
 
-            while(!inLine.atEnd())
+        int l_nbSlices = std::min(static_cast<int>(l_slicesStart.size()), l_sizesMat[0]);
+        if(l_nbSlices < l_sizesMat[0])
+        {
+            std::cerr << "-WARNING : parse3DMatrixNpPythonSaveText -> " << l_nbSlices << " slices found instead of " << l_sizesMat[0] << ". " << std::endl;
+        }
+
+    // parse slices
+        #pragma omp parallel for
+            for(int ii = 0; ii < l_nbSlices; ++ii)
             {
-                QString l_value;
-                inLine >> l_value;
+                const char *l_ptrSlice = l_slicesStart[ii];
+                const char *l_endSlice = (ii + 1 < static_cast<int>(l_slicesStart.size())) ? l_slicesStart[ii+1] : l_endData;
 
-                if(l_value[0] == '\0')
+                for(int jj = 0; jj < l_sizesMat[1] && l_ptrSlice < l_endSlice && *l_ptrSlice != '#'; ++jj)
                 {
-                    continue;
-                }
+                    T *l_row = reinterpret_cast<T*>(mat3D.data + ii * mat3D.step[0] + jj * mat3D.step[1]);
 
-                mat3D.at<double>(ii,jj,kk) = l_value.toDouble();
-                ++kk;
+                    double l_value;
+                    for(int kk = 0; kk < l_sizesMat[2] && parseTextReal(l_ptrSlice, l_endSlice, l_value); ++kk)
+                    {
+                        l_row[kk] = static_cast<T>(l_value);
+                    }
+
+                    // go to the next line
+                        const char *l_endLine = static_cast<const char*>(memchr(l_ptrSlice, '\n', l_endSlice - l_ptrSlice));
+                        l_ptrSlice = l_endLine ? l_endLine + 1 : l_endSlice;
+                }
             }
+        // end omp parallel
 
-            ++jj;
-            kk = 0;
-        }
-    }
-    else
+    return true;
+}
+
+template<typename T>
+/**
+ * @brief load3DMatrixFromNpPythonSaveTextMapped : map the file in memory and parse it with parse3DMatrixNpPythonSaveText
+ * @param [in] pathFile
+ * @param [in] cvType
+ * @param [out] mat3D
+ * @return false if the file can't be read
+ */
+static bool load3DMatrixFromNpPythonSaveTextMapped(const QString &pathFile, const int cvType, cv::Mat &mat3D)
+{
+    QFile l_file(pathFile);
+
+    if(!l_file.open(QIODevice::ReadOnly))
     {
         std::cerr << "Can not open python 3D file. " << std::endl;
+        return false;
     }
-}
 
+    qint64 l_fileSize = l_file.size();
+    uchar *l_mappedData = l_fileSize > 0 ? l_file.map(0, l_fileSize) : NULL;
 
+    bool l_success;
+    if(l_mappedData)
+    {
+        const char *l_begin = reinterpret_cast<const char*>(l_mappedData);
+        l_success = parse3DMatrixNpPythonSaveText<T>(l_begin, l_begin + l_fileSize, cvType, mat3D);
+        l_file.unmap(l_mappedData);
+    }
+    else // the file can't be mapped, read it in one block
+    {
+        QByteArray l_data = l_file.readAll();
+        l_success = parse3DMatrixNpPythonSaveText<T>(l_data.constData(), l_data.constData() + l_data.size(), cvType, mat3D);
+    }
 
+    return l_success;
+}
 
 /**
  * @brief load3DMatrixFromNpPythonSaveText
  * @param pathFile
  * @param mat3D
  */
-static bool load3DMatrixFromNpPythonSaveTextF(const QString &pathFile, cv::Mat &mat3D)
+static void load3DMatrixFromNpPythonSaveText(const QString &pathFile, std::vector<cv::Mat> &mat3D)
 {
     QFile l_file(pathFile);
 
@@ -910,7 +1061,7 @@ static bool load3DMatrixFromNpPythonSaveTextF(const QString &pathFile, cv::Mat &
         QString l_line = in.readLine();
         l_separator ="";
 
-        mat3D = cv::Mat(3, l_sizesMat, CV_32FC1);
+        mat3D = std::vector<cv::Mat>(l_sizesMat[0], cv::Mat(l_sizesMat[1],l_sizesMat[2], CV_64FC1));
 
         int ii = -1, jj = 0, kk = 0;
 
@@ -943,22 +1094,44 @@ static bool load3DMatrixFromNpPythonSaveTextF(const QString &pathFile, cv::Mat &
                     continue;
                 }
 
-                mat3D.at<float>(ii,jj,kk) = l_value.toFloat();
+                mat3D[ii].at<double>(jj,kk) = l_value.toDouble();
+
                 ++kk;
             }
 
             ++jj;
             kk = 0;
         }
-        return true;
     }
     else
     {
         std::cerr << "Can not open python 3D file. " << std::endl;
-        return false;
     }
 }
 
+/**
+ * @brief load3DMatrixFromNpPythonSaveText
+ * @param pathFile
+ * @param mat3D
+ */
+static void load3DMatrixFromNpPythonSaveText(const QString &pathFile, cv::Mat &mat3D)
+{
+    load3DMatrixFromNpPythonSaveTextMapped<double>(pathFile, CV_64FC1, mat3D);
+}
+
+
+
+
+/**
+ * @brief load3DMatrixFromNpPythonSaveTextF
+ * @param pathFile
+ * @param mat3D
+ */
+static bool load3DMatrixFromNpPythonSaveTextF(const QString &pathFile, cv::Mat &mat3D)
+{
+    return load3DMatrixFromNpPythonSaveTextMapped<float>(pathFile, CV_32FC1, mat3D);
+}
+
 /**
  * @brief load3DMatrixFromNpPythonSaveText
  * @param pathFile
@@ -0,0 +1,150 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+/**
+ * \file Vocabulary.h
+ * \brief defines Vocabulary and TokenizedSentences
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#ifndef VOCABULARY_H
+#define VOCABULARY_H
+
+#include "Utility.h"
+#include "gpuMat/configCuda.h"
+
+/**
+ * @brief Sentences of word ids stored without per-sentence allocation
+ */
+struct TokenizedSentences
+{
+    /**
+     * @brief TokenizedSentences constructor : no sentence
+     */
+    TokenizedSentences() : m_offsets(1, 0) {}
+
+    /**
+     * @brief clear all the sentences
+     */
+    void clear()
+    {
+        m_tokens.clear();
+        m_offsets.assign(1, 0);
+    }
+
+    /**
+     * @brief append a sentence
+     * @param [in] ids
+     * @param [in] count : number of words of the sentence
+     */
+    void append(const int *ids, cint count)
+    {
+        m_tokens.insert(m_tokens.end(), ids, ids + count);
+        m_offsets.push_back(static_cast<int>(m_tokens.size()));
+    }
+
+    /**
+     * @brief nbSentences
+     * @return
+     */
+    int nbSentences() const {return static_cast<int>(m_offsets.size()) - 1;}
+
+    /**
+     * @brief length
+     * @param [in] sentence
+     * @return number of words of the sentence
+     */
+    int length(cint sentence) const {return m_offsets[sentence + 1] - m_offsets[sentence];}
+
+    /**
+     * @brief words
+     * @param [in] sentence
+     * @return ids of the words of the sentence, valid until the next append
+     */
+    const int *words(cint sentence) const {return m_tokens.empty() ? NULL : &m_tokens[0] + m_offsets[sentence];}
+
+    std::vector<int> m_tokens;      /**< concatenated word ids of all the sentences */
+    std::vector<int> m_offsets;     /**< first word of each sentence in m_tokens, the last value is the total number of words */
+};
+
+/**
+ * @brief The Vocabulary class
+ * Maps the words of a corpus to dense ids, the words are interned once and the processing is done on the ids.
+ */
+class Vocabulary
+{
+    public :
+
+        /**
+         * @brief clear all the words, the previous ids become invalid
+         */
+        void clear();
+
+        /**
+         * @brief intern : id of a word, the word is added if it's not already in the vocabulary
+         * @param [in] word
+         * @return
+         */
+        int intern(const std::string &word);
+
+        /**
+         * @brief id
+         * @param [in] word
+         * @return id of the word, -1 if it's not in the vocabulary
+         */
+        int id(const std::string &word) const;
+
+        /**
+         * @brief word
+         * @param [in] id
+         * @return
+         */
+        const std::string &word(cint id) const;
+
+        /**
+         * @brief size
+         * @return number of words
+         */
+        int size() const;
+
+        /**
+         * @brief tokenize : intern all the words of the sentences
+         * @param [in] sentences
+         * @param [out] tokens
+         */
+        void tokenize(const Sentences &sentences, TokenizedSentences &tokens);
+
+        /**
+         * @brief sentences : retrieve the words of tokenized sentences
+         * @param [in] tokens
+         * @param [out] sentences
+         */
+        void sentences(const TokenizedSentences &tokens, Sentences &sentences) const;
+
+    private :
+
+        QHash<QByteArray, int> m_ids;       /**< id of each word */
+        std::vector<std::string> m_words;   /**< word of each id */
+};
+
+#endif // VOCABULARY_H
@@ -33,6 +33,9 @@
 
 // Reservoir
 #include "Model.h"
+#include "GridSearch.h"
+#include "TrainingRegistry.h"
+#include "ReservoirSession.h"
 
 // Qt
 #include <QtCore>
@@ -45,6 +48,258 @@
 
 class YarpInterfaceWorker;
 
+/**
+ * @brief A reservoir request received on the yarp ports
+ */
+struct ReservoirJob
+{
+    QString m_id;                       /**< job id, sent back with the results */
+    int m_number;                       /**< job number given by the module, used for the job directory */
+
+    int m_actionToDo;                   /**< what to do ? train 0 / test 1 / both 2 */
+    bool m_binaryResults;               /**< send the results with word ids and raw blobs instead of strings */
+    LinearAlgebraBackend::Type m_cpuBackend; /**< backend of the readout when CUDA is not used */
+    int m_sketchRank;                   /**< rank of the approximate readout, <= 0 for the exact one */
+    int m_solverIterations;             /**< maximum iterations of the conjugate gradient readout, <= 0 for the closed-form one */
+    int m_streamChunkSize;              /**< sentences per chunk of the streaming training, <= 0 to load the whole corpus */
+    int m_streamEpochs;                 /**< epochs of the streaming training */
+    double m_streamLearningRate;        /**< learning rate of the streaming training */
+    QString m_corpus;                   /**< content of the corpus */
+    ModelParameters m_parameters;       /**< parameters of the model */
+    Sentence m_CCW;                     /**< CCW sentence */
+    Sentence m_structure;               /**< structure sentence */
+
+    QString m_pathTrainingToBeSaved;    /**< path for saving the training */
+    QString m_pathWToBeSaved;           /**< path for saving the W matrice */
+    QString m_pathWInToBeSaved;         /**< path for saving the WIn matrice */
+    QString m_pathTrainingToBeLoaded;   /**< path for loading the training */
+    QString m_pathWToBeLoaded;          /**< path for loading the W matrice */
+    QString m_pathWInToBeLoaded;        /**< path for loading the WIn matrice */
+};
+
+/**
+ * @brief Bounded FIFO of reservoir jobs, filled by the yarp worker and emptied by the job workers
+ */
+class ReservoirJobQueue
+{
+    public :
+
+        /**
+         * @brief Constructor of ReservoirJobQueue
+         * @param [in] capacity : maximum number of waiting jobs
+         */
+        ReservoirJobQueue(cint capacity);
+
+        /**
+         * @brief push a job, never blocks
+         * @param [in] job
+         * @return false if the queue is full or closed
+         */
+        bool push(const ReservoirJob &job);
+
+        /**
+         * @brief push all the jobs of a grid search, they are admitted together if the queue is not full, even beyond its capacity
+         * @param [in] jobs
+         * @return false if the queue is full or closed
+         */
+        bool pushAll(const QVector<ReservoirJob> &jobs);
+
+        /**
+         * @brief remove the waiting jobs with this id, or belonging to the grid search with this id
+         * @param [in] id
+         * @return number of removed jobs
+         */
+        int remove(const QString &id);
+
+        /**
+         * @brief pop the oldest job, blocks until a job is available or the queue is closed
+         * @param [out] job
+         * @return false if the queue has been closed
+         */
+        bool pop(ReservoirJob &job);
+
+        /**
+         * @brief close the queue and wake up all the waiting workers
+         */
+        void close();
+
+        /**
+         * @brief size
+         * @return number of waiting jobs
+         */
+        int size();
+
+    private :
+
+        int m_capacity;                 /**< maximum number of waiting jobs */
+        bool m_closed;                  /**< is the queue closed ? */
+        QQueue<ReservoirJob> m_jobs;    /**< waiting jobs */
+        QMutex m_lock;                  /**< mutex lock for the queue */
+        QWaitCondition m_jobAvailable;  /**< wake up the workers when a job is pushed */
+};
+
+/**
+ * @brief Thread executing the jobs of the queue with its own model
+ */
+class ReservoirJobWorker : public QThread
+{
+    public :
+
+        /**
+         * @brief Constructor of ReservoirJobWorker
+         * @param [in] queue        : jobs queue
+         * @param [in] registry     : resident trainings used for the tests
+         * @param [in] yarpWorker   : yarp worker used for sending the results
+         * @param [in] absolutePath : absolute path initialized at the launching
+         */
+        ReservoirJobWorker(ReservoirJobQueue *queue, TrainingRegistry *registry, YarpInterfaceWorker *yarpWorker, const QString &absolutePath);
+
+        /**
+         * @brief cancel the current job if it has this id or belongs to the grid search with this id, can be called from any thread
+         * @param [in] id
+         * @return true if the current job has been cancelled
+         */
+        bool cancel(const QString &id);
+
+    protected :
+
+        /**
+         * @brief run : execute the jobs until the queue is closed
+         */
+        void run();
+
+    private :
+
+        /**
+         * @brief processJob
+         * @param [in,out] model : model of the worker
+         * @param [in] job
+         */
+        void processJob(Model &model, const ReservoirJob &job);
+
+        /**
+         * @brief isCancelled
+         * @return true if the current job has been cancelled
+         */
+        bool isCancelled();
+
+        ReservoirJobQueue *m_queue;         /**< jobs queue */
+        TrainingRegistry *m_registry;       /**< resident trainings */
+        YarpInterfaceWorker *m_yarpWorker;  /**< yarp worker */
+        QString m_absolutePath;             /**< absolute path initialized at the launching */
+
+        QString m_currentJobId;             /**< id of the job being computed */
+        Model *m_currentModel;              /**< model computing the current job, NULL between the jobs */
+        bool m_currentCancelled;            /**< has the current job been cancelled ? */
+        QMutex m_currentLock;               /**< mutex lock for the current job */
+};
+
+/**
+ * @brief A command received on the stream port
+ */
+struct StreamRequest
+{
+    QString m_command;                  /**< open / step / reset / close */
+    QString m_sessionId;                /**< id of the session */
+    QString m_training;                 /**< name or directory of the training (open) */
+    std::vector<float> m_input;         /**< input of the timestep (step) */
+};
+
+/**
+ * @brief Thread executing the stream requests, the steps received during the batching window are computed together :
+ *  the steps of the sessions sharing the same training are done with one product per matrix and the readouts are sent to each session.
+ *  The requests of a session are always executed in their order of arrival.
+ */
+class ReservoirStreamBatcher : public QThread
+{
+    public :
+
+        /**
+         * @brief Constructor of ReservoirStreamBatcher
+         * @param [in] registry     : resident trainings used by the sessions
+         * @param [in] outputPort   : port for sending the answers, only written by this thread
+         * @param [in] windowMs     : time waited after a request for collecting the next ones, 0 : only the requests already received are batched
+         * @param [in] maxBatchSize : maximum number of steps computed together
+         */
+        ReservoirStreamBatcher(TrainingRegistry *registry, yarp::os::BufferedPort<yarp::os::Bottle> *outputPort, cint windowMs, cint maxBatchSize);
+
+        /**
+         * @brief Destructor of ReservoirStreamBatcher
+         */
+        ~ReservoirStreamBatcher();
+
+        /**
+         * @brief push a request, called by the reading thread of the stream port
+         * @param [in] request
+         */
+        void push(const StreamRequest &request);
+
+        /**
+         * @brief close : the pending requests are executed and the thread ends
+         */
+        void close();
+
+    protected :
+
+        /**
+         * @brief run : execute the requests until the batcher is closed
+         */
+        void run();
+
+    private :
+
+        /**
+         * @brief takeRequests : wait for a request and for the batching window
+         * @param [out] requests
+         * @return false if the batcher is closed and there is no more request
+         */
+        bool takeRequests(QVector<StreamRequest> &requests);
+
+        /**
+         * @brief execute the requests, the steps are accumulated until a command of another type or a second step of the same session
+         * @param [in] requests
+         */
+        void processRequests(const QVector<StreamRequest> &requests);
+
+        /**
+         * @brief compute the accumulated steps and send their readouts
+         */
+        void flushSteps();
+
+        /**
+         * @brief openSession : create a streaming session with a training of the registry
+         * @param [in] sessionId
+         * @param [in] training : name or directory of the training
+         * @return the error message, empty if the session is opened
+         */
+        QString openSession(const QString &sessionId, const QString &training);
+
+        /**
+         * @brief sendError
+         * @param [in] sessionId
+         * @param [in] message
+         */
+        void sendError(const QString &sessionId, const QString &message);
+
+        TrainingRegistry *m_registry;                           /**< resident trainings */
+        yarp::os::BufferedPort<yarp::os::Bottle> *m_outputPort; /**< port for sending the answers */
+
+        int m_windowMs;                             /**< batching window */
+        int m_maxBatchSize;                         /**< maximum number of steps computed together */
+
+        bool m_closed;                              /**< is the batcher closed ? */
+        QVector<StreamRequest> m_pending;           /**< requests waiting for the batcher */
+        QMutex m_lock;                              /**< mutex lock for the pending requests */
+        QWaitCondition m_requestAvailable;          /**< wake up the batcher when a request is pushed */
+
+        QMap<QString, ReservoirSession*> m_sessions;    /**< streaming sessions, only used by the batcher thread */
+
+        std::vector<ReservoirSession*> m_stepSessions;  /**< sessions of the accumulated steps */
+        std::vector<const StreamRequest*> m_steps;      /**< accumulated steps */
+        std::vector<std::vector<float> > m_outputs;     /**< readouts of the accumulated steps */
+        ReservoirSessionBatch m_batch;                  /**< buffers of the batched products */
+};
+
 /**
  * @brief The ReservoirInterface class
  */
@@ -58,8 +313,14 @@ class ReservoirInterface : public QObject
         /**
          * @brief Constructor of ReservoirInterface
          * @param parent
+         * @param workersNumber : number of jobs computed at the same time
+         * @param queueCapacity : maximum number of waiting jobs
+         * @param registryBudgetMB : memory budget of the resident trainings
+         * @param batchWindowMs : batching window of the stream requests
+         * @param maxBatchSize : maximum number of stream steps computed together
          */
-        ReservoirInterface(QCoreApplication *parent);
+        ReservoirInterface(QCoreApplication *parent, cint workersNumber = 1, cint queueCapacity = 16, cint registryBudgetMB = 1024,
+                           cint batchWindowMs = 0, cint maxBatchSize = 32);
 
         /**
          * @brief Destructor of ReservoirInterface
@@ -67,26 +328,6 @@ class ReservoirInterface : public QObject
         ~ReservoirInterface();
 
 
-    public slots :
-
-        /**
-         * @brief startReservoir
-         * @param actionToDo
-         * @param parameters
-         * @param CCW
-         * @param structure
-         * @param pathTrainingFileToBeSaved
-         * @param pathWMatriceFileToBeSaved
-         * @param pathWInMatriceFileToBeSaved
-         * @param pathTrainingFileToBeLoaded
-         * @param pathWMatriceFileToBeLoaded
-         * @param pathWInMatriceFileToBeLoaded
-         */
-        void startReservoir(int actionToDo, ModelParameters parameters,Sentence CCW,Sentence structure,
-                            QString pathTrainingFileToBeSaved, QString pathWMatriceFileToBeSaved, QString pathWInMatriceFileToBeSaved,
-                            QString pathTrainingFileToBeLoaded, QString pathWMatriceFileToBeLoaded, QString pathWInMatriceFileToBeLoaded);
-
-
     signals :
 
         /**
@@ -99,22 +340,51 @@ class ReservoirInterface : public QObject
          */
         void stop();
 
-        /**
-         * @brief endReservoirComputing
-         */
-        void endReservoirComputing(QVector<std::vector<double> > , QVector<std::vector<double> >, Sentences, Sentences, Sentences);
-
     private :
 
+        ReservoirJobQueue m_jobQueue;               /**< jobs waiting for a worker */
+        TrainingRegistry m_registry;                /**< resident trainings shared by the workers */
+        QVector<ReservoirJobWorker*> m_jobWorkers;  /**< workers executing the jobs */
+
         YarpInterfaceWorker  *m_yarpWorker; /**< yarp worker */
         QThread         m_yarpWorkerThread; /**< yarp worker thread */
 
-        Model m_model;                      /**< model of the reservoir */
         QString m_absolutePath;             /**< absolute path initialied at the launching */
 };
 
 /**
- * @brief The YarpInterfaceWorker class
+ * @brief Yarp input port of the worker, the received bottles are forwarded to the worker by the reading thread of the port (no polling)
+ */
+class YarpWorkerInputPort : public yarp::os::BufferedPort<yarp::os::Bottle>
+{
+    public :
+
+        /**
+         * @brief The PortType enum
+         */
+        enum PortType{PARAMETERS,CONTROL,STREAM};
+
+        /**
+         * @brief Constructor of YarpWorkerInputPort
+         * @param [in] worker : worker receiving the bottles
+         * @param [in] type   : type of the port
+         */
+        YarpWorkerInputPort(YarpInterfaceWorker *worker, const PortType type);
+
+        /**
+         * @brief onRead, called by the yarp reading thread when a bottle is received
+         * @param [in] bottle
+         */
+        virtual void onRead(yarp::os::Bottle &bottle);
+
+    private :
+
+        YarpInterfaceWorker *m_worker;  /**< worker receiving the bottles */
+        PortType m_type;                /**< type of the port */
+};
+
+/**
+ * @brief The YarpInterfaceWorker class, receives the requests and sends the results of the jobs
  */
 class YarpInterfaceWorker : public QObject
 {
@@ -124,8 +394,13 @@ class YarpInterfaceWorker : public QObject
 
         /**
          * \brief Constructor of YarpInterfaceWorker
+         * @param [in] absolutePath : absolute path initialized at the launching
+         * @param [in] jobQueue     : queue receiving the jobs
+         * @param [in] registry     : resident trainings, managed with the control port
+         * @param [in] batchWindowMs: batching window of the stream requests
+         * @param [in] maxBatchSize : maximum number of stream steps computed together
          */
-        YarpInterfaceWorker(QString absolutePath);
+        YarpInterfaceWorker(QString absolutePath, ReservoirJobQueue *jobQueue, TrainingRegistry *registry, cint batchWindowMs, cint maxBatchSize);
 
 
         /**
@@ -133,72 +408,133 @@ class YarpInterfaceWorker : public QObject
          */
         ~YarpInterfaceWorker();
 
+        /**
+         * @brief receiveParameters, called from the yarp reading thread of the parameters port
+         * @param [in] parametersBottle
+         */
+        void receiveParameters(yarp::os::Bottle &parametersBottle);
+
+        /**
+         * @brief receiveControl, called from the yarp reading thread of the control port
+         * @param [in] controlBottle
+         */
+        void receiveControl(yarp::os::Bottle &controlBottle);
+
+        /**
+         * @brief receiveStream, called from the yarp reading thread of the stream port, the request is executed by the stream batcher
+         *  ("open" session training) / ("step" session u0 u1 ...) / ("reset" session) / ("close" session)
+         * @param [in] streamBottle
+         */
+        void receiveStream(yarp::os::Bottle &streamBottle);
+
+        /**
+         * @brief sendResults, can be called from any job worker
+         * @param [in] jobId
+         * @param [in] binary : binary encoding (vocabulary + word ids + raw double blobs) or the strings of the first versions
+         * @param [in] resultsTrain
+         * @param [in] resultsTests
+         * @param [in] model : sentences and results of the job, and their vocabulary
+         */
+        void sendResults(const QString &jobId, cbool binary, const QVector<std::vector<double> > &resultsTrain, const QVector<std::vector<double> > &resultsTests,
+                         const Model &model);
+
+        /**
+         * @brief sendError, can be called from any thread
+         * @param [in] jobId
+         * @param [in] message
+         */
+        void sendError(const QString &jobId, const QString &message);
+
+        /**
+         * @brief setJobWorkers : workers notified of the cancellations, must be called before the listening starts
+         * @param [in] workers
+         */
+        void setJobWorkers(const QVector<ReservoirJobWorker*> &workers);
+
     private :
 
         /**
          * @brief readParameters
-         * @param parametersBottle
+         * @param [in] parametersBottle
+         * @param [out] job : job filled with the parameters
          */
-        void readParameters(yarp::os::Bottle *parametersBottle);
+        void readParameters(yarp::os::Bottle *parametersBottle, ReservoirJob &job);
 
-    public slots:
+        /**
+         * @brief keep a start or grid control received before the parameters of its job id, must be called with the request lock
+         * @param [in] jobId
+         * @param [in] controlBottle
+         * @param [in,out] evicted : ids dropped to keep the new one
+         * @return false if too many controls are already waiting for this job id
+         */
+        bool keepEarlyControl(const QString &jobId, const yarp::os::Bottle &controlBottle, QStringList &evicted);
 
         /**
-         * @brief doLoop
+         * @brief mark a job id as the most recently used one and drop the parameters and the early controls of the least recently used ids
+         *  over the bound, must be called with the request lock
+         * @param [in] jobId
+         * @param [in,out] evicted : ids dropped
          */
-        void doLoop();
+        void useRequestId(const QString &jobId, QStringList &evicted);
 
         /**
-         * @brief stopLoop
+         * @brief send an error for each dropped job id, must be called without the request lock
+         * @param [in] evicted
          */
-        void stopLoop();
+        void sendEvicted(const QStringList &evicted);
 
         /**
-         * @brief updateResultsFromReservoir
-         * @param resultsTrain
-         * @param resultsTests
-         * @param trainSentences
-         * @param trainResults
-         * @param testResults
+         * @brief manage the registry commands of the control port : ("load" name path) / ("unload" name) / ("list")
+         * @param [in] controlBottle
          */
-        void updateResultsFromReservoir(QVector<std::vector<double> > resultsTrain, QVector<std::vector<double> > resultsTests, Sentences trainSentences, Sentences trainResults, Sentences testResults);
+        void registryCommand(yarp::os::Bottle &controlBottle);
 
+        /**
+         * @brief submit a grid search : ("grid" gridId (parameter start end operation [onlyStart]) ...),
+         *  the other parameters come from the parameters bottle sent with the job id gridId, each point is a job with the id gridId/index
+         * @param [in] controlBottle
+         */
+        void submitGrid(yarp::os::Bottle &controlBottle);
 
-    signals :
+        /**
+         * @brief cancel a job or a grid search : ("cancel" id), the waiting jobs are removed and the running ones are stopped
+         * @param [in] controlBottle
+         */
+        void cancelJobs(yarp::os::Bottle &controlBottle);
+
+    public slots:
 
         /**
-         * @brief sendDataToReservoirSignal
+         * @brief startListening : enable the callbacks of the input ports
          */
-        void sendDataToReservoirSignal(int, ModelParameters, Sentence, Sentence, QString, QString, QString, QString, QString, QString);
+        void startListening();
 
+        /**
+         * @brief stopListening : disable the callbacks and wake up the reading threads of the input ports
+         */
+        void stopListening();
 
     private :
 
-        bool m_doLoop;              /**< do the main loop ? */
-        bool m_isParameters;        /**< is parameters received ? */
-        bool m_reservoirIsRunning;  /**< is the reservoir running ? */
-        bool m_startReservoir;      /**< start the reservoir ? */
-
         QString m_absolutePath;     /**< absolute path initialized at the launching */
 
-        QReadWriteLock m_loopLock;      /**< mutex lock for the loop */
-        QReadWriteLock m_reservoirLock; /**< mutex lock for the reservoir */
+        int m_jobsCounter;                          /**< number of jobs received */
+        QMap<QString, ReservoirJob> m_pendingJobs;  /**< last parameters received for each client job id, waiting for a control bottle */
+        QMap<QString, QList<yarp::os::Bottle> > m_earlyControls; /**< start and grid controls received before the parameters of their job id */
+        QStringList m_requestIds;                   /**< ids of m_pendingJobs and m_earlyControls, from the least to the most recently used */
+        ReservoirJobQueue *m_jobQueue;              /**< queue receiving the jobs */
+        QVector<ReservoirJobWorker*> m_jobWorkers;  /**< workers executing the jobs */
+        TrainingRegistry *m_registry;               /**< resident trainings */
 
-        yarp::os::BufferedPort<yarp::os::Bottle> m_controlPort;     /**< port for receiving control data */
-        yarp::os::BufferedPort<yarp::os::Bottle> m_parametersPort;  /**< port for receiving parameters data */
-        yarp::os::BufferedPort<yarp::os::Bottle> m_resultsPort;     /**< port for sending results data */
+        QMutex m_requestLock;       /**< mutex lock for the pending jobs, shared by the yarp reading threads */
+        QMutex m_resultsLock;       /**< mutex lock for the results port, shared by the job workers */
 
-        int m_actionToDo;                               /**< what to do ? train 0 / test 1 / both 2 */
-        ModelParameters m_currentModelParameters;       /**< last parameters received for the model */
-        Sentence m_CCWSentence;                         /**< current CCW sentence */
-        Sentence m_structureSentence;                   /**< current structure sentence */
-        QString m_pathTrainingToBeSaved;                /**< path for saving the training */
-        QString m_pathWToBeSaved;                       /**< path for saving the W matrice */
-        QString m_pathWInToBeSaved;                     /**< path for saving the WIn matrice */
-
-        QString m_pathTrainingToBeLoaded;               /**< path for loading the training */
-        QString m_pathWToBeLoaded;                      /**< path for loading the W matrice */
-        QString m_pathWInToBeLoaded;                    /**< path for loading the WIn matrice */
+        YarpWorkerInputPort m_controlPort;                          /**< port for receiving control data */
+        YarpWorkerInputPort m_parametersPort;                       /**< port for receiving parameters data */
+        yarp::os::BufferedPort<yarp::os::Bottle> m_resultsPort;     /**< port for sending results data */
+        YarpWorkerInputPort m_streamPort;                           /**< port for receiving the streaming requests */
+        yarp::os::BufferedPort<yarp::os::Bottle> m_streamOutPort;   /**< port for sending the streaming answers */
+        ReservoirStreamBatcher m_streamBatcher;                     /**< executes the stream requests */
 };
 
 
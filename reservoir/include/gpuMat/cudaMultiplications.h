@@ -33,6 +33,7 @@
 
 // CUDA
 #include "gpuMat/configCuda.h"
+#include "CancellationToken.h"
 
 // OPENCV
 #include "opencv2/imgproc/imgproc.hpp"
@@ -380,8 +381,9 @@ namespace swCuda
         * @param oMatB
         * @param oMatRes
         * @param i32SizeMatBlock
+        * @param cancel : if not NULL, checked before each block product, the result is incomplete if it's cancelled
         */
-        static void blockMatrixMultiplicationD(const cv::Mat &oMatA, const  cv::Mat &oMatB, cv::Mat &oMatRes, cint i32SizeMatBlock = 2)
+        static void blockMatrixMultiplicationD(const cv::Mat &oMatA, const  cv::Mat &oMatB, cv::Mat &oMatRes, cint i32SizeMatBlock = 2, const CancellationToken *cancel = NULL)
         {
             int l_i32SizeMatBlock    = i32SizeMatBlock;
             int l_i32SizeMatDivBlock = l_i32SizeMatBlock * BLOCKSIZE;
@@ -432,6 +434,11 @@ namespace swCuda
                             // compute Cij
                             for(int kk = 0; kk < l_i32SizeMatBlock; ++kk)
                             {
+                                if(cancel && cancel->isCancelled())
+                                {
+                                    break;
+                                }
+
                                 block<double>(oMatA, subA.elements, ii, kk, subA.height, subA.width);
 
                                 block<double>(oMatB, subB.elements, kk, jj, subB.height, subB.width);
@@ -464,8 +471,9 @@ namespace swCuda
          * @param oMatB
          * @param oMatRes
          * @param i32SizeMatBlock
+         * @param cancel : if not NULL, checked before each block product, the result is incomplete if it's cancelled
          */
-        static void blockMatrixMultiplicationF(const cv::Mat &oMatA, const  cv::Mat &oMatB, cv::Mat &oMatRes, cint i32SizeMatBlock = 2)
+        static void blockMatrixMultiplicationF(const cv::Mat &oMatA, const  cv::Mat &oMatB, cv::Mat &oMatRes, cint i32SizeMatBlock = 2, const CancellationToken *cancel = NULL)
         {
             int l_i32SizeMatBlock    = i32SizeMatBlock;
             int l_i32SizeMatDivBlock = l_i32SizeMatBlock * BLOCKSIZE;
@@ -516,6 +524,11 @@ namespace swCuda
                             // compute Cij
                             for(int kk = 0; kk < l_i32SizeMatBlock; ++kk)
                             {
+                                if(cancel && cancel->isCancelled())
+                                {
+                                    break;
+                                }
+
                                 block<float>(oMatA, subA.elements, ii, kk, subA.height, subA.width);
 
                                 block<float>(oMatB, subB.elements, kk, jj, subB.height, subB.width);
@@ -549,16 +562,17 @@ namespace swCuda
          * @param oMatB
          * @param oMatRes
          * @param i32SizeMatBlock
+         * @param cancel
          */
-        static void blockMatrixMultiplication(const cv::Mat &oMatA, const  cv::Mat &oMatB, cv::Mat &oMatRes, cint i32SizeMatBlock = 2)
+        static void blockMatrixMultiplication(const cv::Mat &oMatA, const  cv::Mat &oMatB, cv::Mat &oMatRes, cint i32SizeMatBlock = 2, const CancellationToken *cancel = NULL)
         {
             if(typeid(float) == typeid(T))
             {
-                blockMatrixMultiplicationF(oMatA,oMatB,oMatRes,i32SizeMatBlock);
+                blockMatrixMultiplicationF(oMatA,oMatB,oMatRes,i32SizeMatBlock,cancel);
             }
             else if(typeid(double) == typeid(T))
             {
-                blockMatrixMultiplicationD(oMatA,oMatB,oMatRes,i32SizeMatBlock);
+                blockMatrixMultiplicationD(oMatA,oMatB,oMatRes,i32SizeMatBlock,cancel);
             }
             else
             {
@@ -0,0 +1,478 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+/**
+ * \file CorpusCache.cpp
+ * \brief defines CompiledCorpus and CorpusCache
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#include "CorpusCache.h"
+
+static QMutex g_instanceLock;               /**< lock for creating the shared cache */
+static CorpusCache *g_instance = NULL;      /**< shared cache, kept until the end of the process */
+static const int g_maxCorpora = 8;          /**< maximum number of corpora kept in memory */
+
+/**
+ * @brief Header of the compiled corpus files, followed by the word offsets, the offsets and tokens of each part and the word characters
+ */
+struct CompiledCorpusHeader
+{
+    char m_magic[8];                            /**< "RSVCORP1" */
+    qint64 m_sourceTime;                        /**< modification time of the text file */
+    qint64 m_sourceSize;                        /**< size of the text file */
+    quint64 m_contentHash;                      /**< hash of the text file */
+    qint32 m_nbWords;                           /**< size of the vocabulary */
+    qint32 m_wordsBytes;                        /**< total size of the words */
+    qint32 m_nbSentences[CORPUS_PARTS_NB];      /**< number of lines of each part */
+    qint32 m_nbTokens[CORPUS_PARTS_NB];         /**< number of words of each part */
+};
+
+static const char g_compiledCorpusMagic[8] = {'R','S','V','C','O','R','P','1'};
+
+/**
+ * @brief FNV-1a hash of a buffer
+ * @param [in] data
+ * @return
+ */
+static quint64 fileContentHash(const QByteArray &data)
+{
+    quint64 l_hash = Q_UINT64_C(14695981039346656037);
+    for(int ii = 0; ii < data.size(); ++ii)
+    {
+        l_hash = (l_hash ^ static_cast<uchar>(data[ii])) * Q_UINT64_C(1099511628211);
+    }
+
+    return l_hash;
+}
+
+/**
+ * @brief validOffsets
+ * @param [in] offsets
+ * @param [in] nbOffsets
+ * @param [in] end : size of the indexed array
+ * @return true if the offsets are positive, monotonic and not greater than end
+ */
+static bool validOffsets(const qint32 *offsets, cint nbOffsets, cint end)
+{
+    if(offsets[0] < 0 || offsets[nbOffsets - 1] > end)
+    {
+        return false;
+    }
+
+    for(int ii = 1; ii < nbOffsets; ++ii)
+    {
+        if(offsets[ii] < offsets[ii - 1])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool compileCorpus(const QString &pathFileCorpus, CompiledCorpus &corpus)
+{
+    QFile l_file(pathFileCorpus);
+    if(!l_file.open(QIODevice::ReadOnly))
+    {
+        std::cerr << "-ERROR : compileCorpus -> can not open corpus file " << pathFileCorpus.toStdString() << std::endl;
+        return false;
+    }
+
+    QFileInfo l_info(pathFileCorpus);
+    corpus.m_contentHash = fileContentHash(l_file.readAll());
+    corpus.m_sourceTime  = l_info.lastModified().toMSecsSinceEpoch();
+    corpus.m_sourceSize  = l_info.size();
+    l_file.close();
+
+    // parse the text once and intern all the words
+        QVector<QStringList> l_parts[CORPUS_PARTS_NB];
+        extractAllDataFromCorpusFile(pathFileCorpus, l_parts[CORPUS_TRAIN_DATA], l_parts[CORPUS_TRAIN_INFO], l_parts[CORPUS_TRAIN_MEANING],
+                                                     l_parts[CORPUS_TEST_DATA],  l_parts[CORPUS_TEST_INFO],  l_parts[CORPUS_TEST_MEANING]);
+
+        corpus.m_vocabulary.clear();
+        std::vector<int> l_ids;
+        for(int ii = 0; ii < CORPUS_PARTS_NB; ++ii)
+        {
+            corpus.m_parts[ii].clear();
+            for(int jj = 0; jj < l_parts[ii].size(); ++jj)
+            {
+                l_ids.resize(l_parts[ii][jj].size());
+                for(int kk = 0; kk < l_parts[ii][jj].size(); ++kk)
+                {
+                    l_ids[kk] = corpus.m_vocabulary.intern(l_parts[ii][jj][kk].toStdString());
+                }
+                corpus.m_parts[ii].append(l_ids.empty() ? NULL : &l_ids[0], static_cast<int>(l_ids.size()));
+            }
+        }
+
+    return true;
+}
+
+bool saveCompiledCorpus(const QString &pathFile, const CompiledCorpus &corpus)
+{
+    CompiledCorpusHeader l_header;
+    memset(&l_header, 0, sizeof(CompiledCorpusHeader));
+    memcpy(l_header.m_magic, g_compiledCorpusMagic, sizeof(g_compiledCorpusMagic));
+    l_header.m_sourceTime  = corpus.m_sourceTime;
+    l_header.m_sourceSize  = corpus.m_sourceSize;
+    l_header.m_contentHash = corpus.m_contentHash;
+    l_header.m_nbWords     = corpus.m_vocabulary.size();
+
+    std::vector<qint32> l_wordsOffsets(1, 0);
+    QByteArray l_words;
+    for(int ii = 0; ii < corpus.m_vocabulary.size(); ++ii)
+    {
+        const std::string &l_word = corpus.m_vocabulary.word(ii);
+        l_words.append(l_word.data(), static_cast<int>(l_word.size()));
+        l_wordsOffsets.push_back(l_words.size());
+    }
+    l_header.m_wordsBytes = l_words.size();
+
+    for(int ii = 0; ii < CORPUS_PARTS_NB; ++ii)
+    {
+        l_header.m_nbSentences[ii] = corpus.m_parts[ii].nbSentences();
+        l_header.m_nbTokens[ii]    = static_cast<qint32>(corpus.m_parts[ii].m_tokens.size());
+    }
+
+    QFile l_file(pathFile);
+    if(!l_file.open(QIODevice::WriteOnly))
+    {
+        std::cerr << "-ERROR : saveCompiledCorpus -> can not write compiled corpus " << pathFile.toStdString() << std::endl;
+        return false;
+    }
+
+    bool l_success = l_file.write(reinterpret_cast<const char*>(&l_header), sizeof(CompiledCorpusHeader)) == sizeof(CompiledCorpusHeader);
+    l_success = l_success && l_file.write(reinterpret_cast<const char*>(&l_wordsOffsets[0]), l_wordsOffsets.size() * sizeof(qint32)) == static_cast<qint64>(l_wordsOffsets.size() * sizeof(qint32));
+
+    for(int ii = 0; ii < CORPUS_PARTS_NB && l_success; ++ii)
+    {
+        const TokenizedSentences &l_part = corpus.m_parts[ii];
+        qint64 l_offsetsSize = l_part.m_offsets.size() * sizeof(int), l_tokensSize = l_part.m_tokens.size() * sizeof(int);
+
+        l_success = l_file.write(reinterpret_cast<const char*>(&l_part.m_offsets[0]), l_offsetsSize) == l_offsetsSize;
+        l_success = l_success && (l_tokensSize == 0 || l_file.write(reinterpret_cast<const char*>(&l_part.m_tokens[0]), l_tokensSize) == l_tokensSize);
+    }
+
+    l_success = l_success && l_file.write(l_words) == l_words.size();
+
+    if(!l_success)
+    {
+        std::cerr << "-ERROR : saveCompiledCorpus -> can not write compiled corpus " << pathFile.toStdString() << std::endl;
+        l_file.close();
+        l_file.remove();
+    }
+
+    return l_success;
+}
+
+bool loadCompiledCorpus(const QString &pathFile, CompiledCorpus &corpus)
+{
+    QFile l_file(pathFile);
+    if(!l_file.exists() || !l_file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    qint64 l_fileSize = l_file.size();
+    if(l_fileSize < static_cast<qint64>(sizeof(CompiledCorpusHeader)))
+    {
+        return false;
+    }
+
+    const uchar *l_data = l_file.map(0, l_fileSize);
+    if(!l_data)
+    {
+        std::cerr << "-ERROR : loadCompiledCorpus -> can not map compiled corpus " << pathFile.toStdString() << std::endl;
+        return false;
+    }
+
+    // header and total size
+        CompiledCorpusHeader l_header;
+        memcpy(&l_header, l_data, sizeof(CompiledCorpusHeader));
+
+        bool l_valid = memcmp(l_header.m_magic, g_compiledCorpusMagic, sizeof(g_compiledCorpusMagic)) == 0 && l_header.m_nbWords >= 0 && l_header.m_wordsBytes >= 0;
+        qint64 l_expectedSize = sizeof(CompiledCorpusHeader) + (static_cast<qint64>(l_header.m_nbWords) + 1) * sizeof(qint32) + l_header.m_wordsBytes;
+        for(int ii = 0; ii < CORPUS_PARTS_NB; ++ii)
+        {
+            l_valid = l_valid && l_header.m_nbSentences[ii] >= 0 && l_header.m_nbTokens[ii] >= 0;
+            l_expectedSize += (static_cast<qint64>(l_header.m_nbSentences[ii]) + 1 + l_header.m_nbTokens[ii]) * sizeof(qint32);
+        }
+
+        if(!l_valid || l_expectedSize != l_fileSize)
+        {
+            std::cerr << "-ERROR : loadCompiledCorpus -> invalid compiled corpus " << pathFile.toStdString() << std::endl;
+            l_file.unmap(const_cast<uchar*>(l_data));
+            return false;
+        }
+
+    // flat arrays, the offsets and the ids are checked before being used for reading the arrays
+        const qint32 *l_wordsOffsets = reinterpret_cast<const qint32*>(l_data + sizeof(CompiledCorpusHeader));
+        const qint32 *l_current      = l_wordsOffsets + l_header.m_nbWords + 1;
+
+        l_valid = validOffsets(l_wordsOffsets, l_header.m_nbWords + 1, l_header.m_wordsBytes);
+        for(int ii = 0; ii < CORPUS_PARTS_NB && l_valid; ++ii)
+        {
+            const qint32 *l_offsets = l_current, *l_tokens = l_current + l_header.m_nbSentences[ii] + 1;
+            l_valid = validOffsets(l_offsets, l_header.m_nbSentences[ii] + 1, l_header.m_nbTokens[ii]) && l_offsets[l_header.m_nbSentences[ii]] == l_header.m_nbTokens[ii];
+            for(int jj = 0; jj < l_header.m_nbTokens[ii] && l_valid; ++jj)
+            {
+                l_valid = l_tokens[jj] >= 0 && l_tokens[jj] < l_header.m_nbWords;
+            }
+            l_current = l_tokens + l_header.m_nbTokens[ii];
+        }
+
+        if(!l_valid)
+        {
+            std::cerr << "-ERROR : loadCompiledCorpus -> invalid arrays in compiled corpus " << pathFile.toStdString() << std::endl;
+            l_file.unmap(const_cast<uchar*>(l_data));
+            return false;
+        }
+
+        l_current = l_wordsOffsets + l_header.m_nbWords + 1;
+        for(int ii = 0; ii < CORPUS_PARTS_NB; ++ii)
+        {
+            corpus.m_parts[ii].m_offsets.assign(l_current, l_current + l_header.m_nbSentences[ii] + 1);
+            l_current += l_header.m_nbSentences[ii] + 1;
+            corpus.m_parts[ii].m_tokens.assign(l_current, l_current + l_header.m_nbTokens[ii]);
+            l_current += l_header.m_nbTokens[ii];
+        }
+
+        const char *l_words = reinterpret_cast<const char*>(l_current);
+        corpus.m_vocabulary.clear();
+        for(int ii = 0; ii < l_header.m_nbWords; ++ii)
+        {
+            corpus.m_vocabulary.intern(std::string(l_words + l_wordsOffsets[ii], l_wordsOffsets[ii + 1] - l_wordsOffsets[ii]));
+        }
+
+    corpus.m_sourceTime  = l_header.m_sourceTime;
+    corpus.m_sourceSize  = l_header.m_sourceSize;
+    corpus.m_contentHash = l_header.m_contentHash;
+
+    l_file.unmap(const_cast<uchar*>(l_data));
+    return true;
+}
+
+CorpusCache::~CorpusCache()
+{
+    qDeleteAll(m_corpora);
+}
+
+CorpusCache *CorpusCache::instance()
+{
+    QMutexLocker l_locker(&g_instanceLock);
+
+    if(!g_instance)
+    {
+        g_instance = new CorpusCache();
+    }
+
+    return g_instance;
+}
+
+const CompiledCorpus *CorpusCache::corpus(const QString &pathFileCorpus)
+{
+    QFileInfo l_info(pathFileCorpus);
+    QString l_key = l_info.absoluteFilePath();
+    if(!l_info.exists())
+    {
+        m_sources.remove(l_key);
+        std::cerr << "Can not open corpus file. " << std::endl;
+        return NULL;
+    }
+
+    qint64 l_time = l_info.lastModified().toMSecsSinceEpoch(), l_size = l_info.size();
+
+    // same file as the last read, its text isn't read again : a file modified during the last second may have been rewritten
+    // with the same size without changing its modification time
+        bool l_recent = QDateTime::currentMSecsSinceEpoch() - l_time < 1000;
+        QHash<QString, CorpusSource>::const_iterator l_source = m_sources.constFind(l_key);
+        if(!l_recent && l_source != m_sources.constEnd() && l_source->m_sourceTime == l_time && l_source->m_sourceSize == l_size && m_corpora.contains(l_source->m_contentHash))
+        {
+            m_recentCorpora.removeOne(l_source->m_contentHash);
+            m_recentCorpora.push_back(l_source->m_contentHash);
+            return m_corpora.value(l_source->m_contentHash);
+        }
+
+    // same text as a corpus in memory
+        QFile l_file(pathFileCorpus);
+        if(!l_file.open(QIODevice::ReadOnly))
+        {
+            std::cerr << "Can not open corpus file. " << std::endl;
+            return NULL;
+        }
+        quint64 l_hash = fileContentHash(l_file.readAll());
+        l_file.close();
+
+        CompiledCorpus *l_corpus = m_corpora.value(l_hash, NULL);
+
+    // compiled file of a previous process, else parse the text and try to keep its compiled file
+        if(!l_corpus)
+        {
+            l_corpus = new CompiledCorpus();
+            QString l_compiledPath = l_key + ".compiled";
+            if(!loadCompiledCorpus(l_compiledPath, *l_corpus) || l_corpus->m_sourceTime != l_time || l_corpus->m_sourceSize != l_size || l_corpus->m_contentHash != l_hash)
+            {
+                if(!compileCorpus(pathFileCorpus, *l_corpus))
+                {
+                    delete l_corpus;
+                    return NULL;
+                }
+
+                saveCompiledCorpus(l_compiledPath, *l_corpus);
+            }
+
+            // the file may have changed since it was hashed
+                l_hash = l_corpus->m_contentHash;
+                if(m_corpora.contains(l_hash))
+                {
+                    delete l_corpus;
+                    l_corpus = m_corpora.value(l_hash);
+                }
+                else
+                {
+                    m_corpora.insert(l_hash, l_corpus);
+                }
+        }
+
+        CorpusSource l_newSource;
+        l_newSource.m_contentHash = l_hash;
+        l_newSource.m_sourceTime  = l_time;
+        l_newSource.m_sourceSize  = l_size;
+        m_sources.insert(l_key, l_newSource);
+
+        m_recentCorpora.removeOne(l_hash);
+        m_recentCorpora.push_back(l_hash);
+
+    evict();
+
+    return l_corpus;
+}
+
+void CorpusCache::evict()
+{
+    // paths of the removed files (the corpus files of the finished jobs)
+        QHash<QString, CorpusSource>::iterator it = m_sources.begin();
+        while(it != m_sources.end())
+        {
+            if(!QFileInfo(it.key()).exists())
+            {
+                it = m_sources.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+    // least recently used corpora, the most recent one is always kept
+        while(m_recentCorpora.size() > g_maxCorpora)
+        {
+            quint64 l_hash = m_recentCorpora.takeFirst();
+            delete m_corpora.take(l_hash);
+
+            for(it = m_sources.begin(); it != m_sources.end();)
+            {
+                if(it->m_contentHash == l_hash)
+                {
+                    it = m_sources.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+}
+
+bool CorpusCache::sentences(const QString &pathFileCorpus, const CorpusPart part, Sentences &sentences)
+{
+    QMutexLocker l_locker(&m_lock);
+
+    const CompiledCorpus *l_corpus = corpus(pathFileCorpus);
+    if(!l_corpus)
+    {
+        sentences.clear();
+        return false;
+    }
+
+    l_corpus->m_vocabulary.sentences(l_corpus->m_parts[part], sentences);
+    return true;
+}
+
+bool CorpusCache::sentences(const QString &pathFileCorpus, const CorpusPart part, QVector<QStringList> &sentences)
+{
+    QMutexLocker l_locker(&m_lock);
+
+    const CompiledCorpus *l_corpus = corpus(pathFileCorpus);
+    if(!l_corpus)
+    {
+        return false;
+    }
+
+    const TokenizedSentences &l_part = l_corpus->m_parts[part];
+    for(int ii = 0; ii < l_part.nbSentences(); ++ii)
+    {
+        QStringList l_line;
+        const int *l_words = l_part.words(ii);
+        for(int jj = 0; jj < l_part.length(ii); ++jj)
+        {
+            l_line << QString::fromStdString(l_corpus->m_vocabulary.word(l_words[jj]));
+        }
+        sentences.push_back(l_line);
+    }
+
+    return true;
+}
+
+bool CorpusCache::tokens(const QString &pathFileCorpus, const CorpusPart part, Vocabulary &vocabulary, TokenizedSentences &tokens)
+{
+    QMutexLocker l_locker(&m_lock);
+
+    const CompiledCorpus *l_corpus = corpus(pathFileCorpus);
+    if(!l_corpus)
+    {
+        vocabulary.clear();
+        tokens.clear();
+        return false;
+    }
+
+    vocabulary = l_corpus->m_vocabulary;
+    tokens     = l_corpus->m_parts[part];
+    return true;
+}
+
+quint64 CorpusCache::contentHash(const QString &pathFileCorpus)
+{
+    QMutexLocker l_locker(&m_lock);
+
+    const CompiledCorpus *l_corpus = corpus(pathFileCorpus);
+    return l_corpus ? l_corpus->m_contentHash : 0;
+}
+
+void CorpusCache::forget(const QString &pathFileCorpus)
+{
+    QMutexLocker l_locker(&m_lock);
+    m_sources.remove(QFileInfo(pathFileCorpus).absoluteFilePath());
+}
@@ -26,7 +26,7 @@
 int main(int argc, char* argv[])
 {
     srand(1);
-    culaWarmup(1);
+    LinearAlgebraBackend::initThread();
 
     Model l_gridSearchModel;
     std::string l_grammarStd[] ={"and","is","of","the","to",".","-ed","-ing","-s","by","it","that","was","did",",","from"};
@@ -36,6 +36,39 @@ int main(int argc, char* argv[])
     Sentence l_structure = Sentence(l_structureStd, l_structureStd + sizeof(l_structureStd) / sizeof(std::string));
     l_gridSearchModel.setCCWAndStructure(l_grammar, l_structure);
 
+    // readout options : -backend opencv|lapack / -sketch rank / -cg maxIterations (the grid search warm starts the conjugate gradient) /
+    // -stream chunkSize (mini-batch Adam on the stimulus files) / -epochs nb
+        int l_streamChunkSize = 0, l_streamEpochs = 1;
+        for(int ii = 1; ii + 1 < argc; ii += 2)
+        {
+            std::string l_option(argv[ii]), l_value(argv[ii + 1]);
+            if(l_option == "-backend")
+            {
+                l_gridSearchModel.reservoir()->setCpuBackend(l_value == "opencv" ? LinearAlgebraBackend::OPENCV : LinearAlgebraBackend::LAPACK);
+            }
+            else if(l_option == "-sketch")
+            {
+                l_gridSearchModel.setSketchRank(atoi(l_value.c_str()));
+            }
+            else if(l_option == "-cg")
+            {
+                l_gridSearchModel.setIterativeSolver(atoi(l_value.c_str()) > 0, atoi(l_value.c_str()));
+            }
+            else if(l_option == "-stream")
+            {
+                l_streamChunkSize = atoi(l_value.c_str());
+            }
+            else if(l_option == "-epochs")
+            {
+                l_streamEpochs = atoi(l_value.c_str());
+            }
+            else
+            {
+                std::cerr << "-ERROR : main -> unknown option " << l_option << ". " << std::endl;
+            }
+        }
+        l_gridSearchModel.setStreamingTraining(l_streamChunkSize, l_streamEpochs);
+
     GridSearch l_gridSearch(l_gridSearchModel);
     l_gridSearch.setCudaParameters(true, true);
     l_gridSearch.setParameterValues(GridSearch::NEURONS_NB,     500, 500, "+100");
@@ -48,7 +81,7 @@ int main(int argc, char* argv[])
     l_gridSearch.setCorpusList(l_corpusList);
     l_gridSearch.launchTrainWithAllParameters("../data/Results/test-results.txt", "../data/Results/test-results_raw.txt");
 
-    culaStop();
+    LinearAlgebraBackend::releaseThread();
     return 0;
 
 
@@ -252,6 +285,6 @@ int main(int argc, char* argv[])
 
 
 
-    culaStop();
+    LinearAlgebraBackend::releaseThread();
     return 0;
 }
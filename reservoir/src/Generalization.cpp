@@ -242,7 +242,10 @@ void Generalization::randomChangeCorpusGeneralization(cint numberRandomSentences
 
     // extract data
         m_trainMeaning.clear(); m_trainInfo.clear(); m_trainSentence.clear();
-        extractAllDataFromCorpusFile(m_model->parameters().m_corpusFilePath.c_str(), m_trainMeaning,m_trainInfo,m_trainSentence, l_inused,l_inused,l_inused);
+        QString l_corpusPath = QString::fromStdString(m_model->parameters().m_corpusFilePath);
+        CorpusCache::instance()->sentences(l_corpusPath, CORPUS_TRAIN_DATA, m_trainMeaning);
+        CorpusCache::instance()->sentences(l_corpusPath, CORPUS_TRAIN_INFO, m_trainInfo);
+        CorpusCache::instance()->sentences(l_corpusPath, CORPUS_TRAIN_MEANING, m_trainSentence);
 
     // create random sentence list
         int l_sizeCorpus = m_trainMeaning.size();
@@ -264,12 +267,15 @@ void Generalization::randomChangeCorpusGeneralization(cint numberRandomSentences
         }
 
         generateCorpus(pathRandomCorpus, l_subData, l_subInfo, l_subMeaning, l_inused, l_inused);
+        CorpusCache::instance()->forget(pathRandomCorpus);
 }
 
 void Generalization::startXVerification(const std::string &xCheckTrainPath, const std::string &xCheckTestPath, const std::string &xCheckTestSentencesPath)
 {
-    QVector<QStringList> l_inused;
-    extractAllDataFromCorpusFile(m_model->parameters().m_corpusFilePath.c_str(), m_trainMeaning,m_trainInfo,m_trainSentence, l_inused,l_inused,l_inused);
+    QString l_corpusPath = QString::fromStdString(m_model->parameters().m_corpusFilePath);
+    CorpusCache::instance()->sentences(l_corpusPath, CORPUS_TRAIN_DATA, m_trainMeaning);
+    CorpusCache::instance()->sentences(l_corpusPath, CORPUS_TRAIN_INFO, m_trainInfo);
+    CorpusCache::instance()->sentences(l_corpusPath, CORPUS_TRAIN_MEANING, m_trainSentence);
 
     ModelParameters l_currentParameters  = m_model->parameters();
     l_currentParameters.m_corpusFilePath = "../data/input/Corpus/XCheck.txt";
@@ -325,6 +331,7 @@ void Generalization::startXVerification(const std::string &xCheckTrainPath, cons
             }
 
             generateCorpus(l_currentParameters.m_corpusFilePath.c_str(), l_trainDataM, l_trainInfoM, l_trainMeaningM, l_testData, l_testInfo);
+            CorpusCache::instance()->forget(QString::fromStdString(l_currentParameters.m_corpusFilePath));
 
             m_model->resetModelParameters(l_currentParameters, false);
 
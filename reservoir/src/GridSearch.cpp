@@ -138,6 +138,10 @@ void GridSearch::launchTrainWithAllParameters(const std::string resultsFilePath,
     int l_currentTrain = 1;
     int l_currentTest = 1;
 
+    // the readout of the previous point is a warm start for the next one only if it was trained with the same corpus on the same reservoir :
+    // W / W IN are the loaded ones, or they are generated again from the same seed with the same parameters (only the leak rate or the ridge change)
+    int l_previousCorpus = -1, l_previousNbNeurons = -1, l_previousSparcity = -1, l_previousInputScaling = -1, l_previousSpectralRadius = -1;
+
     for(int aa = 0; aa < m_corpusList.size(); ++aa)
     {
         for(int ii = 0; ii < m_nbNeuronsValues.size(); ++ii)
@@ -197,12 +201,23 @@ void GridSearch::launchTrainWithAllParameters(const std::string resultsFilePath,
                                     emit sendLogInfo("# Start the training number : " +  QString::number(l_currentTrain) + " / " + QString::number(l_nbTrain) + " \n", QColor(Qt::blue));
                                     std::cout << "########## Start the training number : " << l_currentTrain++ << " / " << l_nbTrain << std::endl << std::endl;
 
+                                    bool l_sameSize = l_previousCorpus == aa && l_previousNbNeurons == ii;
+                                    bool l_sameW    = loadW   || (!m_randomSeed && l_previousSparcity == kk && l_previousSpectralRadius == nn);
+                                    bool l_sameWIn  = loadWIn || (!m_randomSeed && l_previousInputScaling == ll && (loadW || l_previousSparcity == kk)); // W consumes the random numbers first
+                                    m_model->setReadoutWarmStart(l_sameSize && l_sameW && l_sameWIn);
+
                                     if(!m_model->launchTraining())
                                     {
                                         emit sendLogInfo("Abort gridsearch. \n", QColor(Qt::red));
                                         return;
                                     }
 
+                                    l_previousCorpus         = aa;
+                                    l_previousNbNeurons      = ii;
+                                    l_previousSparcity       = kk;
+                                    l_previousInputScaling   = ll;
+                                    l_previousSpectralRadius = nn;
+
                                     double l_time = static_cast<double>((clock() - l_timeTraining)) / CLOCKS_PER_SEC;
 
                                     m_model->displayResults(true,false);
@@ -324,74 +339,28 @@ bool GridSearch::setParameterValues(const GridSearch::ReservoirParameter paramet
         break;
     }
 
-    double l_value = static_cast<double>(startValue);
-
-    int l_loopStop = 0;
-    if(startValue <= endValue && !useOnlyStartValue)
+    std::vector<double> l_range;
+    if(!rangeValues(startValue, endValue, operation, useOnlyStartValue, l_range))
     {
-        while(l_value <= endValue)
-        {
-            if(parameterId != NEURONS_NB)
-            {
-                for(int ii = 0; ii < nbOfTimesForEachValues; ++ii)
-                    l_valuesD.push_back(l_value);
-            }
-            else
-            {
-                for(int ii = 0; ii < nbOfTimesForEachValues; ++ii)
-                    l_valuesI.push_back(static_cast<int>(l_value));
-            }
-
-            l_value = applyOperation(l_value, operation);
-
-            if(++l_loopStop > 500)
-            {
-                std::cerr << "Bad operation for parameter : " << parameterId << std::endl;
-                emit sendLogInfo("Bad operation for parameter : " +  QString::number(parameterId) + " \n", QColor(Qt::red));
-                l_operationValid = false;
-                break;
-            }
-        }
+        std::cerr << "Bad operation for parameter : " << parameterId << std::endl;
+        emit sendLogInfo("Bad operation for parameter : " +  QString::number(parameterId) + " \n", QColor(Qt::red));
+        l_operationValid = false;
     }
-    else if(!useOnlyStartValue)
+
+    for(int ii = 0; ii < static_cast<int>(l_range.size()); ++ii)
     {
-        while(l_value >= endValue)
+        for(int jj = 0; jj < nbOfTimesForEachValues; ++jj)
         {
             if(parameterId != NEURONS_NB)
             {
-                for(int ii = 0; ii < nbOfTimesForEachValues; ++ii)
-                    l_valuesD.push_back(l_value);
+                l_valuesD.push_back(l_range[ii]);
             }
             else
             {
-                for(int ii = 0; ii < nbOfTimesForEachValues; ++ii)
-                    l_valuesI.push_back(static_cast<int>(l_value));
-            }
-
-            l_value = applyOperation(l_value, operation);
-
-            if(++l_loopStop > 500)
-            {
-                std::cerr << "Bad operation for parameter : " << parameterId << std::endl;
-                emit sendLogInfo("Bad operation for parameter : " +  QString::number(parameterId) + " \n", QColor(Qt::red));
-                l_operationValid = false;
-                break;
+                l_valuesI.push_back(static_cast<int>(l_range[ii]));
             }
         }
     }
-    else
-    {
-        if(parameterId != NEURONS_NB)
-        {
-            for(int ii = 0; ii < nbOfTimesForEachValues; ++ii)
-                l_valuesD.push_back(l_value);
-        }
-        else
-        {
-            for(int ii = 0; ii < nbOfTimesForEachValues; ++ii)
-                l_valuesI.push_back(static_cast<int>(l_value));
-        }
-    }
 
     switch(parameterId)
     {
@@ -418,6 +387,33 @@ bool GridSearch::setParameterValues(const GridSearch::ReservoirParameter paramet
     return l_operationValid;
 }
 
+bool GridSearch::rangeValues(cdouble startValue, cdouble endValue, const std::string &operation, cbool useOnlyStartValue, std::vector<double> &values)
+{
+    values.clear();
+
+    double l_value = startValue;
+    if(useOnlyStartValue)
+    {
+        values.push_back(l_value);
+        return true;
+    }
+
+    bool l_increasing = startValue <= endValue;
+    int l_loopStop = 0;
+    while(l_increasing ? l_value <= endValue : l_value >= endValue)
+    {
+        values.push_back(l_value);
+        l_value = applyOperation(l_value, operation);
+
+        if(++l_loopStop > 500)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 void GridSearch::setCorpusList(const std::vector<std::string> &corpusList)
 {
     m_corpusList = corpusList;
@@ -34,7 +34,7 @@
 
 int main(int argc, char* argv[])
 {
-    culaWarmup(1);
+    LinearAlgebraBackend::initThread();
 
     QApplication l_oApp(argc, argv);
     Interface l_oViewerInterface(&l_oApp);
@@ -359,7 +359,7 @@ void Interface::saveTraining()
 
 void Interface::saveReplay()
 {
-    QString l_sPathReplay = QFileDialog::getSaveFileName(this, "Enter replay name", m_absolutePath + "../data/replay", "Replay file (*.txt)");
+    QString l_sPathReplay = QFileDialog::getSaveFileName(this, "Enter replay name", m_absolutePath + "../data/replay", "Replay file (*.rpl *.npy *.txt)");
 
     if(l_sPathReplay.size() == 0)
     {
@@ -515,7 +515,7 @@ void Interface::loadWInMatrix()
 
 void Interface::loadReplay()
 {
-    QString l_pathReplay = QFileDialog::getOpenFileName(this, "Select replay file ", m_absolutePath + "../data/replay");
+    QString l_pathReplay = QFileDialog::getOpenFileName(this, "Select replay file ", m_absolutePath + "../data/replay", "Replay file (*.rpl *.npy *.txt)");
 
     if(l_pathReplay.size() == 0 )
     {
@@ -347,8 +347,14 @@ void InterfaceWorker::saveLastTraining(QString pathDirectory)
 {
     if(pathDirectory.size() > 0)
     {
-        m_model.saveTraining(pathDirectory.toStdString());
-        sendLogInfo("Training saved in the directory : " + pathDirectory + "\n", QColor(0,0,255));
+        if(m_model.saveTraining(pathDirectory.toStdString()))
+        {
+            sendLogInfo("Training saved in the directory : " + pathDirectory + "\n", QColor(0,0,255));
+        }
+        else
+        {
+            sendLogInfo("Training can't be saved in the directory : " + pathDirectory + "\n", QColor(Qt::red));
+        }
     }
 }
 
@@ -356,8 +362,14 @@ void InterfaceWorker::saveLastReplay(QString pathDirectory)
 {
     if(pathDirectory.size() > 0)
     {
-        m_model.saveReplay(pathDirectory.toStdString());
-        sendLogInfo("Replay saved : " + pathDirectory + "\n", QColor(0,0,255));
+        if(m_model.saveReplay(pathDirectory.toStdString()))
+        {
+            sendLogInfo("Replay saved : " + pathDirectory + "\n", QColor(0,0,255));
+        }
+        else
+        {
+            sendLogInfo("Replay can't be saved : " + pathDirectory + "\n", QColor(Qt::red));
+        }
     }
 }
 
@@ -405,7 +417,18 @@ void InterfaceWorker::setLoadedWInParameters(QStringList loadedParams)
 
 void InterfaceWorker::loadReplay(QString pathReplay)
 {
-    if(load3DMatrixFromNpPythonSaveTextF(pathReplay, m_xTot))
+    m_replayStore.close();
+
+    if(pathReplay.endsWith(".rpl", Qt::CaseInsensitive))
+    {
+        if(m_replayStore.open(pathReplay))
+        {
+            m_xTot = cv::Mat();
+            sendLogInfo("Replay file opened : " + pathReplay + "\n", QColor(Qt::blue));
+            emit replayLoaded();
+        }
+    }
+    else if(load3DMatrixF(pathReplay, m_xTot))
     {
         sendLogInfo("Replay matrice xTot loaded in the directory : " + pathReplay + "\n", QColor(Qt::blue));
         emit replayLoaded();
@@ -415,18 +438,23 @@ void InterfaceWorker::loadReplay(QString pathReplay)
 void InterfaceWorker::startReplay()
 {
     cv::Mat *l_xTot = NULL;
+    bool l_useReplayStore = false;
 
     if(m_replayParameters.m_useLastTraining)
     {
         l_xTot = model()->xTotMatrice();
     }
+    else if(m_replayStore.isOpen())
+    {
+        l_useReplayStore = true;
+    }
     else
     {
         l_xTot = &m_xTot;
     }
 
-    int l_nbNeurons   = l_xTot->size[1];
-    int l_nbSentences = l_xTot->size[0];
+    int l_nbNeurons   = l_useReplayStore ? m_replayStore.neuronsNumber()   : l_xTot->size[1];
+    int l_nbSentences = l_useReplayStore ? m_replayStore.sentencesNumber() : l_xTot->size[0];
 
     int l_startIdNeurons    = m_replayParameters.m_rangeNeuronsStart;
     int l_endIdNeurons      = m_replayParameters.m_rangeNeuronsEnd;
@@ -538,6 +566,18 @@ void InterfaceWorker::startReplay()
         for(int jj = 0; jj < l_idSentences.size(); ++jj)
         {
             int l_idCurrentSentence = l_idSentences[jj];
+
+            // only the tile containing the neuron is read
+            if(l_useReplayStore)
+            {
+                QVector<double> l_activity;
+                if(m_replayStore.neuronActivity(l_idCurrentSentence, l_idCurrentNeuron, l_activity))
+                {
+                    l_neuronValues << l_activity;
+                }
+                continue;
+            }
+
             for(int kk = 0; kk < l_xTot->size[2]; ++kk)
             {
                 l_neuronValues << static_cast<double>(l_xTot->at<float>(l_idCurrentSentence,l_idCurrentNeuron,kk));
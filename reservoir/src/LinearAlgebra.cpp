@@ -0,0 +1,541 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+
+/**
+ * \file LinearAlgebra.cpp
+ * \brief defines the linear algebra backends used by the reservoir
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#include "LinearAlgebra.h"
+#include "TaskScheduler.h"
+
+#ifdef USE_CUDA
+#include "gpuMat/cudaInversions.h"
+#include "gpuMat/cudaMultiplications.h"
+#endif
+
+// CLAPACK (f2c interface, column-major)
+extern "C"
+{
+    typedef long int claInteger;
+
+    int sgesvd_(char *jobu, char *jobvt, claInteger *m, claInteger *n, float *a, claInteger *lda, float *s, float *u, claInteger *ldu,
+                float *vt, claInteger *ldvt, float *work, claInteger *lwork, claInteger *info);
+    int spotrf_(char *uplo, claInteger *n, float *a, claInteger *lda, claInteger *info);
+    int spotrs_(char *uplo, claInteger *n, claInteger *nrhs, float *a, claInteger *lda, float *b, claInteger *ldb, claInteger *info);
+    int ssyev_(char *jobz, char *uplo, claInteger *n, float *a, claInteger *lda, float *w, float *work, claInteger *lwork, claInteger *info);
+}
+
+static QMutex g_lapackLock;             /**< the f2c CLAPACK uses static variables */
+
+static OpenCVBackend g_openCVBackend;   /**< shared OpenCV backend */
+static LapackBackend g_lapackBackend;   /**< shared LAPACK backend */
+#ifdef USE_CUDA
+static CudaBackend g_cudaBackend;       /**< shared CUDA backend */
+#endif
+
+/**
+ * @brief cancelled
+ * @param [in] cancel
+ * @return true if the token exists and is cancelled
+ */
+static bool cancelled(const CancellationToken *cancel)
+{
+    return cancel && cancel->isCancelled();
+}
+
+/**
+ * @brief Panels of rows of a product res = op(A) * op(B)
+ */
+class PanelsProductTask : public SentenceTask
+{
+    public :
+
+        PanelsProductTask(const cv::Mat &A, const cv::Mat &B, cv::Mat &res, cint flags, cint panelRows, const CancellationToken *cancel) :
+            m_A(A), m_B(B), m_res(res), m_flags(flags), m_panelRows(panelRows), m_cancel(cancel)
+        {}
+
+        void run(cint begin, cint end)
+        {
+            bool l_transA = (m_flags & cv::GEMM_1_T) != 0;
+            for(int ii = begin; ii < end; ++ii)
+            {
+                if(cancelled(m_cancel))
+                {
+                    return;
+                }
+
+                int l_begin = ii * m_panelRows, l_end = std::min(m_res.rows, l_begin + m_panelRows);
+
+                // the panel is a view of res, gemm writes directly in it
+                    cv::Mat l_panel = m_res.rowRange(l_begin, l_end);
+                    cv::gemm(l_transA ? m_A.colRange(l_begin, l_end) : m_A.rowRange(l_begin, l_end), m_B, 1.0, cv::Mat(), 0.0, l_panel, m_flags);
+            }
+        }
+
+    private :
+
+        const cv::Mat &m_A;
+        const cv::Mat &m_B;
+        cv::Mat &m_res;
+        int m_flags;
+        int m_panelRows;
+        const CancellationToken *m_cancel;
+};
+
+/**
+ * @brief Tiles of the lower triangle of res = A * A^T
+ */
+class SyrkTilesTask : public SentenceTask
+{
+    public :
+
+        SyrkTilesTask(const cv::Mat &A, cv::Mat &res, const std::vector<std::pair<int,int> > &tiles, cint tileSize, const CancellationToken *cancel) :
+            m_A(A), m_res(res), m_tiles(tiles), m_tileSize(tileSize), m_cancel(cancel)
+        {}
+
+        void run(cint begin, cint end)
+        {
+            int l_dim = m_A.rows;
+            for(int ii = begin; ii < end; ++ii)
+            {
+                if(cancelled(m_cancel))
+                {
+                    return;
+                }
+
+                int l_row = m_tiles[ii].first * m_tileSize, l_col = m_tiles[ii].second * m_tileSize;
+                cv::Range l_rows(l_row, std::min(l_dim, l_row + m_tileSize)), l_cols(l_col, std::min(l_dim, l_col + m_tileSize));
+
+                // the tile is a view of res, the panels of rows of A are multiplied without transposed copy
+                    cv::Mat l_tile = m_res(l_rows, l_cols);
+                    if(l_row == l_col)
+                    {
+                        cv::mulTransposed(m_A.rowRange(l_rows), l_tile, false);
+                    }
+                    else
+                    {
+                        cv::gemm(m_A.rowRange(l_rows), m_A.rowRange(l_cols), 1.0, cv::Mat(), 0.0, l_tile, cv::GEMM_2_T);
+                    }
+            }
+        }
+
+    private :
+
+        const cv::Mat &m_A;
+        cv::Mat &m_res;
+        const std::vector<std::pair<int,int> > &m_tiles;
+        int m_tileSize;
+        const CancellationToken *m_cancel;
+};
+
+/**
+ * @brief panelsProduct : res = op(A) * op(B), the panels of rows of res are computed in parallel within the thread budget of the calling thread
+ * @param [in] A
+ * @param [in] B
+ * @param [out] res
+ * @param [in] flags
+ * @param [in] cancel : checked before each panel
+ * @return false if the product has been cancelled
+ */
+static bool panelsProduct(const cv::Mat &A, const cv::Mat &B, cv::Mat &res, cint flags, const CancellationToken *cancel)
+{
+    bool l_transA = (flags & cv::GEMM_1_T) != 0;
+    int l_rows = l_transA ? A.cols : A.rows;
+    int l_cols = (flags & cv::GEMM_2_T) ? B.rows : B.cols;
+
+    // a destination already allocated with the size of the product is kept, the panels are written in its buffer
+        res.create(l_rows, l_cols, A.type());
+
+    if(l_rows == 0)
+    {
+        return !cancelled(cancel);
+    }
+
+    // several panels per thread for balancing the end of the product
+        TaskScheduler *l_scheduler = TaskScheduler::instance();
+        int l_nbThreads = l_scheduler->threadBudget();
+        int l_panelRows = std::max(1, (l_rows + l_nbThreads * 4 - 1) / (l_nbThreads * 4));
+        int l_nbPanels  = (l_rows + l_panelRows - 1) / l_panelRows;
+
+    PanelsProductTask l_task(A, B, res, flags, l_panelRows, cancel);
+    l_scheduler->parallelFor(l_task, l_nbPanels);
+
+    return !cancelled(cancel);
+}
+
+/**
+ * @brief tiledSyrk : lower triangle of res = A * A^T, the tiles are computed in parallel and A is never transposed
+ * @param [in] A
+ * @param [out] res
+ * @param [in] mirror : copy the lower triangle in the upper one
+ * @param [in] cancel : checked before each tile
+ * @return false if the product has been cancelled
+ */
+static bool tiledSyrk(const cv::Mat &A, cv::Mat &res, cbool mirror, const CancellationToken *cancel)
+{
+    int l_dim = A.rows;
+    res = cv::Mat(l_dim, l_dim, A.type(), cv::Scalar(0));
+
+    if(l_dim == 0)
+    {
+        return !cancelled(cancel);
+    }
+
+    // tiles of the lower triangle, a tile row per half thread at least
+        TaskScheduler *l_scheduler = TaskScheduler::instance();
+        int l_nbThreads  = l_scheduler->threadBudget();
+        int l_tileSize   = std::max(128, (l_dim + l_nbThreads * 2 - 1) / (l_nbThreads * 2));
+        int l_nbTileRows = (l_dim + l_tileSize - 1) / l_tileSize;
+
+        std::vector<std::pair<int,int> > l_tiles;
+        std::vector<int> l_costs;
+        for(int ii = 0; ii < l_nbTileRows; ++ii)
+        {
+            for(int jj = 0; jj <= ii; ++jj)
+            {
+                l_tiles.push_back(std::make_pair(ii, jj));
+                l_costs.push_back(ii == jj ? 1 : 2);
+            }
+        }
+
+    // the tiles are balanced on their cost, the diagonal tiles only compute half of their products
+        SyrkTilesTask l_task(A, res, l_tiles, l_tileSize, cancel);
+        l_scheduler->parallelFor(l_task, static_cast<int>(l_tiles.size()), &l_costs);
+
+    if(cancelled(cancel))
+    {
+        return false;
+    }
+
+    if(mirror)
+    {
+        cv::completeSymm(res, true);
+    }
+
+    return true;
+}
+
+LinearAlgebraBackend *LinearAlgebraBackend::instance(const Type type)
+{
+    switch(type)
+    {
+        case OPENCV :
+            return &g_openCVBackend;
+        case CUDA :
+#ifdef USE_CUDA
+            return &g_cudaBackend;
+#else
+            std::cerr << "-ERROR : LinearAlgebraBackend::instance -> built without CUDA, the LAPACK backend is used. " << std::endl;
+            return &g_lapackBackend;
+#endif
+        default :
+            return &g_lapackBackend;
+    }
+}
+
+void LinearAlgebraBackend::initThread()
+{
+#ifdef USE_CUDA
+    culaWarmup(1);
+#endif
+}
+
+void LinearAlgebraBackend::releaseThread()
+{
+#ifdef USE_CUDA
+    culaStop();
+#endif
+}
+
+// ############################################################################################# OPENCV
+
+QString OpenCVBackend::name() const
+{
+    return "opencv";
+}
+
+bool OpenCVBackend::gemm(const cv::Mat &A, const cv::Mat &B, cv::Mat &res, cint flags, const CancellationToken *cancel)
+{
+    if(cancelled(cancel))
+    {
+        return false;
+    }
+
+    cv::gemm(A, B, 1.0, cv::Mat(), 0.0, res, flags);
+
+    return !cancelled(cancel);
+}
+
+bool OpenCVBackend::syrk(const cv::Mat &A, cv::Mat &res, const CancellationToken *cancel, cbool)
+{
+    if(cancelled(cancel))
+    {
+        return false;
+    }
+
+    cv::mulTransposed(A, res, false);
+
+    return !cancelled(cancel);
+}
+
+bool OpenCVBackend::svd(const cv::Mat &M, cv::Mat &S, cv::Mat &U, cv::Mat &VT)
+{
+    cv::SVD::compute(M, S, U, VT, cv::SVD::FULL_UV);
+
+    return true;
+}
+
+bool OpenCVBackend::cholesky(const cv::Mat &A, const cv::Mat &B, cv::Mat &X)
+{
+    return cv::solve(A, B, X, cv::DECOMP_CHOLESKY);
+}
+
+bool OpenCVBackend::eigen(const cv::Mat &A, cv::Mat &eigenValues, cv::Mat &eigenVectors)
+{
+    return cv::eigen(A, eigenValues, eigenVectors);
+}
+
+// ############################################################################################# LAPACK
+
+QString LapackBackend::name() const
+{
+    return "lapack";
+}
+
+bool LapackBackend::gemm(const cv::Mat &A, const cv::Mat &B, cv::Mat &res, cint flags, const CancellationToken *cancel)
+{
+    if(A.type() != CV_32FC1 || B.type() != CV_32FC1)
+    {
+        return m_fallback.gemm(A, B, res, flags, cancel);
+    }
+
+    return panelsProduct(A, B, res, flags, cancel);
+}
+
+bool LapackBackend::syrk(const cv::Mat &A, cv::Mat &res, const CancellationToken *cancel, cbool mirror)
+{
+    if(A.type() != CV_32FC1)
+    {
+        return m_fallback.syrk(A, res, cancel, mirror);
+    }
+
+    return tiledSyrk(A, res, mirror, cancel);
+}
+
+bool LapackBackend::svd(const cv::Mat &M, cv::Mat &S, cv::Mat &U, cv::Mat &VT)
+{
+    if(M.type() != CV_32FC1)
+    {
+        return m_fallback.svd(M, S, U, VT);
+    }
+
+    // the row-major M is read as the column-major M^T = U' * S * V'^T, so U = V' and VT = U'^T :
+    // the column-major outputs of LAPACK are directly the row-major U and VT with the buffers swapped
+        cv::Mat l_a = M.clone();
+        claInteger l_m = M.cols, l_n = M.rows, l_lwork = -1, l_info = 0;
+        char l_job = 'A';
+        float l_workSize = 0.f;
+
+        S  = cv::Mat(std::min(M.rows, M.cols), 1, CV_32FC1);
+        U  = cv::Mat(M.rows, M.rows, CV_32FC1);
+        VT = cv::Mat(M.cols, M.cols, CV_32FC1);
+
+    QMutexLocker l_locker(&g_lapackLock);
+
+    // workspace query
+        sgesvd_(&l_job, &l_job, &l_m, &l_n, l_a.ptr<float>(), &l_m, S.ptr<float>(), VT.ptr<float>(), &l_m, U.ptr<float>(), &l_n, &l_workSize, &l_lwork, &l_info);
+
+        l_lwork = static_cast<claInteger>(l_workSize);
+        std::vector<float> l_work(std::max(static_cast<claInteger>(1), l_lwork));
+
+    sgesvd_(&l_job, &l_job, &l_m, &l_n, l_a.ptr<float>(), &l_m, S.ptr<float>(), VT.ptr<float>(), &l_m, U.ptr<float>(), &l_n, &l_work[0], &l_lwork, &l_info);
+
+    if(l_info != 0)
+    {
+        std::cerr << "-ERROR : LapackBackend::svd -> sgesvd failed (" << l_info << "). " << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool LapackBackend::cholesky(const cv::Mat &A, const cv::Mat &B, cv::Mat &X)
+{
+    if(A.type() != CV_32FC1 || B.type() != CV_32FC1)
+    {
+        return m_fallback.cholesky(A, B, X);
+    }
+
+    // only the lower triangle of the row-major A (upper of the column-major one) is read,
+    // B^T row-major is B column-major
+        cv::Mat l_a = A.clone(), l_b = B.t();
+        claInteger l_n = A.rows, l_nrhs = B.cols, l_info = 0;
+        char l_uplo = 'U';
+
+    {
+        QMutexLocker l_locker(&g_lapackLock);
+
+        spotrf_(&l_uplo, &l_n, l_a.ptr<float>(), &l_n, &l_info);
+        if(l_info != 0)
+        {
+            std::cerr << "-ERROR : LapackBackend::cholesky -> the matrix is not positive definite (" << l_info << "). " << std::endl;
+            return false;
+        }
+
+        spotrs_(&l_uplo, &l_n, &l_nrhs, l_a.ptr<float>(), &l_n, l_b.ptr<float>(), &l_n, &l_info);
+    }
+
+    X = l_b.t();
+
+    return l_info == 0;
+}
+
+bool LapackBackend::eigen(const cv::Mat &A, cv::Mat &eigenValues, cv::Mat &eigenVectors)
+{
+    if(A.type() != CV_32FC1)
+    {
+        return m_fallback.eigen(A, eigenValues, eigenVectors);
+    }
+
+    cv::Mat l_a = A.clone(), l_values(A.rows, 1, CV_32FC1);
+    claInteger l_n = A.rows, l_lwork = -1, l_info = 0;
+    char l_jobz = 'V', l_uplo = 'U';
+    float l_workSize = 0.f;
+
+    {
+        QMutexLocker l_locker(&g_lapackLock);
+
+        // workspace query
+            ssyev_(&l_jobz, &l_uplo, &l_n, l_a.ptr<float>(), &l_n, l_values.ptr<float>(), &l_workSize, &l_lwork, &l_info);
+
+            l_lwork = static_cast<claInteger>(l_workSize);
+            std::vector<float> l_work(std::max(static_cast<claInteger>(1), l_lwork));
+
+        ssyev_(&l_jobz, &l_uplo, &l_n, l_a.ptr<float>(), &l_n, l_values.ptr<float>(), &l_work[0], &l_lwork, &l_info);
+    }
+
+    if(l_info != 0)
+    {
+        std::cerr << "-ERROR : LapackBackend::eigen -> ssyev failed (" << l_info << "). " << std::endl;
+        return false;
+    }
+
+    // the column-major eigenvectors are the rows of l_a, sorted like OpenCV in decreasing order
+        cv::flip(l_values, eigenValues, 0);
+        cv::flip(l_a, eigenVectors, 0);
+
+    return true;
+}
+
+#ifdef USE_CUDA
+
+// ############################################################################################# CUDA
+
+/**
+ * @brief cudaBlocks
+ * @param [in] dim : largest dimension of the product
+ * @return number of blocks per dimension used by the block products
+ */
+static int cudaBlocks(cint dim)
+{
+    if(dim > 8000)
+    {
+        return 8;
+    }
+    if(dim > 6000)
+    {
+        return 6;
+    }
+    if(dim > 3000)
+    {
+        return 4;
+    }
+
+    return 2;
+}
+
+QString CudaBackend::name() const
+{
+    return "cuda";
+}
+
+bool CudaBackend::gemm(const cv::Mat &A, const cv::Mat &B, cv::Mat &res, cint flags, const CancellationToken *cancel)
+{
+    if(A.type() != B.type() || (A.type() != CV_32FC1 && A.type() != CV_64FC1))
+    {
+        return m_fallback.gemm(A, B, res, flags, cancel);
+    }
+
+    // the block product doesn't manage the transposes
+        cv::Mat l_A = (flags & cv::GEMM_1_T) ? cv::Mat(A.t()) : A;
+        cv::Mat l_B = (flags & cv::GEMM_2_T) ? cv::Mat(B.t()) : B;
+        int l_blocks = cudaBlocks(std::max(std::max(l_A.rows, l_A.cols), l_B.cols));
+
+    if(A.type() == CV_32FC1)
+    {
+        swCuda::blockMatrixMultiplicationF(l_A, l_B, res, l_blocks, cancel);
+    }
+    else
+    {
+        swCuda::blockMatrixMultiplicationD(l_A, l_B, res, l_blocks, cancel);
+    }
+
+    return !cancelled(cancel);
+}
+
+bool CudaBackend::syrk(const cv::Mat &A, cv::Mat &res, const CancellationToken *cancel, cbool)
+{
+    return gemm(A, A, res, cv::GEMM_2_T, cancel);
+}
+
+bool CudaBackend::svd(const cv::Mat &M, cv::Mat &S, cv::Mat &U, cv::Mat &VT)
+{
+    if(M.rows != M.cols)
+    {
+        return m_fallback.svd(M, S, U, VT);
+    }
+
+    cv::Mat l_S;
+    if(!swCuda::squareMatrixSingularValueDecomposition(M, l_S, U, VT))
+    {
+        return false;
+    }
+    S = l_S.diag().clone();
+
+    return true;
+}
+
+bool CudaBackend::cholesky(const cv::Mat &A, const cv::Mat &B, cv::Mat &X)
+{
+    return m_fallback.cholesky(A, B, X);
+}
+
+bool CudaBackend::eigen(const cv::Mat &A, cv::Mat &eigenValues, cv::Mat &eigenVectors)
+{
+    return m_fallback.eigen(A, eigenValues, eigenVectors);
+}
+
+#endif
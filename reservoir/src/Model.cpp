@@ -35,9 +35,11 @@
 static int s_numImage = 0;
 
 
-Model::Model() : m_trainingSuccess(false), m_verbose(true), m_reservoir(new Reservoir()) {}
+Model::Model() : m_trainingSuccess(false), m_verbose(true), m_stimulusDirectory("../data/input/"), m_streamChunkSize(0), m_streamEpochs(1), m_streamLearningRate(1e-3f),
+    m_reservoir(new Reservoir()) {}
 
-Model::Model(const ModelParameters &parameters) : m_parameters(parameters), m_trainingSuccess(false), m_verbose(true)
+Model::Model(const ModelParameters &parameters) : m_parameters(parameters), m_trainingSuccess(false), m_verbose(true), m_stimulusDirectory("../data/input/"),
+    m_streamChunkSize(0), m_streamEpochs(1), m_streamLearningRate(1e-3f), m_vocabularyHash(0), m_testSentenceTokenized(false)
 {
     m_reservoir = new Reservoir(m_parameters.m_nbNeurons, m_parameters.m_spectralRadius, m_parameters.m_inputScaling, m_parameters.m_leakRate, m_parameters.m_sparcity, m_parameters.m_ridge, m_verbose);
 }
@@ -57,6 +59,14 @@ void Model::resetModelParameters(const ModelParameters &newParameters, cbool ver
     m_parameters = newParameters;
     m_verbose    = verbose;
 
+    // the ids of the previous corpus are not reused
+        m_vocabulary.clear();
+        m_vocabularyHash = 0;
+        m_testSentenceTokenized = false;
+        m_trainSentenceTokens.clear();
+        m_recoveredTokensTrain.clear();
+        m_recoveredTokensTest.clear();
+
     // resert training state
         m_trainingSuccess = false;
 
@@ -84,16 +94,21 @@ void Model::setCCWAndStructure(const Sentence &CCW, const Sentence &structure)
     m_structure = structure;
 }
 
+void Model::setStimulusDirectory(const std::string &directory)
+{
+    m_stimulusDirectory = directory;
+}
+
 void Model::retrieveTrainSentences()
 {
     // generate open class word arrays
         Sentences l_trainOCW;
         generateOCWArray(m_trainMeaning, m_trainInfo, l_trainOCW);
 
-    // convert signal
-        Sentences l_recoveredConstructionTrain;
-        convertLOutputActivityInConstruction(m_3DMatSentencesOutputTrain, m_closedClassWords, l_recoveredConstructionTrain, 1);
-        attributeOcwToConstructions(l_recoveredConstructionTrain, l_trainOCW, m_recoveredSentencesTrain, "X");
+    // decode signal
+        std::vector<std::vector<int> > l_constructionIds;
+        decodeOutputActivity(m_3DMatSentencesOutputTrain, l_constructionIds, 1);
+        recoverSentences(l_constructionIds, l_trainOCW, m_recoveredSentencesTrain, m_recoveredTokensTrain);
 }
 
 void Model::retrieveTestsSentences()
@@ -106,19 +121,92 @@ void Model::retrieveTestsSentences()
         displaySentence(m_testInfo);
         displaySentence(l_testOCW);
 
-    // convert signal
-        Sentences l_recoveredConstructionTest;
-        convertLOutputActivityInConstruction(m_3DMatSentencesOutputTest, m_closedClassWords, l_recoveredConstructionTest, 2);
-        attributeOcwToConstructions(l_recoveredConstructionTest, l_testOCW, m_recoveredSentencesTest, "X");
+    // decode signal
+        std::vector<std::vector<int> > l_constructionIds;
+        decodeOutputActivity(m_3DMatSentencesOutputTest, l_constructionIds, 2);
+        recoverSentences(l_constructionIds, l_testOCW, m_recoveredSentencesTest, m_recoveredTokensTest);
 }
 
-void Model::sentences(Sentences &trainSentences, Sentences &trainResults, Sentences &testResults)
+void Model::recoverSentences(const std::vector<std::vector<int> > &constructionIds, const Sentences &OCW, Sentences &recovered, TokenizedSentences &recoveredTokens)
+{
+    int l_ocwId = m_vocabulary.intern("X");
+
+    // vocabulary ids of the closed class words
+        std::vector<int> l_ccwIds(m_closedClassWords.size());
+        for(size_t ii = 0; ii < m_closedClassWords.size(); ++ii)
+        {
+            l_ccwIds[ii] = m_vocabulary.intern(m_closedClassWords[ii]);
+        }
+
+        TokenizedSentences l_constructions;
+        std::vector<int> l_ids;
+        for(size_t ii = 0; ii < constructionIds.size(); ++ii)
+        {
+            l_ids.resize(constructionIds[ii].size());
+            for(size_t jj = 0; jj < l_ids.size(); ++jj)
+            {
+                l_ids[jj] = l_ccwIds[constructionIds[ii][jj]];
+            }
+            l_constructions.append(l_ids.empty() ? NULL : &l_ids[0], static_cast<int>(l_ids.size()));
+        }
+
+    // OCW attribution on the ids, the words are retrieved at the end
+        TokenizedSentences l_ocw;
+        m_vocabulary.tokenize(OCW, l_ocw);
+        while(l_ocw.nbSentences() < l_constructions.nbSentences())
+        {
+            l_ocw.append(NULL, 0);
+        }
+
+        attributeOcwToConstructions(l_constructions, l_ocw, l_ocwId, recoveredTokens);
+        m_vocabulary.sentences(recoveredTokens, recovered);
+}
+
+void Model::updateVocabulary()
+{
+    QString l_corpusPath = QString::fromStdString(m_parameters.m_corpusFilePath);
+    quint64 l_hash = CorpusCache::instance()->contentHash(l_corpusPath);
+    if(l_hash != 0 && l_hash == m_vocabularyHash)
+    {
+        return;
+    }
+
+    // the corpus ids are kept, the results already recovered are converted to them
+        CorpusCache::instance()->tokens(l_corpusPath, CORPUS_TRAIN_MEANING, m_vocabulary, m_trainSentenceTokens);
+        m_vocabulary.tokenize(m_recoveredSentencesTrain, m_recoveredTokensTrain);
+        m_vocabulary.tokenize(m_recoveredSentencesTest, m_recoveredTokensTest);
+        m_vocabularyHash = l_hash;
+        m_testSentenceTokenized = false;
+}
+
+void Model::sentences(Sentences &trainSentences, Sentences &trainResults, Sentences &testResults) const
 {
     trainSentences = m_trainSentence;
     trainResults   = m_recoveredSentencesTrain;
     testResults    = m_recoveredSentencesTest;
 }
 
+void Model::tokenizedSentences(TokenizedSentences &trainSentences, TokenizedSentences &trainResults, TokenizedSentences &testResults) const
+{
+    // the train sentences are only known after a training
+        if(m_trainSentence.empty())
+        {
+            trainSentences.clear();
+        }
+        else
+        {
+            trainSentences = m_trainSentenceTokens;
+        }
+
+    trainResults = m_recoveredTokensTrain;
+    testResults  = m_recoveredTokensTest;
+}
+
+const Vocabulary &Model::vocabulary() const
+{
+    return m_vocabulary;
+}
+
 
 void Model::displayResults(const bool trainResults, const bool testResults)
 {
@@ -178,98 +266,87 @@ void Model::computeResultsData(cbool trainResults,
         sendLogInfo("Start analysing results. \n", QColor(Qt::black));
     }
 
-    Sentences l_goal;
-    Sentences l_results;
+    // the sentences are compared on their ids, the results are tokenized when they are recovered and the goals once per corpus
+        const TokenizedSentences *l_goal, *l_results;
+        if(!trainResults)
+        {
+            if(!m_testSentenceTokenized)
+            {
+                m_vocabulary.tokenize(m_desiredSentencesTest.size() == 0 ? m_testSentence : m_desiredSentencesTest, m_testSentenceTokens);
+                m_testSentenceTokenized = true;
+            }
 
-    if(!trainResults)
-    {
-        l_results = m_recoveredSentencesTest;
+            l_goal    = &m_testSentenceTokens;
+            l_results = &m_recoveredTokensTest;
 
-        if(m_desiredSentencesTest.size() == 0)
-        {
-            l_goal = m_testSentence;
+            if(l_goal->nbSentences() != l_results->nbSentences())
+            {
+                std::cerr << "Error compare results : not the same number of sentences. " << std::endl;
+                sendLogInfo("Error compare results : not the same number of sentences. \n", QColor(Qt::red));
+            }
         }
         else
         {
-            l_goal = m_desiredSentencesTest;
+            l_goal    = &m_trainSentenceTokens;
+            l_results = &m_recoveredTokensTrain;
         }
 
-        if(l_goal.size() != m_recoveredSentencesTest.size())
+        const TokenizedSentences &l_goalTokens = *l_goal, &l_resultTokens = *l_results;
+
+        int l_ocwId = m_vocabulary.intern("X");
+        std::vector<int> l_ccwIds(m_CCW.size());
+        for(size_t ii = 0; ii < m_CCW.size(); ++ii)
         {
-            std::cerr << "Error compare results : not the same number of sentences. " << std::endl;
-            sendLogInfo("Error compare results : not the same number of sentences. \n", QColor(Qt::red));
+            l_ccwIds[ii] = m_vocabulary.intern(m_CCW[ii]);
+        }
+
+        std::vector<char> l_isCCW(m_vocabulary.size(), 0);
+        for(size_t ii = 0; ii < l_ccwIds.size(); ++ii)
+        {
+            l_isCCW[l_ccwIds[ii]] = 1;
         }
-    }
-    else
-    {
-        l_goal = m_trainSentence;
-        l_results = m_recoveredSentencesTrain;
-    }
 
-    Sentences l_goalCCWOnly, l_resultsCCWOnly;
-    Sentences l_goalAll, l_resultAll;
+    std::vector<std::vector<int> > l_goalCCWOnly, l_resultsCCWOnly;
+    std::vector<std::vector<int> > l_goalAll, l_resultAll;
 
     std::vector<int> l_diffSizesOCW;
 
     // suppress OCW from the sentences
-    for(int aa = 0; aa < l_goal.size(); ++aa)
+    for(int aa = 0; aa < l_goalTokens.nbSentences(); ++aa)
     {
-        Sentence l_currentGoal = l_goal[aa];
-        Sentence l_currentRes  = l_results[aa];
-        Sentence l_currentGoalCCWOnly, l_currentResCCWOnly, l_currentGoalOCWOnly, l_currentResultsOCWOnly;
-        Sentence l_currentGoalAll, l_currenResultAll;
+        std::vector<int> l_currentGoalCCWOnly, l_currentResCCWOnly, l_currentGoalAll, l_currenResultAll;
+        int l_nbGoalOCW = 0, l_nbResultsOCW = 0;
 
         // goal
-            for(int ii = 0; ii < l_currentGoal.size(); ++ii)
+            const int *l_currentGoal = l_goalTokens.words(aa);
+            for(int ii = 0; ii < l_goalTokens.length(aa); ++ii)
             {
-                bool l_addWord = false;
-
-                for(int jj = 0; jj < m_CCW.size(); ++jj)
-                {
-                    if(l_currentGoal[ii] == m_CCW[jj])
-                    {
-                        l_addWord = true;
-                        break;
-                    }
-                }
-
-                if(l_addWord)
+                if(l_isCCW[l_currentGoal[ii]])
                 {
                     l_currentGoalCCWOnly.push_back(l_currentGoal[ii]);
                     l_currentGoalAll.push_back(l_currentGoal[ii]);
                 }
                 else
                 {
-                    l_currentGoalOCWOnly.push_back(l_currentGoal[ii]);
-                    l_currentGoalAll.push_back("X");
+                    ++l_nbGoalOCW;
+                    l_currentGoalAll.push_back(l_ocwId);
                 }
             }
 
-
-        // result
-            for(int ii = 0; ii < l_currentRes.size(); ++ii)
+        // result, a missing result is an empty sentence
+            int l_resultLength = aa < l_resultTokens.nbSentences() ? l_resultTokens.length(aa) : 0;
+            const int *l_currentRes = l_resultLength > 0 ? l_resultTokens.words(aa) : NULL;
+            for(int ii = 0; ii < l_resultLength; ++ii)
             {
-                bool l_addWord = false;
-
-                for(int jj = 0; jj < m_CCW.size(); ++jj)
-                {
-                    if(l_currentRes[ii] == m_CCW[jj])
-                    {
-                        l_addWord = true;
-                        break;
-                    }
-                }
-
-                if(l_addWord)
+                if(l_isCCW[l_currentRes[ii]])
                 {
-
                     l_currentResCCWOnly.push_back(l_currentRes[ii]);
                     l_currenResultAll.push_back(l_currentRes[ii]);
                 }
                 else
                 {
-                    l_currentResultsOCWOnly.push_back(l_currentRes[ii]);
-                    l_currenResultAll.push_back("X");
+                    ++l_nbResultsOCW;
+                    l_currenResultAll.push_back(l_ocwId);
                 }
             }
 
@@ -278,7 +355,7 @@ void Model::computeResultsData(cbool trainResults,
         l_goalAll.push_back(l_currentGoalAll);
         l_resultAll.push_back(l_currenResultAll);
 
-        l_diffSizesOCW.push_back(static_cast<int>(l_currentResultsOCWOnly.size() - l_currentGoalOCWOnly.size()));
+        l_diffSizesOCW.push_back(l_nbResultsOCW - l_nbGoalOCW);
     }
 
     // reset mean results
@@ -304,10 +381,10 @@ void Model::computeResultsData(cbool trainResults,
     // compute the stats
     for(int ii = 0; ii < l_goalCCWOnly.size(); ++ii)
     {
-        Sentence l_currentGoalCCWOnly = l_goalCCWOnly[ii];
-        Sentence l_currentResCCWOnly  = l_resultsCCWOnly[ii];
-        Sentence l_currentGoalAll     = l_goalAll[ii];
-        Sentence l_currentResAll      = l_resultAll[ii];
+        const std::vector<int> &l_currentGoalCCWOnly = l_goalCCWOnly[ii];
+        const std::vector<int> &l_currentResCCWOnly  = l_resultsCCWOnly[ii];
+        const std::vector<int> &l_currentGoalAll     = l_goalAll[ii];
+        const std::vector<int> &l_currentResAll      = l_resultAll[ii];
 
         int l_correctPositionAndWordCCWOnly = 0;
         int l_correctPositionAndWordAll = 0;
@@ -394,9 +471,9 @@ void Model::computeResultsData(cbool trainResults,
         meanAbsoluteAll /= l_goalAll.size();
 }
 
-void Model::saveTraining(const std::string &pathDirectory)
+bool Model::saveTraining(const std::string &pathDirectory)
 {    
-    m_reservoir->saveTraining(pathDirectory);
+    return m_reservoir->saveTraining(pathDirectory);
 }
 
 void Model::saveW(const std::string &pathDirectory)
@@ -414,9 +491,16 @@ void Model::saveParamFile(const std::string &pathDirectory)
     m_reservoir->saveParamFile(pathDirectory);
 }
 
-void Model::saveReplay(const std::string &pathDirectory)
+bool Model::saveReplay(const std::string &pathDirectory)
 {
-    save3DMatrixToText(QString::fromStdString(pathDirectory), m_internalStatesTrain);
+    QString l_pathReplay = QString::fromStdString(pathDirectory);
+
+    if(l_pathReplay.endsWith(".rpl", Qt::CaseInsensitive))
+    {
+        return ReplayStore::save(l_pathReplay, m_internalStatesTrain);
+    }
+
+    return save3DMatrix(l_pathReplay, m_internalStatesTrain);
 }
 
 void Model::loadTraining(const std::string &pathDirectory)
@@ -435,6 +519,34 @@ void Model::loadWIn(const std::string &pathDirectory)
     m_reservoir->loadWIn(pathDirectory);
 }
 
+void Model::setTraining(const cv::Mat &w, const cv::Mat &wIn, const cv::Mat &wOut)
+{
+    m_reservoir->setTraining(w, wIn, wOut);
+    m_trainingSuccess = true;
+}
+
+void Model::setSketchRank(cint rank)
+{
+    m_reservoir->setSketchRank(rank);
+}
+
+void Model::setIterativeSolver(cbool enabled, cint maxIterations, cfloat tolerance)
+{
+    m_reservoir->setIterativeSolver(enabled, maxIterations, tolerance);
+}
+
+void Model::setReadoutWarmStart(cbool enabled)
+{
+    m_reservoir->setWarmStart(enabled);
+}
+
+void Model::setStreamingTraining(cint chunkSize, cint epochs, cfloat learningRate)
+{
+    m_streamChunkSize    = chunkSize;
+    m_streamEpochs       = epochs;
+    m_streamLearningRate = learningRate;
+}
+
 Reservoir *Model::reservoir()
 {
     return m_reservoir;
@@ -504,24 +616,30 @@ bool Model::launchTraining()
 
     // call python for generating new stim files                        
         std::string l_pythonCmd("python ../../scripts/python/generate_stim.py ");
-        std::string l_pythonCall = l_pythonCmd + l_corpusFilePath + " train " + l_CCWPythonArg + " " + l_structurePythonArg;
+        std::string l_pythonCall = l_pythonCmd + l_corpusFilePath + " train " + l_CCWPythonArg + " " + l_structurePythonArg + " npy " + m_stimulusDirectory;
         sendLogInfo(QString::fromStdString(displayTime("Generate stim files with Python ", l_trainingTime, false, m_verbose)), QColor(Qt::black));
             system(l_pythonCall.c_str());
         sendLogInfo(QString::fromStdString(displayTime("End generation ", l_trainingTime, true, m_verbose)), QColor(Qt::black));
 
+    // streaming : the stim files are read by chunks during the training
+        if(m_streamChunkSize > 0)
+        {
+            return launchStreamingTraining(l_trainingTime);
+        }
+
     // init matrices
         cv::Mat l_3DMatStimMeanTrain, l_3DMatStimSentTrain;
 
     // load input matrices created in the python script)
-        load3DMatrixFromNpPythonSaveTextF(QString("../data/input/stim_mean_train.txt"), l_3DMatStimMeanTrain);
-        load3DMatrixFromNpPythonSaveTextF(QString("../data/input/stim_sent_train.txt"), l_3DMatStimSentTrain);
+        load3DMatrixF(QString::fromStdString(m_stimulusDirectory + "stim_mean_train.npy"), l_3DMatStimMeanTrain);
+        load3DMatrixF(QString::fromStdString(m_stimulusDirectory + "stim_sent_train.npy"), l_3DMatStimSentTrain);
 
-    // retrieve corpus train data
-        QVector<QStringList> l_trainMeaning,l_trainInfo,l_trainSentence, l_inused;
-        extractAllDataFromCorpusFile(m_parameters.m_corpusFilePath.c_str(), l_trainMeaning,l_trainInfo,l_trainSentence, l_inused,l_inused,l_inused);
-        convQt2DString2Std2DString(l_trainMeaning, m_trainMeaning);
-        convQt2DString2Std2DString(l_trainInfo, m_trainInfo);
-        convQt2DString2Std2DString(l_trainSentence, m_trainSentence);
+    // retrieve corpus train data, the corpus is only parsed the first time
+        QString l_corpusPath = QString::fromStdString(m_parameters.m_corpusFilePath);
+        CorpusCache::instance()->sentences(l_corpusPath, CORPUS_TRAIN_DATA, m_trainMeaning);
+        CorpusCache::instance()->sentences(l_corpusPath, CORPUS_TRAIN_INFO, m_trainInfo);
+        CorpusCache::instance()->sentences(l_corpusPath, CORPUS_TRAIN_MEANING, m_trainSentence);
+        updateVocabulary();
 
     // send train input matrices to be displayed
         sendTrainInputMatrixSignal(l_3DMatStimMeanTrain,l_3DMatStimSentTrain,m_trainSentence);
@@ -555,6 +673,42 @@ bool Model::launchTraining()
     return true;
 }
 
+bool Model::launchStreamingTraining(const clock_t trainingTime)
+{
+    // retrieve corpus train data, the corpus is only parsed the first time
+        QString l_corpusPath = QString::fromStdString(m_parameters.m_corpusFilePath);
+        CorpusCache::instance()->sentences(l_corpusPath, CORPUS_TRAIN_DATA, m_trainMeaning);
+        CorpusCache::instance()->sentences(l_corpusPath, CORPUS_TRAIN_INFO, m_trainInfo);
+        CorpusCache::instance()->sentences(l_corpusPath, CORPUS_TRAIN_MEANING, m_trainSentence);
+        updateVocabulary();
+
+    // set random generator
+        if(m_parameters.m_randomSeedNumberGenerator)
+        {
+            srand (time(NULL));
+        }
+        else
+        {
+            srand(m_parameters.m_seedNumberGenerator);
+        }
+
+    // train reservoir
+        NpySentenceSource l_source(QString::fromStdString(m_stimulusDirectory + "stim_mean_train.npy"), QString::fromStdString(m_stimulusDirectory + "stim_sent_train.npy"));
+
+        sendLogInfo(QString::fromStdString(displayTime("Start reservoir streaming training ", trainingTime, false, m_verbose)), QColor(Qt::black));
+            if(!m_reservoir->trainStreaming(l_source, m_streamChunkSize, m_streamEpochs, m_streamLearningRate))
+            {
+                sendLogInfo("Abort training.\n", QColor(Qt::red));
+                return false;
+            }
+        sendLogInfo(QString::fromStdString(displayTime("End reservoir streaming training ", trainingTime, true, m_verbose)), QColor(Qt::black));
+
+        m_recoveredSentencesTrain.clear();
+        m_recoveredTokensTrain.clear();
+        m_trainingSuccess = true;
+
+    return true;
+}
 
 bool Model::launchTests()
 {
@@ -582,11 +736,11 @@ bool Model::launchTests()
             closedClassWords(m_closedClassWords, "X");
         }
 
-    // retrieve corpus test data
-        QVector<QStringList> l_testMeaning,l_testInfo, l_inused;
-        extractAllDataFromCorpusFile(m_parameters.m_corpusFilePath.c_str(), l_inused,l_inused,l_inused, l_testMeaning,l_testInfo,l_inused);
-        convQt2DString2Std2DString(l_testMeaning, m_testMeaning);
-        convQt2DString2Std2DString(l_testInfo, m_testInfo);
+    // retrieve corpus test data, the corpus is only parsed the first time
+        QString l_corpusPath = QString::fromStdString(m_parameters.m_corpusFilePath);
+        CorpusCache::instance()->sentences(l_corpusPath, CORPUS_TEST_DATA, m_testMeaning);
+        CorpusCache::instance()->sentences(l_corpusPath, CORPUS_TEST_INFO, m_testInfo);
+        updateVocabulary();
 
         if(m_testMeaning.size() == 0)
         {
@@ -635,7 +789,7 @@ bool Model::launchTests()
     // call python for generating new stim files
         std::string l_pythonCmd("python ../../scripts/python/generate_stim.py ");
         std::string l_pythonCall;
-        l_pythonCall = l_pythonCmd + l_corpusFilePath + " test " + l_CCWPythonArg + " " + l_structurePythonArg;
+        l_pythonCall = l_pythonCmd + l_corpusFilePath + " test " + l_CCWPythonArg + " " + l_structurePythonArg + " npy " + m_stimulusDirectory;
 
         sendLogInfo(QString::fromStdString(displayTime("Generate stim files with Python ", l_testTime, false, m_verbose)), QColor(Qt::black));
             system(l_pythonCall.c_str());
@@ -645,7 +799,7 @@ bool Model::launchTests()
         cv::Mat l_3DMatStimMeanTest, l_internalStatesTest;
 
     // load input matrices created in the python script)
-        load3DMatrixFromNpPythonSaveTextF(QString("../data/input/stim_mean_test.txt"),   l_3DMatStimMeanTest);
+        load3DMatrixF(QString::fromStdString(m_stimulusDirectory + "stim_mean_test.npy"),   l_3DMatStimMeanTest);
 
     // test reservoir
         sendLogInfo(QString::fromStdString(displayTime("Start reservoir testing ", l_testTime, false, m_verbose)), QColor(Qt::black));
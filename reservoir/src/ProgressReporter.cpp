@@ -0,0 +1,116 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+
+/**
+ * \file ProgressReporter.cpp
+ * \brief defines ProgressCounter and ProgressReporter
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#include "ProgressReporter.h"
+
+ProgressCounter::ProgressCounter() : m_done(0), m_version(0), m_total(0), m_sampledVersion(-1), m_sampledDone(-1)
+{}
+
+void ProgressCounter::set(cint done, cint total, const QString &label)
+{
+    QMutexLocker l_locker(&m_phaseLock);
+
+    m_label = label;
+    m_total = total;
+    m_done.fetchAndStoreOrdered(done);
+    m_version.fetchAndAddOrdered(1);
+}
+
+void ProgressCounter::advance(cint steps)
+{
+    m_done.fetchAndAddRelaxed(steps);
+}
+
+bool ProgressCounter::sample(int &done, int &total, QString &label)
+{
+    QMutexLocker l_locker(&m_phaseLock);
+
+    int l_version = m_version;
+    done  = m_done;
+    total = m_total;
+    label = m_label;
+
+    if(l_version == m_sampledVersion && done == m_sampledDone)
+    {
+        return false;
+    }
+
+    m_sampledVersion = l_version;
+    m_sampledDone    = done;
+
+    return true;
+}
+
+ProgressReporter::ProgressReporter(ProgressCounter *counter, ProgressListener *listener, cint periodMs) :
+    m_counter(counter), m_listener(listener), m_periodMs(periodMs), m_stopped(false)
+{}
+
+ProgressReporter::~ProgressReporter()
+{
+    stop();
+}
+
+void ProgressReporter::stop()
+{
+    m_lock.lock();
+        m_stopped = true;
+        m_stopCondition.wakeAll();
+    m_lock.unlock();
+
+    wait();
+}
+
+void ProgressReporter::run()
+{
+    m_lock.lock();
+        while(!m_stopped)
+        {
+            m_stopCondition.wait(&m_lock, m_periodMs);
+
+            m_lock.unlock();
+                report();
+            m_lock.lock();
+        }
+    m_lock.unlock();
+
+    // progress set just before the stop
+        report();
+}
+
+void ProgressReporter::report()
+{
+    int l_done, l_total;
+    QString l_label;
+
+    if(m_counter->sample(l_done, l_total, l_label))
+    {
+        m_listener->reportProgress(l_done, l_total, l_label);
+    }
+}
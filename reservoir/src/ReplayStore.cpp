@@ -0,0 +1,302 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+/**
+ * \file ReplayStore.cpp
+ * \brief defines ReplayStore
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#include "ReplayStore.h"
+#include "TaskScheduler.h"
+
+static const char g_replayStoreMagic[] = "RPLSTORE";
+static const quint32 g_replayStoreVersion = 1;
+
+/**
+ * @brief Encode the tiles of a group of sentences, a tile is the block of neurons of a sentence for all the timesteps
+ */
+class EncodeTilesTask : public SentenceTask
+{
+    public :
+
+        EncodeTilesTask(const cv::Mat &xTot, cint firstSentence, cint nbBlocks, cint neuronsPerTile, cbool compress, std::vector<QByteArray> &tiles) :
+            m_xTot(xTot), m_firstSentence(firstSentence), m_nbBlocks(nbBlocks), m_neuronsPerTile(neuronsPerTile), m_compress(compress), m_tiles(tiles)
+        {}
+
+        void run(cint begin, cint end)
+        {
+            for(int ii = begin; ii < end; ++ii)
+            {
+                int l_idSentence    = m_firstSentence + ii / m_nbBlocks;
+                int l_firstNeuron   = (ii % m_nbBlocks) * m_neuronsPerTile;
+                int l_nbTileNeurons = std::min(m_neuronsPerTile, m_xTot.size[1] - l_firstNeuron);
+
+                // neurons are contiguous in memory for a sentence : a tile is a single copy
+                const char *l_tileData = reinterpret_cast<const char*>(m_xTot.data + l_idSentence * m_xTot.step[0] + l_firstNeuron * m_xTot.step[1]);
+                int l_tileSize = static_cast<int>(l_nbTileNeurons * m_xTot.step[1]);
+
+                if(m_compress)
+                {
+                    m_tiles[ii] = qCompress(reinterpret_cast<const uchar*>(l_tileData), l_tileSize);
+                }
+                else
+                {
+                    m_tiles[ii] = QByteArray(l_tileData, l_tileSize);
+                }
+            }
+        }
+
+    private :
+
+        const cv::Mat &m_xTot;
+        int m_firstSentence;
+        int m_nbBlocks;
+        int m_neuronsPerTile;
+        bool m_compress;
+        std::vector<QByteArray> &m_tiles;
+};
+
+ReplayStore::ReplayStore(cint cacheSizeMB) : m_nbSentences(0), m_nbNeurons(0), m_nbTimeSteps(0), m_neuronsPerTile(0), m_nbBlocks(0), m_compressed(false)
+{
+    m_tilesCache.setMaxCost(cacheSizeMB * 1024);
+}
+
+bool ReplayStore::save(const QString &pathFile, const cv::Mat &xTot, cint neuronsPerTile, cbool compress)
+{
+    if(xTot.dims != 3 || xTot.depth() != CV_32F)
+    {
+        std::cerr << "-ERROR : ReplayStore::save -> x tot must be a 3D float matrix. " << std::endl;
+        return false;
+    }
+
+    QFile l_file(pathFile);
+    if(!l_file.open(QIODevice::WriteOnly))
+    {
+        std::cerr << "-ERROR : ReplayStore::save -> can not write replay file. " << std::endl;
+        return false;
+    }
+
+    quint32 l_nbSentences = xTot.size[0], l_nbNeurons = xTot.size[1], l_nbTimeSteps = xTot.size[2];
+    quint32 l_neuronsPerTile = std::max(1, neuronsPerTile);
+    quint32 l_nbBlocks = (l_nbNeurons + l_neuronsPerTile - 1) / l_neuronsPerTile;
+    int l_nbTiles = static_cast<int>(l_nbSentences * l_nbBlocks);
+
+    QDataStream l_out(&l_file);
+    l_out.setByteOrder(QDataStream::LittleEndian);
+
+    // header
+        l_out.writeRawData(g_replayStoreMagic, 8);
+        l_out << g_replayStoreVersion << l_nbSentences << l_nbNeurons << l_nbTimeSteps << l_neuronsPerTile
+              << quint32(compress ? 1 : 0) << quint32(l_nbTiles);
+
+    // reserve the index, it will be written when the tiles sizes are known
+        qint64 l_indexOffset = l_file.pos();
+        bool l_success = l_out.writeRawData(QByteArray(l_nbTiles * 12, 0).constData(), l_nbTiles * 12) == l_nbTiles * 12;
+
+    std::vector<quint64> l_tilesOffset(l_nbTiles);
+    std::vector<quint32> l_tilesSize(l_nbTiles);
+
+    // tiles are encoded in parallel by groups of sentences and written sequentially
+        cint l_sentencesPerGroup = 32;
+        for(int ii = 0; ii < static_cast<int>(l_nbSentences) && l_success; ii += l_sentencesPerGroup)
+        {
+            int l_nbGroupTiles = static_cast<int>(std::min<quint32>(l_sentencesPerGroup, l_nbSentences - ii) * l_nbBlocks);
+            std::vector<QByteArray> l_groupTiles(l_nbGroupTiles);
+
+            EncodeTilesTask l_encode(xTot, ii, static_cast<int>(l_nbBlocks), static_cast<int>(l_neuronsPerTile), compress, l_groupTiles);
+            TaskScheduler::instance()->parallelFor(l_encode, l_nbGroupTiles);
+
+            for(int jj = 0; jj < l_nbGroupTiles && l_success; ++jj)
+            {
+                int l_idTile = ii * l_nbBlocks + jj;
+                l_tilesOffset[l_idTile] = static_cast<quint64>(l_file.pos());
+                l_tilesSize[l_idTile]   = static_cast<quint32>(l_groupTiles[jj].size());
+                l_success = l_out.writeRawData(l_groupTiles[jj].constData(), l_groupTiles[jj].size()) == l_groupTiles[jj].size();
+            }
+        }
+
+    // index
+        l_success = l_success && l_file.seek(l_indexOffset);
+        for(int ii = 0; ii < l_nbTiles && l_success; ++ii)
+        {
+            l_out << l_tilesOffset[ii] << l_tilesSize[ii];
+        }
+
+    // the stream of Qt 4 doesn't report the failed writes, the file does
+        l_success = l_success && l_file.flush() && l_file.error() == QFile::NoError && l_out.status() == QDataStream::Ok;
+        if(!l_success)
+        {
+            std::cerr << "-ERROR : ReplayStore::save -> can not write replay file. " << std::endl;
+            l_file.close();
+            l_file.remove();
+        }
+
+    return l_success;
+}
+
+bool ReplayStore::open(const QString &pathFile)
+{
+    close();
+
+    m_file.setFileName(pathFile);
+    if(!m_file.open(QIODevice::ReadOnly))
+    {
+        std::cerr << "-ERROR : ReplayStore::open -> can not open replay file. " << std::endl;
+        return false;
+    }
+
+    QDataStream l_in(&m_file);
+    l_in.setByteOrder(QDataStream::LittleEndian);
+
+    char l_magic[8];
+    quint32 l_version, l_compression, l_nbTiles;
+    l_in.readRawData(l_magic, 8);
+    l_in >> l_version >> m_nbSentences >> m_nbNeurons >> m_nbTimeSteps >> m_neuronsPerTile >> l_compression >> l_nbTiles;
+
+    if(memcmp(l_magic, g_replayStoreMagic, 8) != 0 || l_version != g_replayStoreVersion || m_neuronsPerTile == 0)
+    {
+        std::cerr << "-ERROR : ReplayStore::open -> not a replay store file. " << std::endl;
+        close();
+        return false;
+    }
+
+    m_nbBlocks   = (m_nbNeurons + m_neuronsPerTile - 1) / m_neuronsPerTile;
+    m_compressed = (l_compression == 1);
+
+    if(l_nbTiles != m_nbSentences * m_nbBlocks)
+    {
+        std::cerr << "-ERROR : ReplayStore::open -> invalid tiles number. " << std::endl;
+        close();
+        return false;
+    }
+
+    m_tilesOffset.resize(l_nbTiles);
+    m_tilesSize.resize(l_nbTiles);
+    for(quint32 ii = 0; ii < l_nbTiles; ++ii)
+    {
+        l_in >> m_tilesOffset[ii] >> m_tilesSize[ii];
+    }
+
+    if(l_in.status() != QDataStream::Ok)
+    {
+        std::cerr << "-ERROR : ReplayStore::open -> truncated index. " << std::endl;
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void ReplayStore::close()
+{
+    if(m_file.isOpen())
+    {
+        m_file.close();
+    }
+
+    m_tilesCache.clear();
+    m_tilesOffset.clear();
+    m_tilesSize.clear();
+    m_nbSentences = m_nbNeurons = m_nbTimeSteps = m_neuronsPerTile = m_nbBlocks = 0;
+}
+
+bool ReplayStore::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+int ReplayStore::sentencesNumber() const
+{
+    return static_cast<int>(m_nbSentences);
+}
+
+int ReplayStore::neuronsNumber() const
+{
+    return static_cast<int>(m_nbNeurons);
+}
+
+int ReplayStore::timeStepsNumber() const
+{
+    return static_cast<int>(m_nbTimeSteps);
+}
+
+cv::Mat *ReplayStore::tile(cint idSentence, cint idBlock)
+{
+    int l_idTile = idSentence * m_nbBlocks + idBlock;
+
+    cv::Mat *l_tile = m_tilesCache.object(l_idTile);
+    if(l_tile)
+    {
+        return l_tile;
+    }
+
+    if(!m_file.seek(static_cast<qint64>(m_tilesOffset[l_idTile])))
+    {
+        return NULL;
+    }
+
+    QByteArray l_data = m_file.read(m_tilesSize[l_idTile]);
+    if(m_compressed)
+    {
+        l_data = qUncompress(l_data);
+    }
+
+    int l_nbTileNeurons = std::min<int>(m_neuronsPerTile, m_nbNeurons - idBlock * m_neuronsPerTile);
+    if(l_data.size() != static_cast<int>(l_nbTileNeurons * m_nbTimeSteps * sizeof(float)))
+    {
+        std::cerr << "-ERROR : ReplayStore::tile -> invalid tile " << l_idTile << ". " << std::endl;
+        return NULL;
+    }
+
+    l_tile = new cv::Mat(l_nbTileNeurons, m_nbTimeSteps, CV_32FC1);
+    memcpy(l_tile->data, l_data.constData(), l_data.size());
+
+    m_tilesCache.insert(l_idTile, l_tile, std::max(1, l_data.size() / 1024));
+
+    return l_tile;
+}
+
+bool ReplayStore::neuronActivity(cint idSentence, cint idNeuron, QVector<double> &activity)
+{
+    if(idSentence < 0 || idSentence >= static_cast<int>(m_nbSentences) || idNeuron < 0 || idNeuron >= static_cast<int>(m_nbNeurons))
+    {
+        return false;
+    }
+
+    cv::Mat *l_tile = tile(idSentence, idNeuron / m_neuronsPerTile);
+    if(!l_tile)
+    {
+        return false;
+    }
+
+    const float *l_values = l_tile->ptr<float>(idNeuron % m_neuronsPerTile);
+
+    activity.resize(m_nbTimeSteps);
+    for(int ii = 0; ii < static_cast<int>(m_nbTimeSteps); ++ii)
+    {
+        activity[ii] = static_cast<double>(l_values[ii]);
+    }
+
+    return true;
+}
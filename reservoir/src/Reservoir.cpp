@@ -36,8 +36,9 @@
 // Qt
 #include <QtGui>
 
+#include "TaskScheduler.h"
 
-#include <omp.h>
+#include <limits>
 
 using namespace std;
 
@@ -61,9 +62,59 @@ static void fillRandomMat_(cv::Mat &mat)
     }
 }
 
+/**
+ * @brief orthonormalizeColumns : modified Gram-Schmidt in double precision, done twice for keeping the orthogonality,
+ *  the columns depending on the previous ones are removed
+ * @param [in,out] mat : [n x k] (CV_32FC1), replaced by an orthonormal basis [n x rank] of its columns
+ * @return rank
+ */
+static int orthonormalizeColumns(cv::Mat &mat)
+{
+    cv::Mat l_rows;
+    cv::Mat(mat.t()).convertTo(l_rows, CV_64FC1);
+
+    int l_size = l_rows.cols, l_rank = 0;
+    for(int ii = 0; ii < l_rows.rows; ++ii)
+    {
+        double *l_row = l_rows.ptr<double>(ii);
+        double l_initialNorm = cv::norm(l_rows.row(ii));
+
+        for(int pass = 0; pass < 2; ++pass)
+        {
+            for(int jj = 0; jj < l_rank; ++jj)
+            {
+                const double *l_basis = l_rows.ptr<double>(jj);
+                double l_dot = 0.0;
+                for(int kk = 0; kk < l_size; ++kk)
+                {
+                    l_dot += l_basis[kk] * l_row[kk];
+                }
+                for(int kk = 0; kk < l_size; ++kk)
+                {
+                    l_row[kk] -= l_dot * l_basis[kk];
+                }
+            }
+        }
+
+        // the column is in the span of the previous ones up to the float precision of the products
+            double l_norm = cv::norm(l_rows.row(ii));
+            if(l_norm <= 10.0 * std::numeric_limits<float>::epsilon() * l_initialNorm || l_norm == 0.0)
+            {
+                continue;
+            }
+
+        cv::Mat l_basis = l_rows.row(l_rank);
+        cv::Mat(l_rows.row(ii) * (1.0 / l_norm)).copyTo(l_basis);
+        ++l_rank;
+    }
+
+    cv::Mat(l_rows.rowRange(0, l_rank).t()).convertTo(mat, CV_32FC1);
+    return l_rank;
+}
+
 Reservoir::Reservoir()
 {
-    m_numThread = omp_get_max_threads( );
+    m_numThread = 0;
 
     m_initialized = false;
     m_verbose = true;
@@ -75,7 +126,13 @@ Reservoir::Reservoir()
     m_useW   = false;
     m_useWIn = false;
 
-    m_stopLoop = false;
+    m_cpuBackend   = LinearAlgebraBackend::LAPACK;
+    m_sketchRank   = 0;
+    m_sketchError  = -1.f;
+    m_iterativeSolver = false;
+    m_warmStart       = false;
+    m_maxIterations   = 50;
+    m_tolerance       = 1e-4f;
 
 }
 
@@ -92,7 +149,7 @@ Reservoir::Reservoir(cuint nbNeurons, cfloat spectralRadius, cfloat inputScaling
  m_nbNeurons(nbNeurons), m_spectralRadius(spectralRadius), m_inputScaling(inputScaling), m_leakRate(leakRate), m_ridge(ridge), m_verbose(verbose)
 {
 
-    m_numThread = omp_get_max_threads( );
+    m_numThread = 0;
     m_sendMatrices = true;
 
     if(sparcity > 0.f)
@@ -108,6 +165,13 @@ Reservoir::Reservoir(cuint nbNeurons, cfloat spectralRadius, cfloat inputScaling
     m_useW   = false;
     m_useWIn = false;
 
+    m_cpuBackend   = LinearAlgebraBackend::LAPACK;
+    m_sketchRank   = 0;
+    m_sketchError  = -1.f;
+    m_iterativeSolver = false;
+    m_warmStart       = false;
+    m_maxIterations   = 50;
+    m_tolerance       = 1e-4f;
 }
 
 void Reservoir::setParameters(cuint nbNeurons, cfloat spectralRadius, cfloat inputScaling, cfloat leakRate, cfloat sparcity, cfloat ridge, cbool verbose)
@@ -183,11 +247,49 @@ void Reservoir::generateWIn(cuint dimInput)
     }
 }
 
+bool Reservoir::checkLoadedMatrices()
+{
+    if(m_useW && m_useWIn)
+    {
+        if(m_w.rows != m_wIn.rows)
+        {
+            emit sendLogInfo("Loaded w and loaded wIn don't use the same number of neurons : W -> " + QString::number(m_w.rows) +" wIn -> " + QString::number(m_wIn.rows) + "\n", QColor(Qt::red));
+            m_progress.set(0, 100, QString("Error with loaded matrices."));
+            return false;
+        }
+    }
+    else if(m_useW)
+    {
+        if(m_w.rows != m_nbNeurons)
+        {
+            emit sendLogInfo("Loaded w number of neurons is different from the current Neurons number : W -> " + QString::number(m_w.rows) +" N -> " + QString::number(m_nbNeurons) + "\n", QColor(Qt::red));
+            m_progress.set(0, 100, QString("Error with loaded matrices."));
+            return false;
+        }
+    }
+    else if(m_useWIn)
+    {
+        if(m_wIn.rows != m_nbNeurons)
+        {
+            emit sendLogInfo("Loaded wIn number of neurons is different from the current Neurons number : W -> " + QString::number(m_wIn.rows) +" N -> " + QString::number(m_nbNeurons) + "\n", QColor(Qt::red));
+            m_progress.set(0, 100, QString("Error with loaded matrices."));
+            return false;
+        }
+    }
+
+    return true;
+}
+
 bool Reservoir::train(const cv::Mat &meaningInputTrain, const cv::Mat &teacher, cv::Mat &sentencesOutputTrain, cv::Mat &xTot)
 {
-    // update progress bar
-        int l_steps = 0;
-        emit sendComputingState(0, meaningInputTrain.size[0]*2, QString("Build X"));
+    // update progress bar, sampled by the reporter thread, X is the first half with one step per timestep
+        int l_nbTimesteps = meaningInputTrain.size[0] * meaningInputTrain.size[1];
+        m_progress.set(0, l_nbTimesteps * 2, QString("Build X"));
+        ProgressReporter l_reporter(&m_progress, this);
+        l_reporter.start();
+
+    // the loops of the call share the thread budget of the reservoir
+        TaskScheduler::instance()->setThreadBudget(m_numThread);
 
     // init time
         m_oTime = clock();
@@ -199,580 +301,638 @@ bool Reservoir::train(const cv::Mat &meaningInputTrain, const cv::Mat &teacher,
         generateWIn(meaningInputTrain.size[2]);
 
     // check if loaded w and loaded wIn have the same dimension 0
-        if(m_useW && m_useWIn)
-        {
-            if(m_w.rows != m_wIn.rows)
-            {
-                emit sendLogInfo("Loaded w and loaded wIn don't use the same number of neurons : W -> " + QString::number(m_w.rows) +" wIn -> " + QString::number(m_wIn.rows) + "\n", QColor(Qt::red));
-                emit sendComputingState(0, 100, QString("Error with loaded matrices."));
-                return false;
-            }
-        }
-        else if(m_useW)
-        {
-            if(m_w.rows != m_nbNeurons)
-            {
-                emit sendLogInfo("Loaded w number of neurons is different from the current Neurons number : W -> " + QString::number(m_w.rows) +" N -> " + QString::number(m_nbNeurons) + "\n", QColor(Qt::red));
-                emit sendComputingState(0, 100, QString("Error with loaded matrices."));
-                return false;
-            }
-        }
-        else if(m_useWIn)
+        if(!checkLoadedMatrices())
         {
-            if(m_wIn.rows != m_nbNeurons)
-            {
-                emit sendLogInfo("Loaded wIn number of neurons is different from the current Neurons number : W -> " + QString::number(m_wIn.rows) +" N -> " + QString::number(m_nbNeurons) + "\n", QColor(Qt::red));
-                emit sendComputingState(0, 100, QString("Error with loaded matrices."));
-                return false;
-            }
+            return false;
         }
 
     emit sendLogInfo(QString::fromStdString(displayTime("START : sub train ", m_oTime, false, m_verbose)), QColor(Qt::black));
 
-    // init x tot
-        int l_sizeTot[3] = {meaningInputTrain.size[0], 1 + meaningInputTrain.size[2] + m_nbNeurons,  meaningInputTrain.size[1]};
-        xTot = cv::Mat (3,l_sizeTot, CV_32FC1, cv::Scalar(0.f)); //  will contain the internal states of the reservoir for all sentences and all timesteps
-
-    // init x
-        cv::Mat l_X2Copy = cv::Mat::zeros(1 + meaningInputTrain.size[2] + m_nbNeurons, meaningInputTrain.size[1], CV_32FC1);
+    // X will contain the internal states of the reservoir for all sentences and all timesteps, the padding is kept : the length of a test
+    // sentence is unknown, W OUT must learn null outputs after the end of the sentences
+        std::vector<int> l_lengths(teacher.size[0], teacher.size[1]);
+        buildStates(meaningInputTrain, xTot, NULL, &m_progress);
+        m_progress.set(l_nbTimesteps, l_nbTimesteps * 2, QString("Build X"));
 
-    // init x prev
-        int l_size[1] = {m_w.rows};
-        cv::Mat l_xPrev2Copy(1,l_size, CV_32FC1, cv::Scalar(0.f));
-
-    float l_invLeakRate = 1.f - m_leakRate;
-
-//m_stopLoop = true;
-
-    #pragma omp parallel for num_threads(m_numThread)
-        for(int ii = 0; ii < meaningInputTrain.size[0]; ++ii)
-        {
-            m_stopLocker.lockForRead();
-                bool l_espaceLoop = m_stopLoop;
-            m_stopLocker.unlock();
-
-            if(l_espaceLoop)
-            {
-                continue;
-            }
+    if(!checkStop())
+    {
+        emit sendLogInfo("Stop X construction loop.\n", QColor(Qt::red));
+        m_progress.set(0, 100, QString("Aborted."));
+        m_cancel.reset();
+        return false;
+    }
 
-            cv::Mat l_X = l_X2Copy.clone();
-            cv::Mat l_xPrev, l_x;
-            cv::Mat l_subMean(meaningInputTrain.size[1], meaningInputTrain.size[2], CV_32FC1, meaningInputTrain.data + meaningInputTrain.step[0] *ii);
+    emit sendLogInfo(QString::fromStdString(displayTime("END : sub train ", m_oTime, false, m_verbose)), QColor(Qt::black));
 
-            for(int jj = 0; jj < meaningInputTrain.size[1]; ++jj)
-            {
-                // X will contain all the internal states of the reservoir for all timesteps
-                if(jj == 0)
-                {
-                    l_xPrev = l_xPrev2Copy;
-                }
-                else
-                {
-                    l_xPrev = l_x;
-                }
+    m_progress.set(50, 100, QString("Tychonov-start"));
+    // timesteps of all the sentences in the columns of one matrix
+        PackedSequences l_states, l_teacher;
+        packStates(xTot, l_lengths, l_states);
+        packTeacher(teacher, l_lengths, l_teacher);
 
-                cv::Mat l_u = l_subMean.row(jj);
-                cv::Mat l_temp(l_subMean.cols+1, 1, CV_32FC1);
-                l_temp.at<float>(0) = 1.f;
+    if(!tikhonovRegularization(l_states.m_data, l_teacher.m_data))
+    {
+        emit sendLogInfo("Stop tikhonovRegularization.\n", QColor(Qt::red));
+        m_progress.set(0, 100, QString("Aborted."));
+        m_cancel.reset();
+        return false;
+    }
+    m_progress.set(95, 100, QString("Tychonov-end"));
 
-                for(int kk = 0; kk < l_subMean.cols; ++kk)
-                {
-                    l_temp.at<float>(kk+1) = l_u.at<float>(kk);
-                }
+    sentencesOutputTrain = cv::Mat(3, teacher.size, CV_32FC1, cv::Scalar(0.f));
 
-                cv::Mat l_xTemp = (m_wIn * l_temp)+ (m_w * l_xPrev);
+    // y = W OUT * [1;u;x] for all the timesteps with one product, (W OUT * X)^T is directly the packed outputs
+        LinearAlgebraBackend *l_productBackend = LinearAlgebraBackend::instance(m_useCudaMultiplication ? LinearAlgebraBackend::CUDA : m_cpuBackend);
 
-                cv::MatIterator_<float> it = l_xTemp.begin<float>(), it_end = l_xTemp.end<float>();
-                for(;it != it_end; ++it)
-                {
-                    (*it) = tanh(*it);
-                }
+        PackedSequences l_outputs;
+        l_outputs.m_offsets = l_states.m_offsets;
+        bool l_readoutDone = l_productBackend->gemm(l_states.m_data, m_wOut, l_outputs.m_data, cv::GEMM_1_T | cv::GEMM_2_T, &m_cancel);
+        if(l_readoutDone)
+        {
+            unpackRows(l_outputs, sentencesOutputTrain);
+        }
 
-                l_x = (l_xPrev * l_invLeakRate) + (l_xTemp * m_leakRate);
+    if(!l_readoutDone || m_cancel.isCancelled())
+    {
+        emit sendLogInfo("Stop sentencesOutputTrain construction loop.\n", QColor(Qt::red));
+        m_progress.set(0, 100, QString("Aborted."));
+        m_cancel.reset();
+        return false;
+    }
 
+    emit sendLogInfo(QString::fromStdString(displayTime("END : train ", m_oTime, false, m_verbose)), QColor(Qt::black));
+    m_progress.set(100, 100, QString("End training"));
 
-                cv::Mat display(l_X.rows, l_X.cols, CV_8UC3);
-                for(int oo = 0; oo < display.rows * display.cols; ++oo)
-                {
-                    float l_val = l_X.at<float>(oo);
-                    if(l_val < 0)
-                    {
-                        int l_val2 = static_cast<int>(255*l_val);
-                        if(l_val2 > 255)
-                        {
-                            l_val = 255;
-                        }
-
-                        display.at<cv::Vec3b>(oo) = cv::Vec3b(l_val2,0,122);
-                    }
-                    else
-                    {
-                        int l_val2 =  -static_cast<int>(255*l_val);
-                        if(l_val2 > 255)
-                        {
-                            l_val = 255;
-                        }
-                        display.at<cv::Vec3b>(oo) = cv::Vec3b(0,l_val2,122);
-                    }
-                }
+    return true;
+}
 
-                cv::Mat l_temp2(l_temp.rows + l_x.rows, 1, CV_32FC1);
 
-                for(int kk = 0; kk < l_temp.rows + l_x.rows; ++kk)
-                {
-                    if(kk < l_temp.rows)
-                    {
-                        l_temp2.at<float>(kk) = l_temp.at<float>(kk);
-                    }
-                    else
-                    {
-                        l_temp2.at<float>(kk) = l_x.at<float>(kk - l_temp.rows);
-                    }
-                }
+bool Reservoir::trainStreaming(SentenceSource &source, cint chunkSize, cint epochs, cfloat learningRate)
+{
+    int l_nbSentences = source.nbSentences();
+    int l_nbChunks = chunkSize > 0 ? (l_nbSentences + chunkSize - 1) / chunkSize : 0;
 
-                l_temp2.copyTo( l_X.col(jj));
-            }
+    // update progress bar, sampled by the reporter thread
+        m_progress.set(0, std::max(1, l_nbChunks * epochs), QString("Stream"));
+        ProgressReporter l_reporter(&m_progress, this);
+        l_reporter.start();
 
-            for(int jj = 0; jj < l_X.rows; ++jj)
-            {
-                for(int kk = 0; kk < l_X.cols; ++kk)
-                {
-                    xTot.at<float>(ii,jj,kk) = l_X.at<float>(jj,kk);
-                }
-            }
+    // the loops of the call share the thread budget of the reservoir
+        TaskScheduler::instance()->setThreadBudget(m_numThread);
 
-            emit sendComputingState(++l_steps, meaningInputTrain.size[0]*2, QString("Build X"));
-        }
-    // end pragma
+    // init time
+        m_oTime = clock();
 
-    if(m_stopLoop)
+    if(l_nbChunks == 0 || epochs <= 0)
     {
-        emit sendLogInfo("Stop X construction loop.\n", QColor(Qt::red));
-        emit sendComputingState(0, 100, QString("Aborted."));
-        m_stopLoop = false;
+        std::cerr << "-ERROR : trainStreaming -> no sentence to stream. " << std::endl;
+        m_progress.set(0, 100, QString("Aborted."));
         return false;
     }
 
+    emit sendLogInfo(QString::fromStdString(displayTime("START : streaming train ", m_oTime, false, m_verbose)), QColor(Qt::black));
 
-    // clean inused matrices
-        l_X2Copy.release();
-        l_xPrev2Copy.release();
+    // the first chunk gives the input and output sizes
+        cv::Mat l_meaningInput, l_teacher;
+        if(!source.chunk(0, chunkSize, l_meaningInput, l_teacher))
+        {
+            m_progress.set(0, 100, QString("Aborted."));
+            return false;
+        }
 
-    emit sendLogInfo(QString::fromStdString(displayTime("END : sub train ", m_oTime, false, m_verbose)), QColor(Qt::black));
+    // generate matrices
+        generateMatrixW();
+        generateWIn(l_meaningInput.size[2]);
 
-    emit sendComputingState(50, 100, QString("Tychonov-start"));
-    if(!tikhonovRegularization(xTot, teacher, meaningInputTrain.size[2]))
-    {
-        emit sendLogInfo("Stop tikhonovRegularization.\n", QColor(Qt::red));
-        emit sendComputingState(0, 100, QString("Aborted."));
-        m_stopLoop = false;
-        return false;
-    }
-    emit sendComputingState(95, 100, QString("Tychonov-end"));
+        if(!checkLoadedMatrices())
+        {
+            return false;
+        }
 
-    sentencesOutputTrain = teacher.clone();
-    sentencesOutputTrain.setTo(0.f);
+    // W OUT and the Adam moments, the memory only depends on the chunk size and on W OUT
+        int l_dimState = 1 + l_meaningInput.size[2] + m_w.rows;
+        m_wOut = cv::Mat(l_teacher.size[2], l_dimState, CV_32FC1, cv::Scalar(0.f));
+        cv::Mat l_moment1 = m_wOut.clone(), l_moment2 = m_wOut.clone();
+        const float l_beta1 = 0.9f, l_beta2 = 0.999f, l_epsilon = 1e-8f;
+        int l_step = 0;
 
+    LinearAlgebraBackend *l_productBackend = LinearAlgebraBackend::instance(m_useCudaMultiplication ? LinearAlgebraBackend::CUDA : m_cpuBackend);
 
-    #pragma omp parallel for
-        for(int ii = 0; ii < xTot.size[0]; ++ii)
-        {
-            m_stopLocker.lockForRead();
-                bool l_espaceLoop = m_stopLoop;
-            m_stopLocker.unlock();
+    for(int ii = 0; ii < epochs; ++ii)
+    {
+        double l_squaredError = 0.0;
+        qint64 l_nbSteps = 0;
 
-            if(l_espaceLoop)
+        for(int jj = 0; jj < l_nbChunks; ++jj)
+        {
+            int l_first = jj * chunkSize;
+            if((ii > 0 || jj > 0) && !source.chunk(l_first, chunkSize, l_meaningInput, l_teacher))
             {
-                continue;
+                m_progress.set(0, 100, QString("Aborted."));
+                return false;
             }
 
+            // states of all the timesteps of the chunk, the padding included as in train
+                cv::Mat l_xTot;
+                std::vector<int> l_lengths(l_teacher.size[0], l_teacher.size[1]);
+                buildStates(l_meaningInput, l_xTot);
 
-            cv::Mat l_X = cv::Mat::zeros(xTot.size[1], xTot.size[2], CV_32FC1);
+                PackedSequences l_states, l_packedTeacher;
+                packStates(l_xTot, l_lengths, l_states);
+                packTeacher(l_teacher, l_lengths, l_packedTeacher);
+                l_xTot.release();
 
-            for(int jj = 0; jj < l_X.rows; ++jj)
-            {
-                for(int kk = 0; kk < l_X.cols; ++kk)
+            // E = W OUT * X - Y^T
+                cv::Mat l_error;
+                if(!checkStop() || !l_productBackend->gemm(m_wOut, l_states.m_data, l_error, 0, &m_cancel))
                 {
-                    l_X.at<float>(jj,kk) = xTot.at<float>(ii,jj,kk);
+                    emit sendLogInfo("Stop streaming train.\n", QColor(Qt::red));
+                    m_progress.set(0, 100, QString("Aborted."));
+                    m_cancel.reset();
+                    return false;
                 }
-            }
+                l_error -= l_packedTeacher.m_data.t();
 
-            cv::Mat res;
+                int l_nbChunkSteps = l_states.m_data.cols;
+                if(l_nbChunkSteps == 0)
+                {
+                    m_progress.advance();
+                    continue;
+                }
 
-            res = (m_wOut * l_X).t();
+                double l_errorNorm = cv::norm(l_error, cv::NORM_L2);
+                l_squaredError += l_errorNorm * l_errorNorm;
+                l_nbSteps += l_nbChunkSteps;
 
-            for(int jj = 0; jj < sentencesOutputTrain.size[1]; ++jj)
-            {
-                for(int kk = 0; kk < sentencesOutputTrain.size[2]; ++kk)
+            // gradient of the mean squared error, the ridge term is shared between the chunks of an epoch
+                cv::Mat l_gradient;
+                if(!l_productBackend->gemm(l_error, l_states.m_data, l_gradient, cv::GEMM_2_T, &m_cancel))
                 {
-                    sentencesOutputTrain.at<float>(ii,jj,kk) = res.at<float>(jj,kk);
+                    emit sendLogInfo("Stop streaming train.\n", QColor(Qt::red));
+                    m_progress.set(0, 100, QString("Aborted."));
+                    m_cancel.reset();
+                    return false;
                 }
-            }                                    
+                cv::addWeighted(l_gradient, 1.0 / l_nbChunkSteps, m_wOut, m_ridge * l_meaningInput.size[0] / (static_cast<double>(l_nbSentences) * l_nbChunkSteps), 0.0, l_gradient);
+
+            // Adam update
+                ++l_step;
+                cv::addWeighted(l_moment1, l_beta1, l_gradient, 1.f - l_beta1, 0.0, l_moment1);
+                cv::addWeighted(l_moment2, l_beta2, l_gradient.mul(l_gradient), 1.f - l_beta2, 0.0, l_moment2);
+
+                double l_rate = learningRate * std::sqrt(1.0 - std::pow(l_beta2, l_step)) / (1.0 - std::pow(l_beta1, l_step));
+                cv::Mat l_denominator;
+                cv::sqrt(l_moment2, l_denominator);
+                l_denominator += l_epsilon;
+
+                cv::Mat l_update;
+                cv::divide(l_moment1, l_denominator, l_update, l_rate);
+                m_wOut -= l_update;
+
+            m_progress.advance();
         }
-        // end pragma
 
-    if(m_stopLoop)
-    {
-        emit sendLogInfo("Stop sentencesOutputTrain construction loop.\n", QColor(Qt::red));
-        emit sendComputingState(0, 100, QString("Aborted."));
-        m_stopLoop = false;
-        return false;
+        emit sendLogInfo("Epoch " + QString::number(ii + 1) + " / " + QString::number(epochs) + " : mean squared error " +
+                         QString::number(l_nbSteps > 0 ? l_squaredError / l_nbSteps : 0.0) + "\n", QColor(Qt::black));
     }
 
-    emit sendLogInfo(QString::fromStdString(displayTime("END : train ", m_oTime, false, m_verbose)), QColor(Qt::black));
-    emit sendComputingState(100, 100, QString("End training"));    
+    emit sendLogInfo(QString::fromStdString(displayTime("END : streaming train ", m_oTime, false, m_verbose)), QColor(Qt::black));
+    m_progress.set(100, 100, QString("End streaming train"));
 
     return true;
 }
 
-
 void Reservoir::test(const cv::Mat &meaningInputTest, cv::Mat &sentencesOutputTest, cv::Mat &xTot)
 {
-    // update progress bar
-        int l_steps = 0;
-        emit sendComputingState(0, meaningInputTest.size[0], QString("Build X"));
+    // update progress bar, sampled by the reporter thread, one step per timestep
+        m_progress.set(0, meaningInputTest.size[0] * meaningInputTest.size[1], QString("Build X"));
+        ProgressReporter l_reporter(&m_progress, this);
+        l_reporter.start();
+
+    // the loops of the call share the thread budget of the reservoir
+        TaskScheduler::instance()->setThreadBudget(m_numThread);
 
     // init time
         m_oTime = clock();
 
-    // mutex for openmp threads
-        QMutex l_lockerMainThread;
-
     emit sendLogInfo(QString::fromStdString(displayTime("START : test", m_oTime, false, m_verbose)), QColor(Qt::black));
 
-    // init x tot
-        int l_sizeTot[3] = {meaningInputTest.size[0], 1 + meaningInputTest.size[2] + m_nbNeurons,  meaningInputTest.size[1]};
-        xTot = cv::Mat (3,l_sizeTot, CV_32FC1); //  will contain the internal states of the reservoir for all sentences and all timesteps
+    // X will contain the internal states of the reservoir for all sentences and all timesteps, W OUT has been trained on the padding too
+        std::vector<int> l_lengths(meaningInputTest.size[0], meaningInputTest.size[1]);
+        buildStates(meaningInputTest, xTot, NULL, &m_progress);
 
     // init sentences output
-        int l_sizeOut[3] = {l_sizeTot[0], l_sizeTot[2], m_wOut.rows};
-        sentencesOutputTest = cv::Mat(3, l_sizeOut, CV_32FC1);
+        int l_sizeOut[3] = {xTot.size[0], xTot.size[2], m_wOut.rows};
+        sentencesOutputTest = cv::Mat(3, l_sizeOut, CV_32FC1, cv::Scalar(0.f));
+
+    // y = W OUT * [1;u;x] for all the timesteps of the sentences with one product on the packed states,
+    // the packed outputs have the memory layout of the 3D output : the OpenCV and LAPACK backends write the product in place,
+    // the result of the other backends is copied by unpackRows
+        LinearAlgebraBackend *l_productBackend = LinearAlgebraBackend::instance(m_useCudaMultiplication ? LinearAlgebraBackend::CUDA : m_cpuBackend);
+
+        PackedSequences l_states, l_outputs;
+        packStates(xTot, l_lengths, l_states);
+        l_outputs.m_offsets = l_states.m_offsets;
+        l_outputs.m_data = cv::Mat(l_states.m_data.cols, m_wOut.rows, CV_32FC1, sentencesOutputTest.data);
+
+        bool l_readoutDone = l_productBackend->gemm(l_states.m_data, m_wOut, l_outputs.m_data, cv::GEMM_1_T | cv::GEMM_2_T, &m_cancel);
+        l_states.m_data.release();
+        if(l_readoutDone)
+        {
+            unpackRows(l_outputs, sentencesOutputTest);
+        }
 
-    float l_invLeakRate = 1.f - m_leakRate;
+    if(!l_readoutDone || m_cancel.isCancelled())
+    {
+        emit sendLogInfo("Stop test loop.\n", QColor(Qt::red));
+        m_progress.set(0, 100, QString("Aborted."));
+        m_cancel.reset();
+        return;
+    }
 
-    #pragma omp parallel for
-        for(int ii = 0; ii < meaningInputTest.size[0]; ++ii)
-        {
-            cv::Mat l_X = cv::Mat::zeros(1 + meaningInputTest.size[2] + m_nbNeurons, meaningInputTest.size[1],CV_32FC1);
-            cv::Mat l_xPrev, l_x;
-            cv::Mat l_subMean(meaningInputTest.size[1], meaningInputTest.size[2], CV_32FC1, meaningInputTest.data + meaningInputTest.step[0] *ii);
+    emit sendLogInfo(QString::fromStdString(displayTime("END : test", m_oTime, false, m_verbose)), QColor(Qt::black));
+    m_progress.set(100, 100, QString("End test"));
+}
 
-            for(int jj = 0; jj < meaningInputTest.size[1]; ++jj)
-            {
-                // X will contain all the internal states of the reservoir for all timesteps
-                if(jj == 0)
-                {
-                    int l_size[1] = {m_w.rows};
-                    l_xPrev = cv::Mat(1,l_size, CV_32FC1, cv::Scalar(0.f));
-                }
-                else
-                {
-                    l_xPrev = l_x;
-                }
+void Reservoir::buildStates(const cv::Mat &meaningInput, cv::Mat &xTot, const std::vector<int> *lengths, ProgressCounter *progress)
+{
+    m_trajectoryCache.bind(m_w, m_wIn, m_leakRate);
+    m_trajectoryCache.computeStates(meaningInput, xTot, lengths, &m_cancel, progress);
 
-                cv::Mat l_u = l_subMean.row(jj);
-                cv::Mat l_temp(l_subMean.cols+1, 1, CV_32FC1);
-                l_temp.at<float>(0) = 1.f;
-                for(int kk = 0; kk < l_subMean.cols; ++kk)
-                {
-                    l_temp.at<float>(kk+1) = l_u.at<float>(kk);
-                }
+    emit sendLogInfo("Reservoir states : " + QString::number(m_trajectoryCache.reusedSteps()) + " timesteps reused, " +
+                     QString::number(m_trajectoryCache.computedSteps()) + " computed.\n", QColor(Qt::black));
+}
 
-                cv::Mat l_xTemp = (m_wIn * l_temp) + (m_w * l_xPrev);
+bool Reservoir::checkStop()
+{
+    return !m_cancel.isCancelled();
+}
 
-                cv::MatIterator_<float> it = l_xTemp.begin<float>(), it_end = l_xTemp.end<float>();
-                for(;it != it_end; ++it)
-                {
-                    (*it) = tanh(*it);
-                }
 
-                l_x = (l_xPrev * l_invLeakRate) + (l_xTemp * m_leakRate);
+bool Reservoir::tikhonovRegularization(const cv::Mat &states, const cv::Mat &yTeacher)
+{
+    // the CUDA flags select the backend of the steps, the CPU backend is used otherwise
+        LinearAlgebraBackend *l_inversionBackend = LinearAlgebraBackend::instance(m_useCudaInversion ? LinearAlgebraBackend::CUDA : m_cpuBackend);
+        LinearAlgebraBackend *l_productBackend   = LinearAlgebraBackend::instance(m_useCudaMultiplication ? LinearAlgebraBackend::CUDA : m_cpuBackend);
 
-                cv::Mat l_temp2(l_temp.rows + l_x.rows, 1, CV_32FC1);
-                for(int kk = 0; kk < l_temp.rows + l_x.rows; ++kk)
-                {
-                    if(kk < l_temp.rows)
-                    {
-                        l_temp2.at<float>(kk) = l_temp.at<float>(kk);
-                    }
-                    else
-                    {
-                        l_temp2.at<float>(kk) = l_x.at<float>(kk - l_temp.rows);
-                    }
-                }
+    emit sendLogInfo(QString::fromStdString(displayTime("START : tikhonovRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
+    emit sendLogInfo("Backends : " + l_inversionBackend->name() + " (inversion), " + l_productBackend->name() + " (products)\n", QColor(Qt::black));
 
-                l_temp2.copyTo( l_X.col(jj));
+    // the approximate readout is only used if the rank reduces the problem
+        m_sketchError = -1.f;
+        if(m_iterativeSolver)
+        {
+            return conjugateGradientRegularization(states, yTeacher);
+        }
 
-                cv::Mat l_temp3(l_x.rows + l_subMean.cols+1, 1, CV_32FC1);
-                l_temp3.at<float>(0) = 1.f;
-                for(int kk = 0; kk < l_subMean.cols; ++kk)
-                {
-                    l_temp3.at<float>(kk+1) = l_u.at<float>(kk);
-                }
-                for(int kk = 0; kk < l_x.rows; ++kk)
-                {
-                    l_temp3.at<float>(kk+l_subMean.cols+1) = l_x.at<float>(kk);
-                }
+        if(m_sketchRank > 0 && m_sketchRank < std::min(states.rows, states.cols))
+        {
+            return sketchedTikhonovRegularization(states, yTeacher);
+        }
 
-                cv::Mat l_y = m_wOut * l_temp3;
-                for(int kk = 0; kk < sentencesOutputTest.size[2]; ++kk)
-                {
-                    sentencesOutputTest.at<float>(ii,jj,kk) = l_y.at<float>(kk);
-                }
+    // less timesteps than features : the system is solved in the sample space
+        if(states.cols < states.rows)
+        {
+            if(dualTikhonovRegularization(states, yTeacher))
+            {
+                return true;
             }
-            for(int jj = 0; jj < l_X.rows; ++jj)
+
+            if(!checkStop())
             {
-                for(int kk = 0; kk < l_X.cols; ++kk)
-                {
-                    xTot.at<float>(ii,jj,kk) = l_X.at<float>(jj,kk);
-                }
+                return false;
             }
 
-            l_lockerMainThread.lock();
-                emit sendComputingState(++l_steps, meaningInputTest.size[0], QString("Build X"));
-            l_lockerMainThread.unlock();
+            emit sendLogInfo("Dual form failed, primal form used.\n", QColor(Qt::red));
+        }
 
+    // the states and the teacher are already packed : one column / row per timestep
+        emit sendLogInfo(QString::fromStdString(displayTime("1 : tikhonovRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
+        m_progress.set(60, 100, QString("Tikhonov-1"));
+
+    // X * X^T + ridge * I, mirrored since the SVD reads the whole matrix
+        cv::Mat l_mat2inv;
+        if(!l_inversionBackend->syrk(states, l_mat2inv, &m_cancel, true) || !checkStop())
+        {
+            return false;
         }
-    // end omp parallel
 
-    emit sendLogInfo(QString::fromStdString(displayTime("END : test", m_oTime, false, m_verbose)), QColor(Qt::black));
-    emit sendComputingState(100, 100, QString("End test"));
-}
+        m_progress.set(70, 100, QString("Tikhonov-2"));
 
-bool Reservoir::checkStop()
-{
-    m_stopLocker.lockForRead();
-        bool l_stopLoop = m_stopLoop;
-    m_stopLocker.unlock();
+        l_mat2inv += (cv::Mat::eye(states.rows, states.rows, CV_32FC1) * m_ridge);
 
-    if(l_stopLoop)
-    {
-        return false;
-    }
+    // pseudo-inverse with a SVD : V * S^-1 * U^T
+        cv::Mat l_S, l_U, l_VT;
+        if(!l_inversionBackend->svd(l_mat2inv, l_S, l_U, l_VT))
+        {
+            std::string l_error("-ERROR : tikhonovRegularization -> singular value decomposition failed with the backend " + l_inversionBackend->name().toStdString());
+            std::cerr << l_error << std::endl;
+            emit sendLogInfo(QString::fromStdString(l_error), QColor(Qt::red));
+            return false;
+        }
+        l_mat2inv.release();
 
-    return true;
-}
+        if(!checkStop())
+        {
+            return false;
+        }
 
+        emit sendLogInfo(QString::fromStdString(displayTime("2 : tikhonovRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
+        m_progress.set(80, 100, QString("Tikhonov-3"));
 
-bool Reservoir::tikhonovRegularization(const cv::Mat &xTot, const cv::Mat &yTeacher, cuint dimInput)
-{
-    int l_subdivisionBlocks = 2;
-    if(m_nbNeurons > 3000)
-    {
-        l_subdivisionBlocks = 4;
-    }
-    if(m_nbNeurons > 6000)
-    {
-        l_subdivisionBlocks = 6;
-    }
-    if(m_nbNeurons > 8000)
-    {
-        l_subdivisionBlocks = 8;
-    }
+        cv::Mat l_sInvUt;
+        cv::transpose(l_U, l_sInvUt);
+        l_U.release();
 
-    emit sendLogInfo(QString::fromStdString(displayTime("START : tikhonovRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
+        for(int ii = 0; ii < l_S.rows; ++ii)
+        {
+            float l_singularValue = l_S.at<float>(ii);
+            cv::Mat l_row = l_sInvUt.row(ii);
+            l_row *= (l_singularValue > 1e-6f) ? 1.f / l_singularValue : 0.f;
+        }
+
+        cv::Mat l_inv;
+        if(!l_productBackend->gemm(l_VT, l_sInvUt, l_inv, cv::GEMM_1_T, &m_cancel))
+        {
+            return false;
+        }
+        l_VT.release();
+        l_sInvUt.release();
 
-    cv::Mat l_xTotReshaped(xTot.size[1], xTot.size[0] * xTot.size[2], CV_32FC1);
+        emit sendLogInfo(QString::fromStdString(displayTime("3 : tikhonovRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
+        m_progress.set(90, 100, QString("Tikhonov-4"));
 
-    #pragma omp parallel for
-        for(int ii = 0; ii < xTot.size[0]; ++ii)
+    // W OUT = (Y^T * X^T) * (X * X^T + ridge * I)^-1
+        cv::Mat l_yx, l_wOut;
+        if(!l_productBackend->gemm(yTeacher, states, l_yx, cv::GEMM_1_T | cv::GEMM_2_T, &m_cancel) ||
+           !l_productBackend->gemm(l_yx, l_inv, l_wOut, 0, &m_cancel))
         {
-            for(int jj = 0; jj < xTot.size[1]; ++jj)
-            {
-                for(int kk = 0; kk < xTot.size[2]; ++kk)
-                {
-                    l_xTotReshaped.at<float>(jj, ii*xTot.size[2] + kk) = xTot.at<float>(ii,jj,kk);
-                }
-            }
+            return false;
         }
-    // end pragma
+        m_wOut = l_wOut;
 
-    if(!checkStop())
-    {
-        return false;
-    }
+    emit sendLogInfo(QString::fromStdString(displayTime("END : tikhonovRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
+    return true;
+}
 
+bool Reservoir::dualTikhonovRegularization(const cv::Mat &states, const cv::Mat &yTeacher)
+{
+    LinearAlgebraBackend *l_inversionBackend = LinearAlgebraBackend::instance(m_useCudaInversion ? LinearAlgebraBackend::CUDA : m_cpuBackend);
+    LinearAlgebraBackend *l_productBackend   = LinearAlgebraBackend::instance(m_useCudaMultiplication ? LinearAlgebraBackend::CUDA : m_cpuBackend);
 
-    emit sendLogInfo(QString::fromStdString(displayTime("1 : tikhonovRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
-    emit sendComputingState(60, 100, QString("Tikhonov-1"));
+    emit sendLogInfo("Dual form : " + QString::number(states.cols) + " timesteps for " + QString::number(states.rows) + " features\n", QColor(Qt::black));
+    m_progress.set(60, 100, QString("Tikhonov-1"));
 
-    cv::Mat l_mat2inv;
+    // X^T * X + ridge * I : [timesteps x timesteps]
+        cv::Mat l_kernel;
+        if(!l_productBackend->gemm(states, states, l_kernel, cv::GEMM_1_T, &m_cancel) || !checkStop())
+        {
+            return false;
+        }
 
-    if(m_useCudaInversion)
-    {
-        swCuda::blockMatrixMultiplicationF(l_xTotReshaped,l_xTotReshaped.t(), l_mat2inv, l_subdivisionBlocks);
-    }
-    else
-    {
-        l_mat2inv = (l_xTotReshaped * l_xTotReshaped.t());
-    }
+        l_kernel += (cv::Mat::eye(states.cols, states.cols, CV_32FC1) * m_ridge);
 
-    if(!checkStop())
-    {
-        return false;
-    }
+        emit sendLogInfo(QString::fromStdString(displayTime("1 : dualTikhonovRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
+        m_progress.set(75, 100, QString("Tikhonov-2"));
 
-    emit sendComputingState(70, 100, QString("Tikhonov-2"));
+    // alpha = (X^T * X + ridge * I)^-1 * Y
+        cv::Mat l_alpha;
+        if(!l_inversionBackend->cholesky(l_kernel, yTeacher, l_alpha))
+        {
+            std::cerr << "-ERROR : dualTikhonovRegularization -> Cholesky factorization failed with the backend " << l_inversionBackend->name().toStdString() << std::endl;
+            return false;
+        }
+        l_kernel.release();
 
-    l_mat2inv += (cv::Mat::eye(1 + dimInput + m_nbNeurons,1 + dimInput + m_nbNeurons,CV_32FC1) * m_ridge);
+        if(!checkStop())
+        {
+            return false;
+        }
 
-    cv::Mat invCuda, invCV;
-    cv::Mat matCudaS,matCudaU,matCudaVT;
+        emit sendLogInfo(QString::fromStdString(displayTime("2 : dualTikhonovRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
+        m_progress.set(90, 100, QString("Tikhonov-3"));
 
-    if(m_useCudaInversion)
-    {
-        if(!swCuda::squareMatrixSingularValueDecomposition(l_mat2inv,matCudaS,matCudaU,matCudaVT))
+    // W OUT = alpha^T * X^T
+        cv::Mat l_wOut;
+        if(!l_productBackend->gemm(l_alpha, states, l_wOut, cv::GEMM_1_T | cv::GEMM_2_T, &m_cancel))
         {
-            std::string l_error("-ERROR : squareMatrixSingularValueDecomposition");
-            std::cerr << l_error << std::endl;
-            emit sendLogInfo(QString::fromStdString(l_error), QColor(Qt::red));
             return false;
         }
-        l_mat2inv.release();
+        m_wOut = l_wOut;
 
-        emit sendLogInfo(QString::fromStdString(displayTime("2 : tikhonovRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
-        emit sendComputingState(80, 100, QString("Tikhonov-3"));
+    emit sendLogInfo(QString::fromStdString(displayTime("END : dualTikhonovRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
+    return true;
+}
 
-        for(int ii = 0; ii < matCudaS.rows;++ii)
+bool Reservoir::sketchedTikhonovRegularization(const cv::Mat &states, const cv::Mat &yTeacher)
+{
+    LinearAlgebraBackend *l_inversionBackend = LinearAlgebraBackend::instance(m_useCudaInversion ? LinearAlgebraBackend::CUDA : m_cpuBackend);
+    LinearAlgebraBackend *l_productBackend   = LinearAlgebraBackend::instance(m_useCudaMultiplication ? LinearAlgebraBackend::CUDA : m_cpuBackend);
+
+    // oversampled random test matrix, fixed seed to get the same readout between two trainings
+        int l_sampleSize = std::min(m_sketchRank + 10, std::min(states.rows, states.cols));
+        cv::Mat l_omega(states.cols, l_sampleSize, CV_32FC1);
+        cv::RNG l_rng(0x5eed);
+        l_rng.fill(l_omega, cv::RNG::NORMAL, 0.f, 1.f);
+
+        m_progress.set(60, 100, QString("Tikhonov-1"));
+
+    // range of the states with a power iteration Y = X * (X^T * (X * omega)) which sharpens the spectrum decay,
+    // the samples are orthonormalized after each product, else the small singular values are lost in the float precision
+        cv::Mat l_range, l_tmp;
+        if(!l_productBackend->gemm(states, l_omega, l_range, 0, &m_cancel) || orthonormalizeColumns(l_range) == 0 ||
+           !l_productBackend->gemm(states, l_range, l_tmp, cv::GEMM_1_T, &m_cancel) || orthonormalizeColumns(l_tmp) == 0 ||
+           !l_productBackend->gemm(states, l_tmp, l_range, 0, &m_cancel) || orthonormalizeColumns(l_range) == 0 || !checkStop())
         {
-            if(matCudaS.at<float>(ii,ii) > 1e-6f)
-            {
-                matCudaS.at<float>(ii,ii) = 1.f/matCudaS.at<float>(ii,ii);
-            }
-            else
+            if(!m_cancel.isCancelled())
             {
-                matCudaS.at<float>(ii,ii) = 0.f;
+                std::cerr << "-ERROR : sketchedTikhonovRegularization -> null states. " << std::endl;
             }
+            return false;
         }
+        l_omega.release();
+        l_tmp.release();
 
-        if(m_useCudaMultiplication)
+    // projected states P = Q^T * X, the eigendecomposition of P * P^T in double gives the singular values of X in the range
+        cv::Mat l_projected, l_projectedGram, l_values, l_vectors;
+        if(!l_productBackend->gemm(l_range, states, l_projected, cv::GEMM_1_T, &m_cancel) || !checkStop())
         {
-            cv::Mat l_tempCudaMult;
-            swCuda::blockMatrixMultiplicationF(matCudaS, matCudaU.t(), l_tempCudaMult, l_subdivisionBlocks);
-            matCudaS.release();
-            matCudaU.release();
-            swCuda::blockMatrixMultiplicationF(matCudaVT.t(), l_tempCudaMult, invCuda, l_subdivisionBlocks);
-            matCudaVT.release();
+            return false;
         }
-        else
+
+        cv::Mat l_projected64;
+        l_projected.convertTo(l_projected64, CV_64FC1);
+        cv::mulTransposed(l_projected64, l_projectedGram, false);
+        l_projected64.release();
+
+        if(!l_inversionBackend->eigen(l_projectedGram, l_values, l_vectors))
         {
-            invCuda = (matCudaVT.t() * matCudaS * matCudaU.t());
+            std::cerr << "-ERROR : sketchedTikhonovRegularization -> eigendecomposition failed with the backend " << l_inversionBackend->name().toStdString() << std::endl;
+            return false;
         }
 
+    // the rank is truncated to the singular values sqrt(lambda) above the float precision of the states
+        double l_cutoff = l_sampleSize * std::numeric_limits<float>::epsilon() * std::sqrt(std::max(0.0, l_values.at<double>(0)));
+        int l_rank = 0;
+        while(l_rank < std::min(m_sketchRank, l_values.rows) && std::sqrt(std::max(0.0, l_values.at<double>(l_rank))) > l_cutoff)
+        {
+            ++l_rank;
+        }
 
-        if(!checkStop())
+        if(l_rank == 0)
         {
+            std::cerr << "-ERROR : sketchedTikhonovRegularization -> null states. " << std::endl;
             return false;
         }
 
-        emit sendLogInfo(QString::fromStdString(displayTime("3 : tikhonovRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
-        emit sendComputingState(90, 100, QString("Tikhonov-4"));
-
-        if(m_useCudaMultiplication)
+    // basis of the rank first singular vectors Q * U and reduced states Z = U^T * P
+        cv::Mat l_singularVectors, l_basis, l_reduced;
+        l_vectors.rowRange(0, l_rank).convertTo(l_singularVectors, CV_32FC1);
+        if(!l_productBackend->gemm(l_range, l_singularVectors, l_basis, cv::GEMM_2_T, &m_cancel) ||
+           !l_productBackend->gemm(l_singularVectors, l_projected, l_reduced, 0, &m_cancel) || !checkStop())
         {
-            cv::Mat l_tempCudaMult;
-            l_xTotReshaped =l_xTotReshaped.t();
+            return false;
+        }
+        l_range.release();
+        l_projected.release();
 
-            swCuda::blockMatrixMultiplicationF(l_xTotReshaped, invCuda, l_tempCudaMult, l_subdivisionBlocks);
-            invCuda.release();
-            l_xTotReshaped.release();
+        emit sendLogInfo(QString::fromStdString(displayTime("1 : sketchedTikhonovRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
+        m_progress.set(70, 100, QString("Tikhonov-2"));
 
-            if(!checkStop())
-            {
-                return false;
-            }
+    // projection error, ||X - Q * Z||^2 = ||X||^2 - ||Z||^2 with Q orthonormal
+        double l_statesNorm  = cv::norm(states, cv::NORM_L2);
+        double l_reducedNorm = cv::norm(l_reduced, cv::NORM_L2);
+        m_sketchError = (l_statesNorm > 0.0) ? static_cast<float>(std::sqrt(std::max(0.0, 1.0 - (l_reducedNorm * l_reducedNorm) / (l_statesNorm * l_statesNorm)))) : 0.f;
 
-            cv::Mat l_yTeacherReshaped(yTeacher.size[0] *yTeacher.size[1],  yTeacher.size[2], CV_32FC1);
+        emit sendLogInfo("Sketch rank " + QString::number(l_rank) + " used for " + QString::number(m_sketchRank) + " requested (" + QString::number(states.rows) +
+                         " features) : relative projection error " + QString::number(m_sketchError) + "\n", l_rank < m_sketchRank ? QColor(Qt::red) : QColor(Qt::black));
 
-            #pragma omp parallel for
-                for(int ii = 0; ii < yTeacher.size[0]; ++ii)
-                {
-                    for(int jj = 0; jj < yTeacher.size[1]; ++jj)
-                    {
-                        for(int kk = 0; kk < yTeacher.size[2]; ++kk)
-                        {
-                            l_yTeacherReshaped.at<float>(ii*yTeacher.size[1] + jj,kk) = yTeacher.at<float>(ii,jj,kk);
-                        }
-                    }
-                }
+    // ridge solve in the reduced space : (Z * Z^T + ridge * I) * B = Z * Y
+        cv::Mat l_reducedGram, l_zy, l_solution;
+        if(!l_inversionBackend->syrk(l_reduced, l_reducedGram, &m_cancel, false) ||
+           !l_productBackend->gemm(l_reduced, yTeacher, l_zy, 0, &m_cancel) || !checkStop())
+        {
+            return false;
+        }
+        l_reduced.release();
 
-            if(!checkStop())
-            {
-                return false;
-            }
+        l_reducedGram += (cv::Mat::eye(l_rank, l_rank, CV_32FC1) * m_ridge);
+
+        m_progress.set(80, 100, QString("Tikhonov-3"));
 
-            // end pragma
-            m_wOut = l_yTeacherReshaped.t() * l_tempCudaMult;
+        if(!l_inversionBackend->cholesky(l_reducedGram, l_zy, l_solution))
+        {
+            std::cerr << "-ERROR : sketchedTikhonovRegularization -> Cholesky factorization failed with the backend " << l_inversionBackend->name().toStdString() << std::endl;
+            return false;
         }
-        else
+
+        emit sendLogInfo(QString::fromStdString(displayTime("2 : sketchedTikhonovRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
+        m_progress.set(90, 100, QString("Tikhonov-4"));
+
+    // W OUT = B^T * Q^T
+        cv::Mat l_wOut;
+        if(!l_productBackend->gemm(l_solution, l_basis, l_wOut, cv::GEMM_1_T | cv::GEMM_2_T, &m_cancel))
         {
-            cv::Mat l_yTeacherReshaped(yTeacher.size[0] *yTeacher.size[1],  yTeacher.size[2], CV_32FC1);
-            #pragma omp parallel for
-                for(int ii = 0; ii < yTeacher.size[0]; ++ii)
-                {
-                    for(int jj = 0; jj < yTeacher.size[1]; ++jj)
-                    {
-                        for(int kk = 0; kk < yTeacher.size[2]; ++kk)
-                        {
-                            l_yTeacherReshaped.at<float>(ii*yTeacher.size[1] + jj,kk) = yTeacher.at<float>(ii,jj,kk);
-                        }
-                    }
-                }
-            // end pragma
+            return false;
+        }
+        m_wOut = l_wOut;
 
-            if(!checkStop())
-            {
-                return false;
-            }
+    emit sendLogInfo(QString::fromStdString(displayTime("END : sketchedTikhonovRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
+    return true;
+}
+
+bool Reservoir::conjugateGradientRegularization(const cv::Mat &states, const cv::Mat &yTeacher)
+{
+    LinearAlgebraBackend *l_productBackend = LinearAlgebraBackend::instance(m_useCudaMultiplication ? LinearAlgebraBackend::CUDA : m_cpuBackend);
+
+    int l_dimOut = yTeacher.cols;
 
-            m_wOut = l_yTeacherReshaped.t() * l_xTotReshaped.t() * invCuda;
+    // right hand side B = Y^T * X^T : [dimOutput x (1 + dimInput + N)]
+        cv::Mat l_b;
+        if(!l_productBackend->gemm(yTeacher, states, l_b, cv::GEMM_1_T | cv::GEMM_2_T, &m_cancel) || !checkStop())
+        {
+            return false;
         }
-    }
-    else
-    {
-        emit sendComputingState(60, 100, QString("Tikhonov-3"));
 
-        cv::invert(l_mat2inv, invCV, cv::DECOMP_SVD);
-        l_mat2inv.release();
+    // initial W OUT, the previous readout if compatible
+        cv::Mat l_w;
+        bool l_warmStarted = m_warmStart && m_wOut.rows == l_dimOut && m_wOut.cols == states.rows && m_wOut.type() == CV_32FC1;
+        if(l_warmStarted)
+        {
+            l_w = m_wOut.clone();
+        }
+        else
+        {
+            l_w = cv::Mat(l_dimOut, states.rows, CV_32FC1, cv::Scalar(0.f));
+        }
 
-        emit sendLogInfo(QString::fromStdString(displayTime("2-3 : tikhonovRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
-        emit sendComputingState(90, 100, QString("Tikhonov-4"));
+    // A(P) = (P * X) * X^T + ridge * P
+        cv::Mat l_r, l_p, l_ap, l_px;
 
-        if(!checkStop())
+        if(!l_productBackend->gemm(l_w, states, l_px, 0, &m_cancel) || !l_productBackend->gemm(l_px, states, l_ap, cv::GEMM_2_T, &m_cancel))
         {
             return false;
         }
+        l_r = l_b - (l_ap + l_w * m_ridge);
+        l_p = l_r.clone();
+
+        std::vector<double> l_rs(l_dimOut), l_bNorm(l_dimOut);
+        std::vector<bool> l_converged(l_dimOut, false);
+        for(int ii = 0; ii < l_dimOut; ++ii)
+        {
+            l_rs[ii]    = l_r.row(ii).dot(l_r.row(ii));
+            l_bNorm[ii] = cv::norm(l_b.row(ii));
+        }
+
+        int l_iteration = 0;
+        int l_nbConverged = 0;
+        for(; l_iteration < m_maxIterations && l_nbConverged < l_dimOut; ++l_iteration)
+        {
+            if(!l_productBackend->gemm(l_p, states, l_px, 0, &m_cancel) || !l_productBackend->gemm(l_px, states, l_ap, cv::GEMM_2_T, &m_cancel))
+            {
+                return false;
+            }
+            cv::scaleAdd(l_p, m_ridge, l_ap, l_ap);
 
-        cv::Mat l_yTeacherReshaped(yTeacher.size[0] *yTeacher.size[1],  yTeacher.size[2], CV_32FC1);
-        #pragma omp parallel for
-            for(int ii = 0; ii < yTeacher.size[0]; ++ii)
+            l_nbConverged = 0;
+            for(int ii = 0; ii < l_dimOut; ++ii)
             {
-                for(int jj = 0; jj < yTeacher.size[1]; ++jj)
+                if(l_converged[ii] || std::sqrt(l_rs[ii]) <= m_tolerance * l_bNorm[ii])
                 {
-                    for(int kk = 0; kk < yTeacher.size[2]; ++kk)
-                    {
-                        l_yTeacherReshaped.at<float>(ii*yTeacher.size[1] + jj,kk) = yTeacher.at<float>(ii,jj,kk);
-                    }
+                    l_converged[ii] = true;
+                    ++l_nbConverged;
+                    continue;
                 }
-            }
-        // end pragma
 
-        if(!checkStop())
-        {
-            return false;
-        }
+                cv::Mat l_pRow = l_p.row(ii), l_apRow = l_ap.row(ii), l_wRow = l_w.row(ii), l_rRow = l_r.row(ii);
 
-        m_wOut = (l_yTeacherReshaped.t() * l_xTotReshaped.t()) * invCV;
+                double l_alpha = l_rs[ii] / l_pRow.dot(l_apRow);
+                cv::scaleAdd(l_pRow,   l_alpha, l_wRow, l_wRow);
+                cv::scaleAdd(l_apRow, -l_alpha, l_rRow, l_rRow);
 
-    }
+                double l_rsNew = l_rRow.dot(l_rRow);
+                cv::scaleAdd(l_pRow, l_rsNew / l_rs[ii], l_rRow, l_pRow);
+                l_rs[ii] = l_rsNew;
+            }
 
-    if(!checkStop())
+            m_progress.set(60 + (30 * (l_iteration + 1)) / m_maxIterations, 100, QString("Tikhonov-CG"));
+        }
+
+    double l_maxResidual = 0.0;
+    for(int ii = 0; ii < l_dimOut; ++ii)
     {
-        return false;
+        if(l_bNorm[ii] > 0.0)
+        {
+            l_maxResidual = std::max(l_maxResidual, std::sqrt(l_rs[ii]) / l_bNorm[ii]);
+        }
     }
 
-    emit sendLogInfo(QString::fromStdString(displayTime("END : tikhonovRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
+    emit sendLogInfo("Conjugate gradient" + QString(l_warmStarted ? " (warm start)" : "") + " : " + QString::number(l_iteration) +
+                     " iterations, max relative residual " + QString::number(l_maxResidual) + "\n", QColor(Qt::black));
+
+    m_wOut = l_w;
+
+    emit sendLogInfo(QString::fromStdString(displayTime("END : conjugateGradientRegularization ", m_oTime, false, m_verbose)), QColor(Qt::black));
     return true;
 }
 
@@ -821,19 +981,31 @@ void Reservoir::loadParam(const std::string &path)
 }
 
 
-void Reservoir::saveTraining(const std::string &path)
+bool Reservoir::saveTraining(const std::string &path)
 {
-    save2DMatrixToTextStd(path + "/wOut.txt", m_wOut);
-    save2DMatrixToTextStd(path + "/wIn.txt", m_wIn);
-    save2DMatrixToTextStd(path + "/w.txt", m_w);    
-    saveParamFile(path);
+    if(save2DMatrixToTextStd(path + "/wOut.txt", m_wOut, &m_cancel) &&
+       save2DMatrixToTextStd(path + "/wIn.txt", m_wIn, &m_cancel) &&
+       save2DMatrixToTextStd(path + "/w.txt", m_w, &m_cancel))
+    {
+        saveParamFile(path);
+        return true;
+    }
+
+    // the matrices already saved don't match the previous ones anymore, the incomplete training is removed
+        QString l_path = QString::fromStdString(path);
+        QFile::remove(l_path + "/wOut.txt");
+        QFile::remove(l_path + "/wIn.txt");
+        QFile::remove(l_path + "/w.txt");
+        QFile::remove(l_path + "/param.txt");
+
+    return false;
 }
 
 void Reservoir::loadTraining(const std::string &path)
 {
-    load2DMatrixStd<float>(path + "/wOut.txt", m_wOutLoaded);
-    load2DMatrixStd<float>(path + "/wIn.txt", m_wInLoaded);
-    load2DMatrixStd<float>(path + "/w.txt", m_wLoaded);
+    load2DMatrixStd<float>(path + "/wOut.txt", m_wOutLoaded, &m_cancel);
+    load2DMatrixStd<float>(path + "/wIn.txt", m_wInLoaded, &m_cancel);
+    load2DMatrixStd<float>(path + "/w.txt", m_wLoaded, &m_cancel);
     loadParam(path);
 }
 
@@ -864,19 +1036,59 @@ void Reservoir::updateMatricesWithLoadedTraining()
     }
 }
 
+void Reservoir::setTraining(const cv::Mat &w, const cv::Mat &wIn, const cv::Mat &wOut)
+{
+    m_w    = w;
+    m_wIn  = wIn;
+    m_wOut = wOut;
+    m_nbNeurons = w.rows;
+}
+
 void Reservoir::setMatricesUse(cbool useCustomW, cbool useCustomWIn)
 {
     m_useW   = useCustomW;
     m_useWIn = useCustomWIn;
 }
 
+void Reservoir::setCpuBackend(const LinearAlgebraBackend::Type backend)
+{
+    m_cpuBackend = backend;
+}
+
+void Reservoir::setSketchRank(cint rank)
+{
+    m_sketchRank = rank;
+}
+
+float Reservoir::sketchError() const
+{
+    return m_sketchError;
+}
+
+void Reservoir::setIterativeSolver(cbool enabled, cint maxIterations, cfloat tolerance)
+{
+    m_iterativeSolver = enabled;
+    m_maxIterations   = maxIterations;
+    m_tolerance       = tolerance;
+}
+
+void Reservoir::setWarmStart(cbool enabled)
+{
+    m_warmStart = enabled;
+}
+
+void Reservoir::reportProgress(cint done, cint total, const QString &label)
+{
+    emit sendComputingState(done, total, label);
+}
+
 
 
 void Reservoir::enableMaxOmpThreadNumber(bool enable)
 {
     if(enable)
     {
-        m_numThread = omp_get_max_threads( );
+        m_numThread = 0;
     }
     else
     {
@@ -886,7 +1098,10 @@ void Reservoir::enableMaxOmpThreadNumber(bool enable)
 
 void Reservoir::stopLoop()
 {
-    m_stopLocker.lockForWrite();
-        m_stopLoop = true;
-    m_stopLocker.unlock();
+    m_cancel.cancel();
+}
+
+void Reservoir::resetStopLoop()
+{
+    m_cancel.reset();
 }
@@ -0,0 +1,201 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+/**
+ * \file ReservoirSession.cpp
+ * \brief defines ReservoirSession
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#include "ReservoirSession.h"
+
+ReservoirSession::ReservoirSession(const cv::Mat &w, const cv::Mat &wIn, const cv::Mat &wOut, cfloat leakRate) :
+    m_leakRate(leakRate), m_w(w), m_wIn(wIn), m_wOut(wOut)
+{
+    m_isValid = m_w.type() == CV_32FC1 && m_wIn.type() == CV_32FC1 && m_wOut.type() == CV_32FC1 &&
+                m_w.rows > 0 && m_w.rows == m_w.cols && m_wIn.rows == m_w.rows && m_wIn.cols > 0 &&
+                m_wOut.rows > 0 && m_wOut.cols == m_wIn.cols + m_w.rows;
+
+    if(!m_isValid)
+    {
+        std::cerr << "-ERROR : ReservoirSession -> the dimensions of the training matrices don't match. " << std::endl;
+        return;
+    }
+
+    // the input and the state are views on the same column, no concatenation is needed for the readout
+        m_extendedState = cv::Mat::zeros(m_wOut.cols, 1, CV_32FC1);
+        m_input         = m_extendedState.rowRange(0, m_wIn.cols);
+        m_x             = m_extendedState.rowRange(m_wIn.cols, m_extendedState.rows);
+
+        m_inputProduct      = cv::Mat(m_w.rows, 1, CV_32FC1);
+        m_recurrentProduct  = cv::Mat(m_w.rows, 1, CV_32FC1);
+        m_y                 = cv::Mat(m_wOut.rows, 1, CV_32FC1);
+
+    reset();
+}
+
+bool ReservoirSession::isValid() const
+{
+    return m_isValid;
+}
+
+int ReservoirSession::inputDimension() const
+{
+    return m_isValid ? m_wIn.cols - 1 : 0;
+}
+
+int ReservoirSession::outputDimension() const
+{
+    return m_isValid ? m_wOut.rows : 0;
+}
+
+void ReservoirSession::reset()
+{
+    if(!m_isValid)
+    {
+        return;
+    }
+
+    m_extendedState.setTo(cv::Scalar(0.f));
+    m_extendedState.at<float>(0) = 1.f;
+}
+
+void ReservoirSession::step(const float *input, float *output)
+{
+    if(!m_isValid)
+    {
+        return;
+    }
+
+    // u
+        float *l_input = m_input.ptr<float>();
+        for(int ii = 1; ii < m_input.rows; ++ii)
+        {
+            l_input[ii] = input[ii-1];
+        }
+
+    // x = (1 - a) * xPrev + a * tanh(W IN * [1;u] + W * xPrev)
+        cv::gemm(m_wIn, m_input, 1.0, cv::noArray(), 0.0, m_inputProduct);
+        cv::gemm(m_w,   m_x,     1.0, cv::noArray(), 0.0, m_recurrentProduct);
+
+        float l_invLeakRate = 1.f - m_leakRate;
+        float *l_x = m_x.ptr<float>();
+        const float *l_inputProduct     = m_inputProduct.ptr<float>();
+        const float *l_recurrentProduct = m_recurrentProduct.ptr<float>();
+        for(int ii = 0; ii < m_x.rows; ++ii)
+        {
+            l_x[ii] = l_x[ii] * l_invLeakRate + tanh(l_inputProduct[ii] + l_recurrentProduct[ii]) * m_leakRate;
+        }
+
+    // y = W OUT * [1;u;x]
+        cv::gemm(m_wOut, m_extendedState, 1.0, cv::noArray(), 0.0, m_y);
+        memcpy(output, m_y.ptr<float>(), m_y.rows * sizeof(float));
+}
+
+bool ReservoirSession::sharesTraining(const ReservoirSession &other) const
+{
+    return m_w.data == other.m_w.data && m_wIn.data == other.m_wIn.data && m_wOut.data == other.m_wOut.data && m_leakRate == other.m_leakRate;
+}
+
+
+void ReservoirSessionBatch::step(const std::vector<ReservoirSession*> &sessions, const std::vector<const float*> &inputs, const std::vector<float*> &outputs)
+{
+    if(sessions.size() == 0)
+    {
+        return;
+    }
+
+    const ReservoirSession *l_first = sessions[0];
+    int l_batchSize     = static_cast<int>(sessions.size());
+    int l_extendedSize  = l_first->m_extendedState.rows;
+    int l_inputSize     = l_first->m_input.rows;
+    int l_nbNeurons     = l_first->m_x.rows;
+    int l_outputSize    = l_first->m_y.rows;
+
+    // grow the buffers if needed
+        if(m_extendedStates.rows != l_extendedSize || m_extendedStates.cols < l_batchSize ||
+           m_inputProducts.rows != l_nbNeurons || m_y.rows != l_outputSize)
+        {
+            int l_capacity = std::max(l_batchSize, m_extendedStates.cols);
+            m_extendedStates    = cv::Mat(l_extendedSize, l_capacity, CV_32FC1);
+            m_inputProducts     = cv::Mat(l_nbNeurons,    l_capacity, CV_32FC1);
+            m_recurrentProducts = cv::Mat(l_nbNeurons,    l_capacity, CV_32FC1);
+            m_y                 = cv::Mat(l_outputSize,   l_capacity, CV_32FC1);
+        }
+
+        cv::Mat l_extendedStates    = m_extendedStates.colRange(0, l_batchSize);
+        cv::Mat l_inputs            = l_extendedStates.rowRange(0, l_inputSize);
+        cv::Mat l_x                 = l_extendedStates.rowRange(l_inputSize, l_extendedSize);
+        cv::Mat l_inputProducts     = m_inputProducts.colRange(0, l_batchSize);
+        cv::Mat l_recurrentProducts = m_recurrentProducts.colRange(0, l_batchSize);
+        cv::Mat l_y                 = m_y.colRange(0, l_batchSize);
+
+    // gather [1;u;xPrev]
+        for(int ii = 0; ii < l_batchSize; ++ii)
+        {
+            const float *l_state = sessions[ii]->m_extendedState.ptr<float>();
+            l_extendedStates.at<float>(0, ii) = 1.f;
+            for(int jj = 1; jj < l_inputSize; ++jj)
+            {
+                l_extendedStates.at<float>(jj, ii) = inputs[ii][jj-1];
+            }
+            for(int jj = l_inputSize; jj < l_extendedSize; ++jj)
+            {
+                l_extendedStates.at<float>(jj, ii) = l_state[jj];
+            }
+        }
+
+    // X = (1 - a) * XPrev + a * tanh(W IN * [1;U] + W * XPrev)
+        cv::gemm(l_first->m_wIn, l_inputs, 1.0, cv::noArray(), 0.0, l_inputProducts);
+        cv::gemm(l_first->m_w,   l_x,      1.0, cv::noArray(), 0.0, l_recurrentProducts);
+
+        float l_leakRate    = l_first->m_leakRate;
+        float l_invLeakRate = 1.f - l_leakRate;
+        for(int ii = 0; ii < l_nbNeurons; ++ii)
+        {
+            float *l_xRow = l_x.ptr<float>(ii);
+            const float *l_inputRow     = l_inputProducts.ptr<float>(ii);
+            const float *l_recurrentRow = l_recurrentProducts.ptr<float>(ii);
+            for(int jj = 0; jj < l_batchSize; ++jj)
+            {
+                l_xRow[jj] = l_xRow[jj] * l_invLeakRate + tanh(l_inputRow[jj] + l_recurrentRow[jj]) * l_leakRate;
+            }
+        }
+
+    // Y = W OUT * [1;U;X]
+        cv::gemm(l_first->m_wOut, l_extendedStates, 1.0, cv::noArray(), 0.0, l_y);
+
+    // scatter the states and the readouts
+        for(int ii = 0; ii < l_batchSize; ++ii)
+        {
+            float *l_state = sessions[ii]->m_extendedState.ptr<float>();
+            for(int jj = 0; jj < l_extendedSize; ++jj)
+            {
+                l_state[jj] = l_extendedStates.at<float>(jj, ii);
+            }
+            for(int jj = 0; jj < l_outputSize; ++jj)
+            {
+                outputs[ii][jj] = l_y.at<float>(jj, ii);
+            }
+        }
+}
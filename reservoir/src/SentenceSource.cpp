@@ -0,0 +1,67 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+/**
+ * \file SentenceSource.cpp
+ * \brief defines SentenceSource
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#include "SentenceSource.h"
+#include "NpyIO.h"
+
+NpySentenceSource::NpySentenceSource(const QString &meaningPath, const QString &teacherPath) :
+    m_meaningPath(meaningPath), m_teacherPath(teacherPath), m_nbSentences(0)
+{
+    // only the headers are read
+        cv::Mat l_empty;
+        int l_nbMeaning = 0, l_nbTeacher = 0;
+        if(!loadNpyChunkF(m_meaningPath, 0, 0, l_empty, &l_nbMeaning) || !loadNpyChunkF(m_teacherPath, 0, 0, l_empty, &l_nbTeacher))
+        {
+            return;
+        }
+
+        if(l_nbMeaning != l_nbTeacher)
+        {
+            std::cerr << "-ERROR : NpySentenceSource -> the meaning and teacher files don't have the same number of sentences. " << std::endl;
+            return;
+        }
+
+        m_nbSentences = l_nbMeaning;
+}
+
+int NpySentenceSource::nbSentences() const
+{
+    return m_nbSentences;
+}
+
+bool NpySentenceSource::chunk(cint first, cint count, cv::Mat &meaningInput, cv::Mat &teacher)
+{
+    if(first < 0 || first >= m_nbSentences)
+    {
+        std::cerr << "-ERROR : NpySentenceSource::chunk -> sentence index out of range. " << std::endl;
+        return false;
+    }
+
+    return loadNpyChunkF(m_meaningPath, first, count, meaningInput) && loadNpyChunkF(m_teacherPath, first, count, teacher);
+}
@@ -0,0 +1,289 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+
+/**
+ * \file TaskScheduler.cpp
+ * \brief defines TaskScheduler
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#include "TaskScheduler.h"
+
+static QMutex g_instanceLock;               /**< lock for creating the shared scheduler */
+static TaskScheduler *g_instance = NULL;    /**< shared scheduler, kept until the end of the process */
+static QThreadStorage<int*> g_threadBudget; /**< thread budget of each calling thread, not set : all the threads */
+
+TaskSchedulerThread::TaskSchedulerThread(TaskScheduler *scheduler, cint id) : m_scheduler(scheduler), m_id(id)
+{}
+
+void TaskSchedulerThread::run()
+{
+    TaskChunk l_chunk;
+    while(m_scheduler->popChunk(m_id, l_chunk, true))
+    {
+        m_scheduler->runChunk(l_chunk);
+    }
+}
+
+TaskScheduler::TaskScheduler(cint nbThreads) : m_queuedChunks(0), m_wakeUps(0), m_closed(false)
+{
+    // the calling thread of parallelFor is the last one
+        int l_nbWorkers = std::max(0, nbThreads - 1);
+
+        m_queues.resize(l_nbWorkers);
+        for(int ii = 0; ii < l_nbWorkers; ++ii)
+        {
+            m_queuesLocks.push_back(new QMutex());
+            m_threads.push_back(new TaskSchedulerThread(this, ii));
+        }
+
+        for(int ii = 0; ii < l_nbWorkers; ++ii)
+        {
+            m_threads[ii]->start();
+        }
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    m_sleepLock.lock();
+        m_closed = true;
+        m_chunksAdded.wakeAll();
+    m_sleepLock.unlock();
+
+    for(int ii = 0; ii < static_cast<int>(m_threads.size()); ++ii)
+    {
+        m_threads[ii]->wait();
+        delete m_threads[ii];
+        delete m_queuesLocks[ii];
+    }
+}
+
+TaskScheduler *TaskScheduler::instance()
+{
+    QMutexLocker l_locker(&g_instanceLock);
+
+    if(!g_instance)
+    {
+        g_instance = new TaskScheduler(std::max(1, QThread::idealThreadCount()));
+    }
+
+    return g_instance;
+}
+
+int TaskScheduler::threadNumber() const
+{
+    return static_cast<int>(m_threads.size()) + 1;
+}
+
+void TaskScheduler::setThreadBudget(cint nbThreads)
+{
+    if(!g_threadBudget.hasLocalData())
+    {
+        g_threadBudget.setLocalData(new int(0));
+    }
+
+    *g_threadBudget.localData() = std::max(0, nbThreads);
+}
+
+int TaskScheduler::threadBudget() const
+{
+    int l_budget = g_threadBudget.hasLocalData() ? *g_threadBudget.localData() : 0;
+
+    return l_budget > 0 ? std::min(l_budget, threadNumber()) : threadNumber();
+}
+
+bool TaskScheduler::takeChunk(cint queue, cbool front, TaskChunk &chunk)
+{
+    QMutexLocker l_locker(m_queuesLocks[queue]);
+
+    std::deque<TaskChunk> &l_queue = m_queues[queue];
+    int l_size = static_cast<int>(l_queue.size());
+    for(int ii = 0; ii < l_size; ++ii)
+    {
+        int l_id = front ? ii : l_size - 1 - ii;
+        TaskCall *l_call = l_queue[l_id].m_call;
+
+        // the call already uses all its threads
+            if(l_call->m_running.fetchAndAddOrdered(1) >= l_call->m_maxThreads)
+            {
+                l_call->m_running.fetchAndAddOrdered(-1);
+                continue;
+            }
+
+        chunk = l_queue[l_id];
+        l_queue.erase(l_queue.begin() + l_id);
+        m_queuedChunks.fetchAndAddOrdered(-1);
+        return true;
+    }
+
+    return false;
+}
+
+bool TaskScheduler::popChunk(cint queue, TaskChunk &chunk, cbool wait)
+{
+    int l_nbQueues = static_cast<int>(m_queues.size());
+
+    while(true)
+    {
+        m_sleepLock.lock();
+            int l_wakeUps = m_wakeUps;
+        m_sleepLock.unlock();
+
+        // front of the own queue
+            if(queue >= 0 && takeChunk(queue, true, chunk))
+            {
+                return true;
+            }
+
+        // back of the other queues
+            for(int ii = 1; ii <= l_nbQueues; ++ii)
+            {
+                int l_victim = (queue + ii) % l_nbQueues;
+                if(l_victim != queue && takeChunk(l_victim, false, chunk))
+                {
+                    return true;
+                }
+            }
+
+        if(!wait)
+        {
+            return false;
+        }
+
+        // sleep until chunks are added or can be run
+            QMutexLocker l_locker(&m_sleepLock);
+            while(m_wakeUps == l_wakeUps && !m_closed)
+            {
+                m_chunksAdded.wait(&m_sleepLock);
+            }
+
+            if(m_closed)
+            {
+                return false;
+            }
+    }
+}
+
+void TaskScheduler::wakeUp()
+{
+    QMutexLocker l_locker(&m_sleepLock);
+    ++m_wakeUps;
+    m_chunksAdded.wakeAll();
+}
+
+void TaskScheduler::runChunk(const TaskChunk &chunk)
+{
+    TaskCall *l_call = chunk.m_call;
+    l_call->m_task->run(chunk.m_begin, chunk.m_end);
+
+    // the call must not be read after its last chunk, the calling thread may have returned
+        bool l_limited = l_call->m_maxThreads < threadNumber();
+        l_call->m_running.fetchAndAddOrdered(-1);
+
+        if(l_call->m_remaining.fetchAndAddOrdered(-1) == 1)
+        {
+            QMutexLocker l_locker(&m_doneLock);
+            m_chunkDone.wakeAll();
+        }
+        else if(l_limited && m_queuedChunks > 0)
+        {
+            // a thread of the call is free, the waiting chunks of the call can be run
+            wakeUp();
+        }
+}
+
+void TaskScheduler::parallelFor(SentenceTask &task, cint nbSentences, const std::vector<int> *costs, cint maxThreads)
+{
+    if(nbSentences <= 0)
+    {
+        return;
+    }
+
+    int l_maxThreads = maxThreads > 0 ? std::min(maxThreads, threadNumber()) : threadBudget();
+    if(l_maxThreads == 1 || nbSentences == 1 || m_threads.empty())
+    {
+        task.run(0, nbSentences);
+        return;
+    }
+
+    // cut the sentences in chunks of similar cost, several chunks per thread for balancing the end of the call
+        qint64 l_totalCost = 0;
+        for(int ii = 0; ii < nbSentences; ++ii)
+        {
+            l_totalCost += costs ? std::max(1, (*costs)[ii]) : 1;
+        }
+        qint64 l_chunkCost = std::max(Q_INT64_C(1), l_totalCost / (l_maxThreads * 4));
+
+        std::vector<std::pair<int,int> > l_ranges;
+        qint64 l_cost = 0;
+        int l_begin = 0;
+        for(int ii = 0; ii < nbSentences; ++ii)
+        {
+            l_cost += costs ? std::max(1, (*costs)[ii]) : 1;
+            if(l_cost >= l_chunkCost || ii == nbSentences - 1)
+            {
+                l_ranges.push_back(std::make_pair(l_begin, ii + 1));
+                l_begin = ii + 1;
+                l_cost  = 0;
+            }
+        }
+
+        int l_nbChunks = static_cast<int>(l_ranges.size());
+
+        TaskCall l_call;
+        l_call.m_task       = &task;
+        l_call.m_remaining  = l_nbChunks;
+        l_call.m_running    = 0;
+        l_call.m_maxThreads = l_maxThreads;
+
+    // deal the chunks in the queues of the first threads of the budget, the neighbouring sentences stay in the same queue
+        int l_nbQueues = std::min(static_cast<int>(m_queues.size()), l_maxThreads - 1);
+        for(int ii = 0; ii < l_nbChunks; ++ii)
+        {
+            TaskChunk l_chunk;
+            l_chunk.m_call  = &l_call;
+            l_chunk.m_begin = l_ranges[ii].first;
+            l_chunk.m_end   = l_ranges[ii].second;
+
+            int l_queue = (ii * l_nbQueues) / l_nbChunks;
+            QMutexLocker l_locker(m_queuesLocks[l_queue]);
+            m_queues[l_queue].push_back(l_chunk);
+        }
+
+        m_queuedChunks.fetchAndAddOrdered(l_nbChunks);
+        wakeUp();
+
+    // the calling thread steals chunks until the queues are empty, then waits for the chunks still running
+        TaskChunk l_chunk;
+        while(l_call.m_remaining > 0 && popChunk(-1, l_chunk, false))
+        {
+            runChunk(l_chunk);
+        }
+
+        QMutexLocker l_locker(&m_doneLock);
+        while(l_call.m_remaining > 0)
+        {
+            m_chunkDone.wait(&m_doneLock);
+        }
+}
@@ -21,6 +21,7 @@
 
 
 #include <iostream>
+#include <algorithm>
 
 // YARP
 #include <yarp/os/all.h>
@@ -32,8 +33,27 @@
 using namespace yarp::os;
 
 
+// reservoir-yarp-test [mode] [requests number] [concurrency] [rate] [report path] [training] [corpus path]
+//  mode        : train / test / both (jobs sent on the parameters and control ports) or stream (steps sent on the stream port)
+//  concurrency : maximum number of requests waiting for their results (number of sessions for the stream mode)
+//  rate        : maximum number of requests sent per second (0 -> no limit)
+//  training    : training directory used by the test jobs, name or directory of the training opened by the stream sessions
+
+
+/**
+ * @brief Latencies and counters of a load test
+ */
+struct LoadStatistics
+{
+    std::vector<double> m_latencies;    /**< latency of each answered request (us) */
+    int m_sent;                         /**< number of requests sent */
+    int m_errors;                       /**< number of error answers */
+    int m_timeouts;                     /**< number of requests without answer */
+    double m_duration;                  /**< duration of the test (s) */
+};
+
 static void setParametersBottle(yarp::os::Bottle &bottle, int actionToDo, std::string corpus, std::string structure, std::string CCW, int neurons, double leakrate, double iss, double spectralRadius,
-                                double ridge, double sparcity, int useCuda, std::string pathTraining, std::string pathW, std::string pathWIn)
+                                double ridge, double sparcity, int useCuda, std::string pathTraining, std::string pathW, std::string pathWIn, std::string jobId = "")
 {
     bottle.addInt(actionToDo);          // 0 -> action to do : 0 -> train / 1 -> test / 2 -> both
     bottle.addString(corpus);           // 1 -> corpus (string)
@@ -49,174 +69,385 @@ static void setParametersBottle(yarp::os::Bottle &bottle, int actionToDo, std::s
     bottle.addString(pathTraining);     // 11-> directory path of the training file to be used (string) (if "", no training file will be used)
     bottle.addString(pathW);            // 12-> directory path of the W matrice file to be used (string) (if "", no W matrice file will be used)
     bottle.addString(pathWIn);          // 13-> directory path of the WIn matrice file to be used (string) (if "", no WIn matrice file will be used)
+    bottle.addString(jobId);            // 14-> JOB ID (string) (sent back with the results)
 }
 
-int main(int argc, char* argv[])
+/**
+ * @brief percentile of sorted latencies
+ * @param [in] sortedLatencies
+ * @param [in] rank : between 0 and 1
+ * @return
+ */
+static double percentile(const std::vector<double> &sortedLatencies, const double rank)
 {
-    // initialize yarp network
-    yarp::os::Network l_oYarp;
-    if (!l_oYarp.checkNetwork())
+    if(sortedLatencies.size() == 0)
     {
-        std::cerr << "-ERROR: Problem connecting to YARP server" << std::endl;
-        return -1;
+        return 0.;
     }
 
-    QString l_path = QDir::currentPath() + "/";
-    qDebug()  << l_path;
+    size_t l_id = static_cast<size_t>(rank * (sortedLatencies.size() - 1) + 0.5);
+    return sortedLatencies[std::min(l_id, sortedLatencies.size() - 1)];
+}
+
+/**
+ * @brief write the report of the load test in a json file and display a summary
+ * @param [in] path
+ * @param [in] mode
+ * @param [in] concurrency
+ * @param [in] rate
+ * @param [in,out] statistics : the latencies are sorted
+ */
+static void writeReport(const QString &path, const QString &mode, cint concurrency, cdouble rate, LoadStatistics &statistics)
+{
+    std::vector<double> &l_latencies = statistics.m_latencies;
+    std::sort(l_latencies.begin(), l_latencies.end());
+
+    double l_mean = 0.;
+    for(size_t ii = 0; ii < l_latencies.size(); ++ii)
+    {
+        l_mean += l_latencies[ii];
+    }
+    l_mean = l_latencies.size() > 0 ? l_mean / l_latencies.size() : 0.;
+
+    // histogram with power of 2 buckets : [2^ii, 2^(ii+1)[ us
+        QVector<int> l_histogram;
+        for(size_t ii = 0; ii < l_latencies.size(); ++ii)
+        {
+            int l_bucket = 0;
+            while(l_latencies[ii] >= static_cast<double>(Q_INT64_C(2) << l_bucket) && l_bucket < 40)
+            {
+                ++l_bucket;
+            }
+            if(l_histogram.size() <= l_bucket)
+            {
+                l_histogram.resize(l_bucket + 1);
+            }
+            ++l_histogram[l_bucket];
+        }
 
-    QString l_pathCorpus   = l_path + "../data/input/Corpus/10_test.txt";
-    QFile l_fileCorpus(l_pathCorpus);
-    QString l_corpusString;
+    double l_throughput = statistics.m_duration > 0. ? l_latencies.size() / statistics.m_duration : 0.;
 
-    QString l_structure = "P0 A1 O2 R3";
-    QString l_CCW = "and s of the to . -ed -ing -s by it that was did , from";
+    QStringList l_buckets;
+    for(int ii = 0; ii < l_histogram.size(); ++ii)
+    {
+        l_buckets << "{\"upperUs\": " + QString::number(Q_INT64_C(2) << ii) + ", \"count\": " + QString::number(l_histogram[ii]) + "}";
+    }
 
-    if(l_fileCorpus.open(QIODevice::ReadOnly | QIODevice::Text))
+    QString l_report;
+    QTextStream l_stream(&l_report);
+    l_stream << "{\n";
+    l_stream << "  \"mode\": \"" << mode << "\",\n";
+    l_stream << "  \"concurrency\": " << concurrency << ",\n";
+    l_stream << "  \"rate\": " << rate << ",\n";
+    l_stream << "  \"sent\": " << statistics.m_sent << ",\n";
+    l_stream << "  \"answered\": " << l_latencies.size() << ",\n";
+    l_stream << "  \"errors\": " << statistics.m_errors << ",\n";
+    l_stream << "  \"timeouts\": " << statistics.m_timeouts << ",\n";
+    l_stream << "  \"durationS\": " << statistics.m_duration << ",\n";
+    l_stream << "  \"throughput\": " << l_throughput << ",\n";
+    l_stream << "  \"latencyUs\": {\"min\": " << (l_latencies.size() > 0 ? l_latencies.front() : 0.) << ", \"mean\": " << l_mean
+             << ", \"p50\": " << percentile(l_latencies, 0.5) << ", \"p99\": " << percentile(l_latencies, 0.99)
+             << ", \"p999\": " << percentile(l_latencies, 0.999) << ", \"max\": " << (l_latencies.size() > 0 ? l_latencies.back() : 0.) << "},\n";
+    l_stream << "  \"histogram\": [" << l_buckets.join(", ") << "]\n";
+    l_stream << "}\n";
+    l_stream.flush();
+
+    QFile l_reportFile(path);
+    if(l_reportFile.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        QTextStream l_fileStream(&l_reportFile);
+        l_fileStream << l_report;
+    }
+    else
     {
-        QTextStream in(&l_fileCorpus);
-        l_corpusString = in.readAll();
+        std::cerr << "-ERROR : writeReport -> can not write the report file " << path.toStdString() << ". " << std::endl;
     }
 
-    yarp::os::BufferedPort<yarp::os::Bottle> l_controlPort;
-    yarp::os::BufferedPort<yarp::os::Bottle> l_parametersPort;
-    yarp::os::BufferedPort<yarp::os::Bottle> l_resultsPort;
+    std::cout << l_report.toStdString() << std::endl;
+}
+
+/**
+ * @brief send the jobs and wait for their results on the results port
+ * @param [in] action       : 0 train / 1 test / 2 both
+ * @param [in] requests     : number of jobs
+ * @param [in] concurrency  : maximum number of jobs waiting for their results
+ * @param [in] rate         : maximum number of jobs sent per second (0 -> no limit)
+ * @param [in] corpus
+ * @param [in] training     : training directory used by the tests
+ * @param [out] statistics
+ */
+static void runJobs(cint action, cint requests, cint concurrency, cdouble rate, const QString &corpus, const QString &training, LoadStatistics &statistics)
+{
+    const qint64 l_timeout = 600 * Q_INT64_C(1000000000);
+
+    yarp::os::BufferedPort<yarp::os::Bottle> l_controlPort, l_parametersPort, l_resultsPort;
     l_parametersPort.open("/reservoir/parameters/out");
     l_controlPort.open("/reservoir/control/out");
     l_resultsPort.open("/reservoir/results/in");
+    yarp::os::Network::connect("/reservoir/parameters/out", "/reservoir/parameters/in");
+    yarp::os::Network::connect("/reservoir/control/out", "/reservoir/control/in");
+    yarp::os::Network::connect("/reservoir/results/out", "/reservoir/results/in");
 
-    qDebug() << "Enter a key and press enter to start.";
-    std::string l_s;
-    std::cin >> l_s;
-
-    {
-        // send parameters
-        yarp::os::Bottle &l_parametersBottle = l_parametersPort.prepare();
-        l_parametersBottle.addInt(0);                                           // 0 -> action to do : 0 -> train / 1 -> test / 2 -> both
-        l_parametersBottle.addString(l_corpusString.toStdString());             // 1 -> corpus (string)
-        l_parametersBottle.addString(l_structure.toStdString());                // 2 -> structure (P0 A1 O2 R3) (string)
-        l_parametersBottle.addString(l_CCW.toStdString());                      // 3 -> CCW (string)
-        l_parametersBottle.addInt(500);                                         // 4 -> NEURONS (int) (if -1 -> default value)
-        l_parametersBottle.addDouble(0.5);                                      // 5 -> LEAKRATE (double) (if -1 -> default value)
-        l_parametersBottle.addDouble(0.2);                                      // 6 -> INPUT SCALING (double) (if -1 -> default value)
-        l_parametersBottle.addDouble(4.0);                                      // 7 -> SPECTRAL RADIUS (double) (if -1 -> default value)
-        l_parametersBottle.addDouble(-1);                                       // 8 -> RIDGE(double)(if -1 -> default value)
-        l_parametersBottle.addDouble(-1);                                       // 9 -> SPARCITY (double)   (if -1 -> automatic recommanded value)
-        l_parametersBottle.addInt(1);                                           // 10-> USE CUDA (int) (if 1, use CUDA else do not use)
-        l_parametersBottle.addString("");                                       // 11-> directory path of the training file to be used (string) (if "", no training file will be used)
-        l_parametersBottle.addString("");                                       // 12-> directory path of the W matrice file to be used (string) (if "", no W matrice file will be used)
-        l_parametersBottle.addString("");                                       // 13-> directory path of the WIn matrice file to be used (string) (if "", no WIn matrice file will be used)
-        l_parametersPort.write();
-
-        // start the reservoir
-        yarp::os::Bottle &l_controlBottle = l_controlPort.prepare();
-        l_controlBottle.addInt(1);                                              // 0 -> START RESERVOIR (int) (if 1 start, else do nothing)
-        l_controlBottle.addString("../data/training/last");                     // 1 -> directory of the training to be saved (string) (if "", no saving is perfomed)
-        l_controlBottle.addString("../data/input/Matrices/W/last");             // 2 -> directory of the matrice W to be saved (string) (if "", no saving is perfomed)
-        l_controlBottle.addString("../data/input/Matrices/WIn/last");           // 3 -> directory of the matrice WIn to be saved (string) (if "", no saving is perfomed)
-        l_controlPort.write();
-    }
+    std::string l_structure = "P0 A1 O2 R3";
+    std::string l_CCW = "and s of the to . -ed -ing -s by it that was did , from";
 
-    yarp::os::Bottle *l_resultsBottle = NULL;
+    QMap<QString, qint64> l_waiting;
+    QElapsedTimer l_timer;
+    l_timer.start();
 
-    // retrieve results
-        bool l_resultsReceived = false;
-        while(!l_resultsReceived)
-        {
-             l_resultsBottle = l_resultsPort.read(false);
+    while(statistics.m_sent < requests || l_waiting.size() > 0)
+    {
+        // send the jobs allowed by the concurrency and the rate
+            while(statistics.m_sent < requests && l_waiting.size() < concurrency &&
+                  (rate <= 0. || l_timer.nsecsElapsed() >= static_cast<qint64>(statistics.m_sent * 1e9 / rate)))
+            {
+                QString l_jobId = "load-" + QString::number(statistics.m_sent);
+
+                yarp::os::Bottle &l_parametersBottle = l_parametersPort.prepare();
+                l_parametersBottle.clear();
+                setParametersBottle(l_parametersBottle, action, corpus.toStdString(), l_structure, l_CCW, 500, 0.5, 0.2, 4.0, -1, -1, 0,
+                                    action == 1 ? training.toStdString() : "", "", "", l_jobId.toStdString());
+                l_parametersPort.writeStrict();
+
+                yarp::os::Bottle &l_controlBottle = l_controlPort.prepare();
+                l_controlBottle.clear();
+                l_controlBottle.addInt(1);                                      // 0 -> START RESERVOIR (int) (if 1 start, else do nothing)
+                l_controlBottle.addString("");                                  // 1 -> directory of the training to be saved (string) (if "", no saving is perfomed)
+                l_controlBottle.addString("");                                  // 2 -> directory of the matrice W to be saved (string) (if "", no saving is perfomed)
+                l_controlBottle.addString("");                                  // 3 -> directory of the matrice WIn to be saved (string) (if "", no saving is perfomed)
+                l_controlBottle.addString(l_jobId.toStdString());               // 4 -> JOB ID (string)
+                l_controlPort.writeStrict();
+
+                l_waiting[l_jobId] = l_timer.nsecsElapsed();
+                ++statistics.m_sent;
+            }
 
-            if(l_resultsBottle)
+        // the job id is the last element of the results and of the errors
+            yarp::os::Bottle *l_resultsBottle = l_resultsPort.read(false);
+            if(l_resultsBottle && l_resultsBottle->size() > 0)
             {
-                l_resultsReceived = true;
-                QString l_trainSentences = QString::fromStdString(l_resultsBottle->get(0).asString()); // 0 -> train sentences (string)
-                QString l_trainResults   = QString::fromStdString(l_resultsBottle->get(1).asString()); // 1 -> train results (string)
-                QString l_testsResults   = QString::fromStdString(l_resultsBottle->get(2).asString()); // 2 -> test results (string)
-                QString l_trainCCW       = QString::fromStdString(l_resultsBottle->get(3).asString()); // 3 -> train CCW (string)
-                QString l_trainAll       = QString::fromStdString(l_resultsBottle->get(4).asString()); // 4 -> train All (string)
-                QString l_testsCCW       = QString::fromStdString(l_resultsBottle->get(5).asString()); // 5 -> test CCW (string)
-                QString l_testsAll       = QString::fromStdString(l_resultsBottle->get(6).asString()); // 6 -> test All (string)
-
-                qDebug() << "Display results :";
-                qDebug() << l_trainSentences;
-                qDebug() << l_trainResults;
-                qDebug() << l_testsResults;
-                qDebug() << l_trainCCW;
-                qDebug() << l_trainAll;
-                qDebug() << l_testsCCW;
-                qDebug() << l_testsAll;
+                QString l_jobId = QString::fromStdString(l_resultsBottle->get(l_resultsBottle->size()-1).asString());
+                if(l_waiting.contains(l_jobId))
+                {
+                    if(std::string(l_resultsBottle->get(0).asString()) == "error")
+                    {
+                        ++statistics.m_errors;
+                    }
+                    else
+                    {
+                        statistics.m_latencies.push_back((l_timer.nsecsElapsed() - l_waiting[l_jobId]) * 1e-3);
+                    }
+                    l_waiting.remove(l_jobId);
+                }
+                continue;
             }
 
-            QTime l_dieTime = QTime::currentTime().addMSecs(10);
-            while( QTime::currentTime() < l_dieTime)
+        // timeouts
+            for(QMap<QString, qint64>::iterator ii = l_waiting.begin(); ii != l_waiting.end();)
             {
-                QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+                if(l_timer.nsecsElapsed() - ii.value() > l_timeout)
+                {
+                    ++statistics.m_timeouts;
+                    ii = l_waiting.erase(ii);
+                }
+                else
+                {
+                    ++ii;
+                }
             }
-        }
 
-    // wait
-        QTime l_dieTime = QTime::currentTime().addMSecs(3000);
-        while( QTime::currentTime() < l_dieTime)
-        {
-            QCoreApplication::processEvents(QEventLoop::AllEvents, 3000);
-        }
+        yarp::os::Time::delay(0.001);
+    }
+
+    statistics.m_duration = l_timer.nsecsElapsed() * 1e-9;
 
-    // in order to change the parameter, just send another parameter bottle, and a new control bottle
-    // this command will ask to the reservoir to load the training file previously saved and to perform a test with the same parameters
+    l_parametersPort.close();
+    l_controlPort.close();
+    l_resultsPort.close();
+}
+
+/**
+ * @brief open streaming sessions and send steps, each session waits for its readout before sending the next step
+ * @param [in] requests     : number of steps
+ * @param [in] concurrency  : number of sessions
+ * @param [in] rate         : maximum number of steps sent per second (0 -> no limit)
+ * @param [in] training     : name or directory of the training of the sessions
+ * @param [out] statistics
+ */
+static void runStream(cint requests, cint concurrency, cdouble rate, const QString &training, LoadStatistics &statistics)
+{
+    const qint64 l_timeout = 10 * Q_INT64_C(1000000000);
+
+    yarp::os::BufferedPort<yarp::os::Bottle> l_streamOutPort, l_streamInPort;
+    l_streamOutPort.open("/reservoir/test/stream/out");
+    l_streamInPort.open("/reservoir/test/stream/in");
+    yarp::os::Network::connect("/reservoir/test/stream/out", "/reservoir/stream/in");
+    yarp::os::Network::connect("/reservoir/stream/out", "/reservoir/test/stream/in");
+
+    // open the sessions
+        int l_inputDimension = -1;
+        for(int ii = 0; ii < concurrency; ++ii)
         {
-            yarp::os::Bottle &l_parametersBottle = l_parametersPort.prepare();
-            setParametersBottle(l_parametersBottle,1, l_corpusString.toStdString(), l_structure.toStdString(),l_CCW.toStdString(), 500,0.5,0.2,4.0,-1,-1,1, "../data/training/last","","");
-            l_parametersPort.write();
-
-            yarp::os::Bottle &l_controlBottle = l_controlPort.prepare();
-            l_controlBottle.addInt(1);                                              // 0 -> START RESERVOIR (int) (if 1 start, else do nothing)
-            l_controlBottle.addString("");                                          // 1 -> directory of the training to be saved (string) (if "", no saving is perfomed)
-            l_controlBottle.addString("");                                          // 2 -> directory of the matrice W to be saved (string) (if "", no saving is perfomed)
-            l_controlBottle.addString("");                                          // 3 -> directory of the matrice WIn to be saved (string) (if "", no saving is perfomed)
-            l_controlPort.write();
+            yarp::os::Bottle &l_openBottle = l_streamOutPort.prepare();
+            l_openBottle.clear();
+            l_openBottle.addString("open");
+            l_openBottle.addString(("load-" + QString::number(ii)).toStdString());
+            l_openBottle.addString(training.toStdString());
+            l_streamOutPort.writeStrict();
+
+            yarp::os::Bottle *l_answer = l_streamInPort.read(true);
+            if(!l_answer || std::string(l_answer->get(0).asString()) != "opened")
+            {
+                std::cerr << "-ERROR : runStream -> can not open the session " << ii << ". " << std::endl;
+                l_streamOutPort.close();
+                l_streamInPort.close();
+                return;
+            }
+            l_inputDimension = l_answer->get(2).asInt();
         }
 
+    QVector<QString> l_freeSessions;
+    for(int ii = concurrency - 1; ii >= 0; --ii)
+    {
+        l_freeSessions.push_back("load-" + QString::number(ii));
+    }
+
+    QMap<QString, qint64> l_waiting;
+    QElapsedTimer l_timer;
+    l_timer.start();
+
+    while(statistics.m_sent < requests || l_waiting.size() > 0)
+    {
+        // send the steps of the free sessions allowed by the rate
+            while(statistics.m_sent < requests && l_freeSessions.size() > 0 &&
+                  (rate <= 0. || l_timer.nsecsElapsed() >= static_cast<qint64>(statistics.m_sent * 1e9 / rate)))
+            {
+                QString l_sessionId = l_freeSessions.back();
+                l_freeSessions.pop_back();
+
+                yarp::os::Bottle &l_stepBottle = l_streamOutPort.prepare();
+                l_stepBottle.clear();
+                l_stepBottle.addString("step");
+                l_stepBottle.addString(l_sessionId.toStdString());
+                for(int ii = 0; ii < l_inputDimension; ++ii)
+                {
+                    l_stepBottle.addDouble((statistics.m_sent + ii) % 2);
+                }
+                l_streamOutPort.writeStrict();
+
+                l_waiting[l_sessionId] = l_timer.nsecsElapsed();
+                ++statistics.m_sent;
+            }
 
-    // retrieve results
-        l_resultsReceived = false;
-        l_resultsBottle = NULL;
-        while(!l_resultsReceived)
+        yarp::os::Bottle *l_answer = l_streamInPort.read(false);
+        if(l_answer)
         {
-             l_resultsBottle = l_resultsPort.read(false);
+            // ("output" session ...) / ("error" message session)
+                bool l_error = std::string(l_answer->get(0).asString()) == "error";
+                QString l_sessionId = QString::fromStdString(l_answer->get(l_error ? 2 : 1).asString());
+                if(l_waiting.contains(l_sessionId))
+                {
+                    if(l_error)
+                    {
+                        ++statistics.m_errors;
+                    }
+                    else
+                    {
+                        statistics.m_latencies.push_back((l_timer.nsecsElapsed() - l_waiting[l_sessionId]) * 1e-3);
+                    }
+                    l_waiting.remove(l_sessionId);
+                    l_freeSessions.push_back(l_sessionId);
+                }
+                continue;
+            }
 
-            if(l_resultsBottle)
+        // timeouts, the session is not used anymore
+            for(QMap<QString, qint64>::iterator ii = l_waiting.begin(); ii != l_waiting.end();)
             {
-                l_resultsReceived = true;
-                QString l_trainSentences = QString::fromStdString(l_resultsBottle->get(0).asString()); // 0 -> train sentences (string)
-                QString l_trainResults   = QString::fromStdString(l_resultsBottle->get(1).asString()); // 1 -> train results (string)
-                QString l_testsResults   = QString::fromStdString(l_resultsBottle->get(2).asString()); // 2 -> test results (string)
-                QString l_trainCCW       = QString::fromStdString(l_resultsBottle->get(3).asString()); // 3 -> train CCW (string)
-                QString l_trainAll       = QString::fromStdString(l_resultsBottle->get(4).asString()); // 4 -> train All (string)
-                QString l_testsCCW       = QString::fromStdString(l_resultsBottle->get(5).asString()); // 5 -> test CCW (string)
-                QString l_testsAll       = QString::fromStdString(l_resultsBottle->get(6).asString()); // 6 -> test All (string)
-
-                qDebug() << "Display results :";
-                qDebug() << l_trainSentences;
-                qDebug() << l_trainResults;
-                qDebug() << l_testsResults;
-                qDebug() << l_trainCCW;
-                qDebug() << l_trainAll;
-                qDebug() << l_testsCCW;
-                qDebug() << l_testsAll;
+                if(l_timer.nsecsElapsed() - ii.value() > l_timeout)
+                {
+                    ++statistics.m_timeouts;
+                    ii = l_waiting.erase(ii);
+                }
+                else
+                {
+                    ++ii;
+                }
             }
 
-            QTime l_dieTime = QTime::currentTime().addMSecs(10);
-            while( QTime::currentTime() < l_dieTime)
+            if(l_freeSessions.size() == 0 && l_waiting.size() == 0)
             {
-                QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+                break;
             }
-        }
 
-    // load training
-    l_parametersPort.close();
-    l_controlPort.close();
-    l_resultsPort.close();
+        yarp::os::Time::delay(0.00005);
+    }
+
+    statistics.m_duration = l_timer.nsecsElapsed() * 1e-9;
+
+    // close the sessions
+        for(int ii = 0; ii < concurrency; ++ii)
+        {
+            yarp::os::Bottle &l_closeBottle = l_streamOutPort.prepare();
+            l_closeBottle.clear();
+            l_closeBottle.addString("close");
+            l_closeBottle.addString(("load-" + QString::number(ii)).toStdString());
+            l_streamOutPort.writeStrict();
+        }
 
-    return 0;
+    l_streamOutPort.close();
+    l_streamInPort.close();
 }
 
+int main(int argc, char* argv[])
+{
+    // initialize yarp network
+    yarp::os::Network l_oYarp;
+    if (!l_oYarp.checkNetwork())
+    {
+        std::cerr << "-ERROR: Problem connecting to YARP server" << std::endl;
+        return -1;
+    }
+
+    QString l_path = QDir::currentPath() + "/";
+
+    QString l_mode        = argc > 1 ? QString(argv[1]) : QString("train");
+    int l_requests        = argc > 2 ? std::max(1, QString(argv[2]).toInt()) : 10;
+    int l_concurrency     = argc > 3 ? std::max(1, QString(argv[3]).toInt()) : 1;
+    double l_rate         = argc > 4 ? std::max(0., QString(argv[4]).toDouble()) : 0.;
+    QString l_reportPath  = argc > 5 ? QString(argv[5]) : l_path + "../log/yarp_load_report.json";
+    QString l_training    = argc > 6 ? QString(argv[6]) : QString("../data/training/last");
+    QString l_pathCorpus  = argc > 7 ? QString(argv[7]) : l_path + "../data/input/Corpus/10_test.txt";
 
+    LoadStatistics l_statistics;
+    l_statistics.m_sent = l_statistics.m_errors = l_statistics.m_timeouts = 0;
+    l_statistics.m_duration = 0.;
+    l_statistics.m_latencies.reserve(l_requests);
 
+    if(l_mode == "stream")
+    {
+        runStream(l_requests, l_concurrency, l_rate, l_training, l_statistics);
+    }
+    else
+    {
+        QFile l_fileCorpus(l_pathCorpus);
+        QString l_corpusString;
+        if(l_fileCorpus.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            QTextStream in(&l_fileCorpus);
+            l_corpusString = in.readAll();
+        }
+        else
+        {
+            std::cerr << "-ERROR : can not read the corpus " << l_pathCorpus.toStdString() << ". " << std::endl;
+            return -1;
+        }
+
+        int l_action = l_mode == "test" ? 1 : (l_mode == "both" ? 2 : 0);
+        runJobs(l_action, l_requests, l_concurrency, l_rate, l_corpusString, l_training, l_statistics);
+    }
+
+    writeReport(l_reportPath, l_mode, l_concurrency, l_rate, l_statistics);
+
+    return l_statistics.m_errors + l_statistics.m_timeouts > 0 ? 1 : 0;
+}
@@ -0,0 +1,184 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+/**
+ * \file TrainingRegistry.cpp
+ * \brief defines TrainingRegistry
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#include "TrainingRegistry.h"
+
+/**
+ * @brief memory used by the matrices of a training
+ * @param [in] training
+ * @return size in bytes
+ */
+static qint64 trainingBytes(const ResidentTraining &training)
+{
+    return static_cast<qint64>(training.m_w.total() * training.m_w.elemSize() + training.m_wIn.total() * training.m_wIn.elemSize() +
+                               training.m_wOut.total() * training.m_wOut.elemSize());
+}
+
+/**
+ * @brief read a training directory
+ * @param [in] path
+ * @param [out] training
+ * @return false if the matrices can't be loaded
+ */
+static bool loadTrainingFiles(const QString &path, ResidentTraining &training)
+{
+    std::string l_path = path.toStdString();
+    load2DMatrixStd<float>(l_path + "/wOut.txt", training.m_wOut);
+    load2DMatrixStd<float>(l_path + "/wIn.txt",  training.m_wIn);
+    load2DMatrixStd<float>(l_path + "/w.txt",    training.m_w);
+
+    if(training.m_wOut.rows == 0 || training.m_wIn.rows == 0 || training.m_w.rows == 0)
+    {
+        std::cerr << "-ERROR : TrainingRegistry -> can not load the training " << l_path << ". " << std::endl;
+        return false;
+    }
+
+    QFile l_paramFile(path + "/param.txt");
+    if(l_paramFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        QTextStream l_stream(&l_paramFile);
+        training.m_parameters = l_stream.readAll().split(' ');
+    }
+
+    return true;
+}
+
+TrainingRegistry::TrainingRegistry(cint budgetMB) : m_budget(static_cast<qint64>(budgetMB) * 1024 * 1024), m_usedMemory(0), m_useCounter(0)
+{}
+
+bool TrainingRegistry::load(const QString &name, const QString &path)
+{
+    // the files are read without locking the registry
+        ResidentTraining l_training;
+        if(!loadTrainingFiles(path, l_training))
+        {
+            return false;
+        }
+
+    insert(name, l_training);
+
+    return true;
+}
+
+void TrainingRegistry::insert(const QString &name, const ResidentTraining &training)
+{
+    QMutexLocker l_locker(&m_lock);
+
+    if(m_entries.contains(name))
+    {
+        m_usedMemory -= m_entries[name].m_bytes;
+    }
+
+    Entry l_entry;
+    l_entry.m_training = training;
+    l_entry.m_bytes    = trainingBytes(training);
+    l_entry.m_lastUse  = ++m_useCounter;
+    m_entries[name]    = l_entry;
+    m_usedMemory      += l_entry.m_bytes;
+
+    evict(name);
+}
+
+bool TrainingRegistry::unload(const QString &name)
+{
+    QMutexLocker l_locker(&m_lock);
+
+    if(!m_entries.contains(name))
+    {
+        return false;
+    }
+
+    m_usedMemory -= m_entries[name].m_bytes;
+    m_entries.remove(name);
+
+    return true;
+}
+
+bool TrainingRegistry::acquire(const QString &nameOrPath, ResidentTraining &training)
+{
+    {
+        QMutexLocker l_locker(&m_lock);
+
+        QHash<QString, Entry>::iterator l_entry = m_entries.find(nameOrPath);
+        if(l_entry != m_entries.end())
+        {
+            l_entry->m_lastUse = ++m_useCounter;
+            training = l_entry->m_training;
+            return true;
+        }
+    }
+
+    // not resident : the key is used as a training directory
+    if(!loadTrainingFiles(nameOrPath, training))
+    {
+        return false;
+    }
+
+    insert(nameOrPath, training);
+
+    return true;
+}
+
+QStringList TrainingRegistry::names()
+{
+    QMutexLocker l_locker(&m_lock);
+
+    return m_entries.keys();
+}
+
+qint64 TrainingRegistry::usedMemory()
+{
+    QMutexLocker l_locker(&m_lock);
+
+    return m_usedMemory;
+}
+
+void TrainingRegistry::evict(const QString &keptName)
+{
+    while(m_usedMemory > m_budget && m_entries.size() > 1)
+    {
+        QHash<QString, Entry>::iterator l_oldest = m_entries.end();
+        for(QHash<QString, Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+        {
+            if(it.key() != keptName && (l_oldest == m_entries.end() || it->m_lastUse < l_oldest->m_lastUse))
+            {
+                l_oldest = it;
+            }
+        }
+
+        if(l_oldest == m_entries.end())
+        {
+            break;
+        }
+
+        std::cout << "Training " << l_oldest.key().toStdString() << " evicted from the registry. " << std::endl;
+        m_usedMemory -= l_oldest->m_bytes;
+        m_entries.erase(l_oldest);
+    }
+}
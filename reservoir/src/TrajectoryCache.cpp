@@ -0,0 +1,366 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+/**
+ * \file TrajectoryCache.cpp
+ * \brief defines TrajectoryCache
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#include "TrajectoryCache.h"
+#include "TaskScheduler.h"
+
+static const int g_nodesBlock = 4096;   /**< nodes computed between two checks of the cancellation */
+
+/**
+ * @brief FNV-1a hash of a node key
+ * @param [in] parent
+ * @param [in] input
+ * @param [in] dimInput
+ * @return
+ */
+static quint64 nodeHash(cint parent, const float *input, cint dimInput)
+{
+    quint64 l_hash = Q_UINT64_C(14695981039346656037);
+    const unsigned char *l_bytes = reinterpret_cast<const unsigned char*>(&parent);
+    for(size_t ii = 0; ii < sizeof(int); ++ii)
+    {
+        l_hash = (l_hash ^ l_bytes[ii]) * Q_UINT64_C(1099511628211);
+    }
+
+    l_bytes = reinterpret_cast<const unsigned char*>(input);
+    for(size_t ii = 0; ii < dimInput * sizeof(float); ++ii)
+    {
+        l_hash = (l_hash ^ l_bytes[ii]) * Q_UINT64_C(1099511628211);
+    }
+
+    return l_hash;
+}
+
+/**
+ * @brief sameMatrix
+ * @param [in] m1
+ * @param [in] m2
+ * @return true if the two matrices have the same size and values
+ */
+static bool sameMatrix(const cv::Mat &m1, const cv::Mat &m2)
+{
+    if(m1.data == m2.data && m1.size() == m2.size())
+    {
+        return true;
+    }
+
+    if(m1.size() != m2.size() || m1.type() != m2.type() || m1.empty())
+    {
+        return false;
+    }
+
+    return cv::norm(m1, m2, cv::NORM_INF) == 0.;
+}
+
+/**
+ * @brief Gather the columns [1;u] and xPrev of new nodes
+ */
+class GatherNodesTask : public SentenceTask
+{
+    public :
+
+        GatherNodesTask(const std::vector<int> &nodes, const std::vector<int> &parents, const std::vector<float> &inputs, const std::vector<float> &states,
+                        cv::Mat &u, cv::Mat &xPrev) : m_nodes(nodes), m_parents(parents), m_inputs(inputs), m_states(states), m_u(u), m_xPrev(xPrev)
+        {}
+
+        void run(cint begin, cint end)
+        {
+            int l_dimInput = m_u.rows - 1, l_nbNeurons = m_xPrev.rows;
+            for(int ii = begin; ii < end; ++ii)
+            {
+                int l_node   = m_nodes[ii];
+                int l_parent = m_parents[l_node];
+
+                m_u.at<float>(0, ii) = 1.f;
+                for(int jj = 0; jj < l_dimInput; ++jj)
+                {
+                    m_u.at<float>(jj + 1, ii) = m_inputs[l_node * l_dimInput + jj];
+                }
+                for(int jj = 0; jj < l_nbNeurons; ++jj)
+                {
+                    m_xPrev.at<float>(jj, ii) = l_parent < 0 ? 0.f : m_states[static_cast<size_t>(l_parent) * l_nbNeurons + jj];
+                }
+            }
+        }
+
+    private :
+
+        const std::vector<int> &m_nodes;
+        const std::vector<int> &m_parents;
+        const std::vector<float> &m_inputs;
+        const std::vector<float> &m_states;
+        cv::Mat &m_u;
+        cv::Mat &m_xPrev;
+};
+
+/**
+ * @brief Leaky update of the states of new nodes : x = (1 - a) * xPrev + a * tanh(xTemp)
+ */
+class UpdateNodesTask : public SentenceTask
+{
+    public :
+
+        UpdateNodesTask(const std::vector<int> &nodes, const cv::Mat &xPrev, const cv::Mat &xTemp, cfloat leakRate, std::vector<float> &states) :
+            m_nodes(nodes), m_xPrev(xPrev), m_xTemp(xTemp), m_leakRate(leakRate), m_states(states)
+        {}
+
+        void run(cint begin, cint end)
+        {
+            int l_nbNeurons = m_xPrev.rows;
+            float l_invLeakRate = 1.f - m_leakRate;
+            for(int ii = begin; ii < end; ++ii)
+            {
+                float *l_state = &m_states[static_cast<size_t>(m_nodes[ii]) * l_nbNeurons];
+                for(int jj = 0; jj < l_nbNeurons; ++jj)
+                {
+                    l_state[jj] = m_xPrev.at<float>(jj, ii) * l_invLeakRate + tanh(m_xTemp.at<float>(jj, ii)) * m_leakRate;
+                }
+            }
+        }
+
+    private :
+
+        const std::vector<int> &m_nodes;
+        const cv::Mat &m_xPrev;
+        const cv::Mat &m_xTemp;
+        float m_leakRate;
+        std::vector<float> &m_states;
+};
+
+/**
+ * @brief Fill the columns [1;u;x] of the sentences with the states of their paths in the trie
+ */
+class FillStatesTask : public SentenceTask
+{
+    public :
+
+        FillStatesTask(const std::vector<int> &paths, const std::vector<int> &lengths, const std::vector<float> &inputs, const std::vector<float> &states,
+                       cint dimInput, cint nbNeurons, cv::Mat &xTot) : m_paths(paths), m_lengths(lengths), m_inputs(inputs), m_states(states),
+            m_dimInput(dimInput), m_nbNeurons(nbNeurons), m_xTot(xTot)
+        {}
+
+        void run(cint begin, cint end)
+        {
+            int l_nbSteps = m_xTot.size[2];
+            for(int ii = begin; ii < end; ++ii)
+            {
+                for(int jj = 0; jj < m_lengths[ii]; ++jj)
+                {
+                    int l_node = m_paths[static_cast<size_t>(ii) * l_nbSteps + jj];
+                    const float *l_input = &m_inputs[static_cast<size_t>(l_node) * m_dimInput];
+                    const float *l_state = &m_states[static_cast<size_t>(l_node) * m_nbNeurons];
+
+                    m_xTot.at<float>(ii, 0, jj) = 1.f;
+                    for(int kk = 0; kk < m_dimInput; ++kk)
+                    {
+                        m_xTot.at<float>(ii, 1 + kk, jj) = l_input[kk];
+                    }
+                    for(int kk = 0; kk < m_nbNeurons; ++kk)
+                    {
+                        m_xTot.at<float>(ii, 1 + m_dimInput + kk, jj) = l_state[kk];
+                    }
+                }
+            }
+        }
+
+    private :
+
+        const std::vector<int> &m_paths;
+        const std::vector<int> &m_lengths;
+        const std::vector<float> &m_inputs;
+        const std::vector<float> &m_states;
+        int m_dimInput;
+        int m_nbNeurons;
+        cv::Mat &m_xTot;
+};
+
+TrajectoryCache::TrajectoryCache(cint budgetMB) : m_budget(static_cast<qint64>(budgetMB) * 1024 * 1024), m_leakRate(0.f), m_dimInput(0), m_nbNeurons(0),
+    m_reusedSteps(0), m_computedSteps(0)
+{}
+
+void TrajectoryCache::clear()
+{
+    m_parents.clear();
+    m_inputs.clear();
+    m_states.clear();
+    m_children.clear();
+}
+
+void TrajectoryCache::bind(const cv::Mat &w, const cv::Mat &wIn, cfloat leakRate)
+{
+    if(!sameMatrix(w, m_w) || !sameMatrix(wIn, m_wIn) || leakRate != m_leakRate)
+    {
+        clear();
+    }
+
+    m_w         = w;
+    m_wIn       = wIn;
+    m_leakRate  = leakRate;
+    m_nbNeurons = w.rows;
+}
+
+int TrajectoryCache::child(cint parent, const float *input, bool &created)
+{
+    quint64 l_hash = nodeHash(parent, input, m_dimInput);
+
+    // the inputs are compared for avoiding the collisions
+        QMultiHash<quint64, int>::const_iterator it = m_children.constFind(l_hash);
+        for(; it != m_children.constEnd() && it.key() == l_hash; ++it)
+        {
+            int l_node = it.value();
+            if(m_parents[l_node] == parent && memcmp(&m_inputs[l_node * m_dimInput], input, m_dimInput * sizeof(float)) == 0)
+            {
+                created = false;
+                return l_node;
+            }
+        }
+
+    int l_node = static_cast<int>(m_parents.size());
+    m_parents.push_back(parent);
+    m_inputs.insert(m_inputs.end(), input, input + m_dimInput);
+    m_children.insert(l_hash, l_node);
+
+    created = true;
+    return l_node;
+}
+
+bool TrajectoryCache::computeNodes(const std::vector<int> &nodes, const CancellationToken *cancel, ProgressCounter *progress)
+{
+    int l_nbNodes = static_cast<int>(nodes.size());
+
+    for(int ii = 0; ii < l_nbNodes; ii += g_nodesBlock)
+    {
+        if(cancel && cancel->isCancelled())
+        {
+            return false;
+        }
+
+        std::vector<int> l_block(nodes.begin() + ii, nodes.begin() + std::min(l_nbNodes, ii + g_nodesBlock));
+        int l_nbBlockNodes = static_cast<int>(l_block.size());
+
+        // columns [1;u] and xPrev of the nodes
+            cv::Mat l_u(m_dimInput + 1, l_nbBlockNodes, CV_32FC1), l_xPrev(m_nbNeurons, l_nbBlockNodes, CV_32FC1);
+            GatherNodesTask l_gather(l_block, m_parents, m_inputs, m_states, l_u, l_xPrev);
+            TaskScheduler::instance()->parallelFor(l_gather, l_nbBlockNodes);
+
+        // x = (1 - a) * xPrev + a * tanh(W IN * [1;u] + W * xPrev)
+            cv::Mat l_xTemp = (m_wIn * l_u) + (m_w * l_xPrev);
+
+            UpdateNodesTask l_update(l_block, l_xPrev, l_xTemp, m_leakRate, m_states);
+            TaskScheduler::instance()->parallelFor(l_update, l_nbBlockNodes);
+
+        if(progress)
+        {
+            progress->advance(l_nbBlockNodes);
+        }
+    }
+
+    return true;
+}
+
+void TrajectoryCache::computeStates(const cv::Mat &meaningInput, cv::Mat &xTot, const std::vector<int> *lengths, const CancellationToken *cancel,
+                                    ProgressCounter *progress)
+{
+    int l_nbSentences = meaningInput.size[0], l_nbSteps = meaningInput.size[1], l_dimInput = meaningInput.size[2];
+
+    if(l_dimInput != m_dimInput)
+    {
+        clear();
+        m_dimInput = l_dimInput;
+    }
+
+    // insert the sentences in the trie, the new nodes are sorted by depth
+        std::vector<int> l_paths(static_cast<size_t>(l_nbSentences) * l_nbSteps);
+        std::vector<std::vector<int> > l_newNodes(l_nbSteps);
+        std::vector<int> l_lengths(lengths ? *lengths : std::vector<int>(l_nbSentences, l_nbSteps));
+        m_reusedSteps = m_computedSteps = 0;
+
+        for(int ii = 0; ii < l_nbSentences; ++ii)
+        {
+            int l_node = -1;
+            for(int jj = 0; jj < l_lengths[ii]; ++jj)
+            {
+                const float *l_input = reinterpret_cast<const float*>(meaningInput.data + meaningInput.step[0] * ii + meaningInput.step[1] * jj);
+
+                bool l_created;
+                l_node = child(l_node, l_input, l_created);
+                l_paths[static_cast<size_t>(ii) * l_nbSteps + jj] = l_node;
+
+                if(l_created)
+                {
+                    l_newNodes[jj].push_back(l_node);
+                    ++m_computedSteps;
+                }
+                else
+                {
+                    ++m_reusedSteps;
+                }
+            }
+        }
+
+        if(progress)
+        {
+            progress->advance(m_reusedSteps);
+        }
+
+    // compute the new states depth by depth, a node only depends on its parent
+        int l_sizeTot[3] = {l_nbSentences, 1 + l_dimInput + m_nbNeurons, l_nbSteps};
+        xTot = cv::Mat(3, l_sizeTot, CV_32FC1, cv::Scalar(0.f));
+
+        m_states.resize(m_parents.size() * static_cast<size_t>(m_nbNeurons));
+        for(int jj = 0; jj < l_nbSteps; ++jj)
+        {
+            if(!computeNodes(l_newNodes[jj], cancel, progress))
+            {
+                // the nodes not computed yet can't be kept
+                clear();
+                return;
+            }
+        }
+
+    // fill x tot with the states of the paths, the sentences are balanced on their lengths
+        FillStatesTask l_fill(l_paths, l_lengths, m_inputs, m_states, l_dimInput, m_nbNeurons, xTot);
+        TaskScheduler::instance()->parallelFor(l_fill, l_nbSentences, &l_lengths);
+
+    // the cache is dropped if it exceeds the budget, the next call starts from an empty trie
+        if(static_cast<qint64>((m_states.size() + m_inputs.size()) * sizeof(float)) > m_budget)
+        {
+            clear();
+        }
+}
+
+int TrajectoryCache::reusedSteps() const
+{
+    return m_reusedSteps;
+}
+
+int TrajectoryCache::computedSteps() const
+{
+    return m_computedSteps;
+}
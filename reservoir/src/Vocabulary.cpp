@@ -0,0 +1,104 @@
+/*******************************************************************************
+**                                                                            **
+**  Language Learning - Reservoir Computing - GPU                             **
+**  An interface for language learning with neuron computing using GPU        **
+**  acceleration.                                                             **
+**                                                                            **
+**  This program is free software: you can redistribute it and/or modify      **
+**  it under the terms of the GNU Lesser General Public License as published  **
+**  by the Free Software Foundation, either version 3 of the License, or      **
+**  (at your option) any later version.                                       **
+**                                                                            **
+**  This program is distributed in the hope that it will be useful,           **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of            **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             **
+**  GNU Lesser General Public License for more details.                       **
+**                                                                            **
+**  You should have received a copy of the GNU Lesser General Public License  **
+**  along with Foobar.  If not, see <http://www.gnu.org/licenses/>.           **
+**                                                                            **
+********************************************************************************/
+
+
+/**
+ * \file Vocabulary.cpp
+ * \brief defines Vocabulary
+ * \author Florian Lance
+ * \date 19/10/26
+ */
+
+#include "Vocabulary.h"
+
+void Vocabulary::clear()
+{
+    m_ids.clear();
+    m_words.clear();
+}
+
+int Vocabulary::intern(const std::string &word)
+{
+    QByteArray l_key(word.data(), static_cast<int>(word.size()));
+    QHash<QByteArray, int>::const_iterator it = m_ids.constFind(l_key);
+    if(it != m_ids.constEnd())
+    {
+        return it.value();
+    }
+
+    int l_id = static_cast<int>(m_words.size());
+    m_ids.insert(l_key, l_id);
+    m_words.push_back(word);
+
+    return l_id;
+}
+
+int Vocabulary::id(const std::string &word) const
+{
+    return m_ids.value(QByteArray::fromRawData(word.data(), static_cast<int>(word.size())), -1);
+}
+
+const std::string &Vocabulary::word(cint id) const
+{
+    return m_words[id];
+}
+
+int Vocabulary::size() const
+{
+    return static_cast<int>(m_words.size());
+}
+
+void Vocabulary::tokenize(const Sentences &sentences, TokenizedSentences &tokens)
+{
+    tokens.clear();
+
+    size_t l_nbWords = 0;
+    for(size_t ii = 0; ii < sentences.size(); ++ii)
+    {
+        l_nbWords += sentences[ii].size();
+    }
+    tokens.m_tokens.reserve(l_nbWords);
+    tokens.m_offsets.reserve(sentences.size() + 1);
+
+    for(size_t ii = 0; ii < sentences.size(); ++ii)
+    {
+        for(size_t jj = 0; jj < sentences[ii].size(); ++jj)
+        {
+            tokens.m_tokens.push_back(intern(sentences[ii][jj]));
+        }
+        tokens.m_offsets.push_back(static_cast<int>(tokens.m_tokens.size()));
+    }
+}
+
+void Vocabulary::sentences(const TokenizedSentences &tokens, Sentences &sentences) const
+{
+    sentences.assign(tokens.nbSentences(), Sentence());
+
+    for(int ii = 0; ii < tokens.nbSentences(); ++ii)
+    {
+        const int *l_words = tokens.words(ii);
+        sentences[ii].reserve(tokens.length(ii));
+        for(int jj = 0; jj < tokens.length(ii); ++jj)
+        {
+            sentences[ii].push_back(m_words[l_words[jj]]);
+        }
+    }
+}
@@ -22,6 +22,7 @@
 
 
 #include <iostream>
+#include <algorithm>
 #include "YarpInterface.h"
 
 
@@ -30,6 +31,99 @@
 
 using namespace yarp::os;
 
+static QMutex g_cudaJobsLock; /**< the jobs using CUDA share the same device, they are computed one at a time */
+static const int g_maxEarlyControls = 64; /**< maximum number of controls waiting for the parameters of a job id */
+static const int g_maxRequestIds = 256;   /**< maximum number of job ids with parameters or early controls kept */
+
+/**
+ * @brief matchesJob
+ * @param [in] jobId
+ * @param [in] id : job id or grid search id
+ * @return true if the job has this id or is a point of the grid search with this id
+ */
+static bool matchesJob(const QString &jobId, const QString &id)
+{
+    return jobId == id || jobId.startsWith(id + "/");
+}
+
+/**
+ * @brief sentencesToString : one line per sentence, words separated by a space
+ * @param [in] sentences
+ * @return
+ */
+static std::string sentencesToString(const Sentences &sentences)
+{
+    size_t l_size = 0;
+    for(size_t ii = 0; ii < sentences.size(); ++ii)
+    {
+        for(size_t jj = 0; jj < sentences[ii].size(); ++jj)
+        {
+            l_size += sentences[ii][jj].size() + 1;
+        }
+        ++l_size;
+    }
+
+    std::string l_text;
+    l_text.reserve(l_size);
+    for(size_t ii = 0; ii < sentences.size(); ++ii)
+    {
+        for(size_t jj = 0; jj < sentences[ii].size(); ++jj)
+        {
+            l_text += sentences[ii][jj];
+            l_text += ' ';
+        }
+        l_text += '\n';
+    }
+
+    return l_text;
+}
+
+/**
+ * @brief scoresToString : scores separated by a space
+ * @param [in] scores
+ * @return
+ */
+static std::string scoresToString(const std::vector<double> &scores)
+{
+    QStringList l_scores;
+    l_scores.reserve(static_cast<int>(scores.size()));
+    for(size_t ii = 0; ii < scores.size(); ++ii)
+    {
+        l_scores << QString::number(scores[ii]);
+    }
+
+    return (l_scores.join(" ") + (scores.size() > 0 ? " " : "")).toStdString();
+}
+
+/**
+ * @brief encodeSentences : [sentences number, length of each sentence, word ids...]
+ * @param [in] sentences : ids of the model vocabulary
+ * @param [out] encoded
+ */
+static void encodeSentences(const TokenizedSentences &sentences, std::vector<qint32> &encoded)
+{
+    encoded.clear();
+    encoded.reserve(1 + sentences.nbSentences() + sentences.m_tokens.size());
+    encoded.push_back(static_cast<qint32>(sentences.nbSentences()));
+    for(int ii = 0; ii < sentences.nbSentences(); ++ii)
+    {
+        encoded.push_back(static_cast<qint32>(sentences.length(ii)));
+    }
+    encoded.insert(encoded.end(), sentences.m_tokens.begin(), sentences.m_tokens.end());
+}
+
+/**
+ * @brief addBlob : add the raw values of an array (native byte order) to a bottle
+ * @param [in,out] bottle
+ * @param [in] values
+ */
+template<typename T>
+static void addBlob(yarp::os::Bottle &bottle, const std::vector<T> &values)
+{
+    static T l_empty;
+    bottle.add(yarp::os::Value(values.size() > 0 ? (void*)&values[0] : (void*)&l_empty, static_cast<int>(values.size() * sizeof(T))));
+}
+
 
 int main(int argc, char* argv[])
 {
@@ -42,145 +136,308 @@ int main(int argc, char* argv[])
     }
 
     QCoreApplication l_oApp(argc, argv);
-    ReservoirInterface l_interface(&l_oApp);
+
+    // reservoir-yarp [workers number] [queue capacity] [registry budget MB] [stream batching window ms] [stream max batch size]
+    int l_workersNumber = 1, l_queueCapacity = 16, l_registryBudget = 1024, l_batchWindow = 0, l_maxBatchSize = 32;
+    if(argc > 1)
+    {
+        l_workersNumber = std::max(1, QString(argv[1]).toInt());
+    }
+    if(argc > 2)
+    {
+        l_queueCapacity = std::max(1, QString(argv[2]).toInt());
+    }
+    if(argc > 3)
+    {
+        l_registryBudget = std::max(1, QString(argv[3]).toInt());
+    }
+    if(argc > 4)
+    {
+        l_batchWindow = std::max(0, QString(argv[4]).toInt());
+    }
+    if(argc > 5)
+    {
+        l_maxBatchSize = std::max(1, QString(argv[5]).toInt());
+    }
+
+    ReservoirInterface l_interface(&l_oApp, l_workersNumber, l_queueCapacity, l_registryBudget, l_batchWindow, l_maxBatchSize);
     return l_oApp.exec();
 }
 
 
+ReservoirJobQueue::ReservoirJobQueue(cint capacity) : m_capacity(capacity), m_closed(false)
+{}
 
-ReservoirInterface::ReservoirInterface(QCoreApplication *parent)
+bool ReservoirJobQueue::push(const ReservoirJob &job)
 {
-    srand(1);
-    culaWarmup(1);
+    QMutexLocker l_locker(&m_lock);
 
-    // set absolute path
-        m_absolutePath = QDir::currentPath() + "/";
+    if(m_closed || m_jobs.size() >= m_capacity)
+    {
+        return false;
+    }
 
-    // create folders
-        QVector<QDir> l_dirs;
-        l_dirs.push_back(QDir(m_absolutePath     + "../data/input/Corpus"));
-        l_dirs.push_back(QDir(m_absolutePath     + "../data/input/Settings"));
-        l_dirs.push_back(QDir(m_absolutePath     + "../data/input/Matrices/W"));
-        l_dirs.push_back(QDir(m_absolutePath     + "../data/input/Matrices/WIn"));
-        l_dirs.push_back(QDir(m_absolutePath     + "../data/input/Settings"));
-        l_dirs.push_back(QDir(m_absolutePath     + "../data/Results/raw"));
-        l_dirs.push_back(QDir(m_absolutePath     + "../data/training"));
-        l_dirs.push_back(QDir(m_absolutePath     + "../data/replay"));
-        l_dirs.push_back(QDir(m_absolutePath     + "../data/images"));
-        l_dirs.push_back(QDir(m_absolutePath     + "../log"));
+    m_jobs.enqueue(job);
+    m_jobAvailable.wakeOne();
 
-        for(int ii = 0; ii < l_dirs.size(); ++ii)
+    return true;
+}
+
+bool ReservoirJobQueue::pushAll(const QVector<ReservoirJob> &jobs)
+{
+    QMutexLocker l_locker(&m_lock);
+
+    if(m_closed || m_jobs.size() >= m_capacity)
+    {
+        return false;
+    }
+
+    for(int ii = 0; ii < jobs.size(); ++ii)
+    {
+        m_jobs.enqueue(jobs[ii]);
+    }
+    m_jobAvailable.wakeAll();
+
+    return true;
+}
+
+int ReservoirJobQueue::remove(const QString &id)
+{
+    QMutexLocker l_locker(&m_lock);
+
+    int l_removed = 0;
+    for(int ii = m_jobs.size() - 1; ii >= 0; --ii)
+    {
+        if(matchesJob(m_jobs[ii].m_id, id))
         {
-            if(!l_dirs[ii].exists())
-            {
-                l_dirs[ii].mkpath(".");
-            }
+            m_jobs.removeAt(ii);
+            ++l_removed;
         }
+    }
 
-    // init worker
-    m_yarpWorker = new YarpInterfaceWorker(m_absolutePath);
+    return l_removed;
+}
 
-    // init connections
-    QObject::connect(this, SIGNAL(start()), m_yarpWorker, SLOT(doLoop()));
-    QObject::connect(this, SIGNAL(stop()), m_yarpWorker, SLOT(stopLoop()));
-    QObject::connect(m_yarpWorker, SIGNAL(sendDataToReservoirSignal(int, ModelParameters,Sentence,Sentence, QString, QString, QString, QString, QString, QString)),
-                     this, SLOT(startReservoir(int, ModelParameters,Sentence,Sentence,QString, QString, QString, QString, QString, QString)));
-    QObject::connect(this, SIGNAL(endReservoirComputing(QVector<std::vector<double> >, QVector<std::vector<double> >, Sentences,Sentences,Sentences)),
-                     m_yarpWorker, SLOT(updateResultsFromReservoir(QVector<std::vector<double> >,QVector<std::vector<double> >,Sentences,Sentences,Sentences)));
+bool ReservoirJobQueue::pop(ReservoirJob &job)
+{
+    QMutexLocker l_locker(&m_lock);
 
-    // init thread
-    m_yarpWorker->moveToThread(&m_yarpWorkerThread);
-    m_yarpWorkerThread.start();
+    while(m_jobs.isEmpty() && !m_closed)
+    {
+        m_jobAvailable.wait(&m_lock);
+    }
 
-    // start loop
-    emit start();
+    if(m_jobs.isEmpty())
+    {
+        return false;
+    }
+
+    job = m_jobs.dequeue();
+
+    return true;
 }
 
-ReservoirInterface::~ReservoirInterface()
+void ReservoirJobQueue::close()
 {
-    emit stop();
+    QMutexLocker l_locker(&m_lock);
+
+    m_closed = true;
+    m_jobs.clear();
+    m_jobAvailable.wakeAll();
+}
+
+int ReservoirJobQueue::size()
+{
+    QMutexLocker l_locker(&m_lock);
+
+    return m_jobs.size();
+}
+
+
+ReservoirJobWorker::ReservoirJobWorker(ReservoirJobQueue *queue, TrainingRegistry *registry, YarpInterfaceWorker *yarpWorker, const QString &absolutePath) :
+    m_queue(queue), m_registry(registry), m_yarpWorker(yarpWorker), m_absolutePath(absolutePath), m_currentModel(NULL), m_currentCancelled(false)
+{}
+
+void ReservoirJobWorker::run()
+{
+    // CULA must be initialized in each thread using it
+    LinearAlgebraBackend::initThread();
 
-    QTime l_dieTime = QTime::currentTime().addMSecs(200);
-    while( QTime::currentTime() < l_dieTime)
+    // the model is created in the worker thread
+    Model l_model;
+
+    ReservoirJob l_job;
+    while(m_queue->pop(l_job))
     {
-        QCoreApplication::processEvents(QEventLoop::AllEvents, 100);
+        // the job can be cancelled from now
+            m_currentLock.lock();
+                m_currentJobId     = l_job.m_id;
+                m_currentModel     = &l_model;
+                m_currentCancelled = false;
+                l_model.reservoir()->resetStopLoop();
+            m_currentLock.unlock();
+
+        processJob(l_model, l_job);
+
+        m_currentLock.lock();
+            m_currentModel = NULL;
+        m_currentLock.unlock();
     }
 
-    m_yarpWorkerThread.quit();
-    m_yarpWorkerThread.wait();
-    delete m_yarpWorker;
+    LinearAlgebraBackend::releaseThread();
 }
 
-void ReservoirInterface::startReservoir(int actionToDo, ModelParameters parameters, Sentence CCW, Sentence structure,
-                                        QString pathTrainingFileToBeSaved, QString pathWMatriceFileToBeSaved, QString pathWInMatriceFileToBeSaved,
-                                        QString pathTrainingFileToBeLoaded, QString pathWMatriceFileToBeLoaded, QString pathWInMatriceFileToBeLoaded)
+bool ReservoirJobWorker::cancel(const QString &id)
 {
+    QMutexLocker l_locker(&m_currentLock);
+
+    if(!m_currentModel || !matchesJob(m_currentJobId, id))
+    {
+        return false;
+    }
+
+    m_currentCancelled = true;
+    m_currentModel->reservoir()->stopLoop();
+
+    return true;
+}
+
+/**
+ * @brief removeJobDirectory : remove the corpus and the stimulus files of a job, and its directory
+ * @param [in] dir
+ */
+static void removeJobDirectory(QDir &dir)
+{
+    QStringList l_files = dir.entryList(QDir::Files);
+    for(int ii = 0; ii < l_files.size(); ++ii)
+    {
+        dir.remove(l_files[ii]);
+    }
+    dir.rmdir(dir.absolutePath());
+}
+
+bool ReservoirJobWorker::isCancelled()
+{
+    QMutexLocker l_locker(&m_currentLock);
+    return m_currentCancelled;
+}
+
+void ReservoirJobWorker::processJob(Model &model, const ReservoirJob &job)
+{
+    // each job has its own directory for the corpus and the stimulus files
+        QString l_jobDirectory = "../data/input/jobs/" + QString::number(job.m_number) + "/";
+        QDir l_dir(m_absolutePath + l_jobDirectory);
+        if(!l_dir.exists())
+        {
+            l_dir.mkpath(".");
+        }
+
+        ModelParameters l_parameters = job.m_parameters;
+
+        QFile l_fileCorpus(m_absolutePath + l_jobDirectory + "corpus.txt");
+        if(l_fileCorpus.open(QIODevice::WriteOnly | QIODevice::Text))
+        {
+            QTextStream in(&l_fileCorpus);
+            in << job.m_corpus;
+            l_parameters.m_corpusFilePath = (m_absolutePath + l_jobDirectory + "corpus.txt").toStdString();
+        }
+        else
+        {
+            m_yarpWorker->sendError(job.m_id, "Can not write the corpus file.");
+            removeJobDirectory(l_dir);
+            return;
+        }
+        l_fileCorpus.close();
+
+    // the training used for the tests comes from the registry
+        bool l_useRegistryTraining = l_parameters.m_useLoadedTraining && job.m_pathTrainingToBeLoaded.size() > 0;
+        l_parameters.m_useLoadedTraining = false;
+
+    QMutexLocker l_cudaLocker((l_parameters.m_useCudaInv || l_parameters.m_useCudaMult) ? &g_cudaJobsLock : NULL);
+
     // set CCW / structure
-        m_model.setCCWAndStructure(CCW,structure);
+        model.setCCWAndStructure(job.m_CCW, job.m_structure);
+        model.setStimulusDirectory(l_jobDirectory.toStdString());
     // set parameters
-        m_model.resetModelParameters(parameters,true);
+        model.resetModelParameters(l_parameters,true);
+        model.reservoir()->setCpuBackend(job.m_cpuBackend);
+        model.setSketchRank(job.m_sketchRank);
+        model.setIterativeSolver(job.m_solverIterations > 0, job.m_solverIterations);
+        model.setStreamingTraining(job.m_streamChunkSize, job.m_streamEpochs, static_cast<float>(job.m_streamLearningRate));
 
-    QVector<std::vector<double> > l_resultsTrain, l_resultsTests;        
+    QVector<std::vector<double> > l_resultsTrain, l_resultsTests;
 
-    if(actionToDo == 0 || actionToDo == 2)
+    if(job.m_actionToDo == 0 || job.m_actionToDo == 2)
     {
         // load W / WIn
-            if(pathWMatriceFileToBeLoaded.size() > 0 && parameters.m_useLoadedW)
+            if(job.m_pathWToBeLoaded.size() > 0 && l_parameters.m_useLoadedW)
             {
-                QFile l_file(pathWMatriceFileToBeLoaded);
+                QFile l_file(job.m_pathWToBeLoaded);
                 if(l_file.exists())
                 {
-                    m_model.loadW(pathWMatriceFileToBeLoaded.toStdString());
+                    model.loadW(job.m_pathWToBeLoaded.toStdString());
                 }
             }
-            if(pathWInMatriceFileToBeLoaded.size() > 0 && parameters.m_useLoadedWIn)
+            if(job.m_pathWInToBeLoaded.size() > 0 && l_parameters.m_useLoadedWIn)
             {
-                QFile l_file(pathWInMatriceFileToBeLoaded);
+                QFile l_file(job.m_pathWInToBeLoaded);
                 if(l_file.exists())
                 {
-                    m_model.loadWIn(pathWInMatriceFileToBeLoaded.toStdString());
+                    model.loadWIn(job.m_pathWInToBeLoaded.toStdString());
                 }
             }
 
         // start training
-            m_model.launchTraining();
+            model.launchTraining();
 
         // save training file
-            if(pathTrainingFileToBeSaved.size() > 0)
+            if(job.m_pathTrainingToBeSaved.size() > 0)
             {
-                QDir l_dir(m_absolutePath + pathTrainingFileToBeSaved);
-                if(!l_dir.exists())
+                QDir l_trainingDir(m_absolutePath + job.m_pathTrainingToBeSaved);
+                if(!l_trainingDir.exists())
                 {
-                    l_dir.mkpath(".");
+                    l_trainingDir.mkpath(".");
+                }
+                bool l_saved = model.saveTraining(job.m_pathTrainingToBeSaved.toStdString());
+
+                // a resident training of this directory is outdated
+                    m_registry->unload(job.m_pathTrainingToBeSaved);
+
+                if(!l_saved)
+                {
+                    // the error is the only reply of the job
+                        m_yarpWorker->sendError(job.m_id, "Can not save the training " + job.m_pathTrainingToBeSaved + ".");
+                        l_cudaLocker.unlock();
+                        removeJobDirectory(l_dir);
+                        return;
                 }
-                m_model.saveTraining(pathTrainingFileToBeSaved.toStdString());
             }
         // save W Matrice file
-            if(pathWMatriceFileToBeSaved.size() > 0)
+            if(job.m_pathWToBeSaved.size() > 0)
             {
-                QDir l_dir(m_absolutePath + pathWMatriceFileToBeSaved);
+                QDir l_dir(m_absolutePath + job.m_pathWToBeSaved);
                 if(!l_dir.exists())
                 {
                     l_dir.mkpath(".");
                 }
-                m_model.saveW(pathWMatriceFileToBeSaved.toStdString());
+                model.saveW(job.m_pathWToBeSaved.toStdString());
             }
         // save WIn Matrice file
-            if(pathWInMatriceFileToBeSaved.size() > 0)
+            if(job.m_pathWInToBeSaved.size() > 0)
             {
-                QDir l_dir(m_absolutePath + pathWInMatriceFileToBeSaved);
+                QDir l_dir(m_absolutePath + job.m_pathWInToBeSaved);
                 if(!l_dir.exists())
                 {
                     l_dir.mkpath(".");
                 }
-                m_model.saveWIn(pathWInMatriceFileToBeSaved.toStdString());
+                model.saveWIn(job.m_pathWInToBeSaved.toStdString());
             }
 
         // retrieve train results
             std::vector<double> l_diffSizeOCW, l_absoluteCCW, l_continuousCCW, l_absoluteAll, l_continuousAll;
             double l_meanDiffSizeOCW, l_meanContinuousCCW, l_meanAbsoluteCCW, l_meanContinuousAll, l_meanAbsoluteAll;
 
-            m_model.computeResultsData(true, l_diffSizeOCW,
+            model.computeResultsData(true, l_diffSizeOCW,
                                         l_absoluteCCW, l_continuousCCW,
                                         l_absoluteAll, l_continuousAll,
                                         l_meanDiffSizeOCW,
@@ -192,20 +449,28 @@ void ReservoirInterface::startReservoir(int actionToDo, ModelParameters paramete
             l_resultsTrain << l_continuousAll;
     }
 
-    if(actionToDo == 1 || actionToDo == 2)
+    if(job.m_actionToDo == 1 || job.m_actionToDo == 2)
     {
-        // load training
-            if(pathTrainingFileToBeLoaded.size() > 0 && parameters.m_useLoadedTraining)
+        // retrieve training (no file reading if it's already resident)
+            if(l_useRegistryTraining)
             {
-                QFile l_file(pathTrainingFileToBeLoaded);
-                if(l_file.exists())
+                ResidentTraining l_training;
+                if(m_registry->acquire(job.m_pathTrainingToBeLoaded, l_training))
                 {
-                    m_model.loadTraining(pathTrainingFileToBeLoaded.toStdString());
+                    model.setTraining(l_training.m_w, l_training.m_wIn, l_training.m_wOut);
+                }
+                else
+                {
+                    // the error is the only reply of the job
+                        m_yarpWorker->sendError(job.m_id, "Can not load the training " + job.m_pathTrainingToBeLoaded + ".");
+                        l_cudaLocker.unlock();
+                        removeJobDirectory(l_dir);
+                        return;
                 }
             }
 
         // start the tests
-        bool l_error = !m_model.launchTests();
+        bool l_error = !model.launchTests();
 
         std::vector<double> l_diffSizeOCW, l_absoluteCCW, l_continuousCCW, l_absoluteAll, l_continuousAll;
         double l_meanDiffSizeOCW, l_meanContinuousCCW, l_meanAbsoluteCCW, l_meanContinuousAll, l_meanAbsoluteAll;
@@ -213,7 +478,7 @@ void ReservoirInterface::startReservoir(int actionToDo, ModelParameters paramete
         // retrieve tests results
             if(!l_error)
             {
-                m_model.computeResultsData(false, l_diffSizeOCW,
+                model.computeResultsData(false, l_diffSizeOCW,
                                             l_absoluteCCW, l_continuousCCW,
                                             l_absoluteAll, l_continuousAll,
                                             l_meanDiffSizeOCW,
@@ -225,209 +490,903 @@ void ReservoirInterface::startReservoir(int actionToDo, ModelParameters paramete
             l_resultsTests << l_continuousAll;
     }
 
-    Sentences l_trainSentences, l_trainResults, l_testResults;
-    m_model.sentences(l_trainSentences, l_trainResults, l_testResults);
-    emit endReservoirComputing(l_resultsTrain, l_resultsTests,l_trainSentences, l_trainResults, l_testResults);
+    l_cudaLocker.unlock();
+
+    if(isCancelled())
+    {
+        m_yarpWorker->sendError(job.m_id, "Job cancelled.");
+    }
+    else
+    {
+        m_yarpWorker->sendResults(job.m_id, job.m_binaryResults, l_resultsTrain, l_resultsTests, model);
+    }
+
+    removeJobDirectory(l_dir);
+}
+
+
+ReservoirInterface::ReservoirInterface(QCoreApplication *parent, cint workersNumber, cint queueCapacity, cint registryBudgetMB, cint batchWindowMs, cint maxBatchSize) : m_jobQueue(queueCapacity), m_registry(registryBudgetMB)
+{
+    srand(1);
+
+    // set absolute path
+        m_absolutePath = QDir::currentPath() + "/";
+
+    // create folders
+        QVector<QDir> l_dirs;
+        l_dirs.push_back(QDir(m_absolutePath     + "../data/input/Corpus"));
+        l_dirs.push_back(QDir(m_absolutePath     + "../data/input/Settings"));
+        l_dirs.push_back(QDir(m_absolutePath     + "../data/input/Matrices/W"));
+        l_dirs.push_back(QDir(m_absolutePath     + "../data/input/Matrices/WIn"));
+        l_dirs.push_back(QDir(m_absolutePath     + "../data/input/Settings"));
+        l_dirs.push_back(QDir(m_absolutePath     + "../data/input/jobs"));
+        l_dirs.push_back(QDir(m_absolutePath     + "../data/Results/raw"));
+        l_dirs.push_back(QDir(m_absolutePath     + "../data/training"));
+        l_dirs.push_back(QDir(m_absolutePath     + "../data/replay"));
+        l_dirs.push_back(QDir(m_absolutePath     + "../data/images"));
+        l_dirs.push_back(QDir(m_absolutePath     + "../log"));
+
+        for(int ii = 0; ii < l_dirs.size(); ++ii)
+        {
+            if(!l_dirs[ii].exists())
+            {
+                l_dirs[ii].mkpath(".");
+            }
+        }
+
+    // init worker
+    m_yarpWorker = new YarpInterfaceWorker(m_absolutePath, &m_jobQueue, &m_registry, batchWindowMs, maxBatchSize);
+
+    // init connections
+    QObject::connect(this, SIGNAL(start()), m_yarpWorker, SLOT(startListening()));
+    QObject::connect(this, SIGNAL(stop()), m_yarpWorker, SLOT(stopListening()), Qt::BlockingQueuedConnection);
+
+    // init thread
+    m_yarpWorker->moveToThread(&m_yarpWorkerThread);
+    m_yarpWorkerThread.start();
+
+    // init jobs workers
+    for(int ii = 0; ii < workersNumber; ++ii)
+    {
+        m_jobWorkers.push_back(new ReservoirJobWorker(&m_jobQueue, &m_registry, m_yarpWorker, m_absolutePath));
+        m_jobWorkers.back()->start();
+    }
+    m_yarpWorker->setJobWorkers(m_jobWorkers);
+
+    std::cout << "Reservoir yarp module started with " << workersNumber << " job worker(s), queue capacity : " << queueCapacity << std::endl;
+
+    // start listening the ports
+    emit start();
 }
 
+ReservoirInterface::~ReservoirInterface()
+{
+    // stop the callbacks and wake up the yarp reading threads
+    emit stop();
+
+    // stop the jobs workers, the running jobs are finished
+    m_jobQueue.close();
+    for(int ii = 0; ii < m_jobWorkers.size(); ++ii)
+    {
+        m_jobWorkers[ii]->wait();
+        delete m_jobWorkers[ii];
+    }
 
+    m_yarpWorkerThread.quit();
+    m_yarpWorkerThread.wait();
+    delete m_yarpWorker;
+}
 
 
+ReservoirStreamBatcher::ReservoirStreamBatcher(TrainingRegistry *registry, yarp::os::BufferedPort<yarp::os::Bottle> *outputPort, cint windowMs, cint maxBatchSize) :
+    m_registry(registry), m_outputPort(outputPort), m_windowMs(windowMs), m_maxBatchSize(std::max(1, maxBatchSize)), m_closed(false)
+{}
 
-YarpInterfaceWorker::YarpInterfaceWorker(QString absolutePath) : m_doLoop(true), m_reservoirIsRunning(false), m_isParameters(false),m_absolutePath(absolutePath)
+ReservoirStreamBatcher::~ReservoirStreamBatcher()
 {
-    qRegisterMetaType<ModelParameters>("ModelParameters");
-    qRegisterMetaType<Sentence>("Sentence");
-    qRegisterMetaType<Sentences>("Sentences");
-    qRegisterMetaType<QVector<std::vector<double> >>("QVector<std::vector<double> >");
+    close();
+    wait();
+    qDeleteAll(m_sessions);
+}
 
-     // init yarp ports
-    m_parametersPort.open("/reservoir/parameters/in");
-    m_controlPort.open("/reservoir/control/in");
-    m_resultsPort.open("/reservoir/results/out");
+void ReservoirStreamBatcher::push(const StreamRequest &request)
+{
+    QMutexLocker l_locker(&m_lock);
+
+    if(m_closed)
+    {
+        return;
+    }
+
+    m_pending.push_back(request);
+    m_requestAvailable.wakeOne();
 }
 
-YarpInterfaceWorker::~YarpInterfaceWorker()
+void ReservoirStreamBatcher::close()
 {
-//    m_dataPort.close();
-    m_parametersPort.close();
-    m_controlPort.close();
-    m_resultsPort.close();
+    QMutexLocker l_locker(&m_lock);
+    m_closed = true;
+    m_requestAvailable.wakeAll();
 }
 
-void YarpInterfaceWorker::doLoop()
+void ReservoirStreamBatcher::run()
 {
-    bool l_doLoop = m_doLoop;
-    yarp::os::Bottle *l_parametersBottle = NULL;
-    yarp::os::Bottle *l_dataBottle = NULL;
-    yarp::os::Bottle *l_controlBottle = NULL;
+    QVector<StreamRequest> l_requests;
+    while(takeRequests(l_requests))
+    {
+        processRequests(l_requests);
+    }
+}
+
+bool ReservoirStreamBatcher::takeRequests(QVector<StreamRequest> &requests)
+{
+    QMutexLocker l_locker(&m_lock);
+
+    while(m_pending.size() == 0 && !m_closed)
+    {
+        m_requestAvailable.wait(&m_lock);
+    }
 
-    while(l_doLoop)
+    if(m_pending.size() == 0)
     {
-        // manage events
-        QTime l_dieTime = QTime::currentTime().addMSecs(10);
-        while( QTime::currentTime() < l_dieTime)
+        return false;
+    }
+
+    // wait for the next requests until the end of the window or until a batch is full
+        QTime l_timer;
+        l_timer.start();
+        while(!m_closed && m_pending.size() < m_maxBatchSize)
         {
-            QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+            int l_remaining = m_windowMs - l_timer.elapsed();
+            if(l_remaining <= 0)
+            {
+                break;
+            }
+            m_requestAvailable.wait(&m_lock, static_cast<unsigned long>(l_remaining));
         }
 
-        // check if reservoir is busy
-        m_reservoirLock.lockForRead();
-            bool l_reservoirIsRunning = m_reservoirIsRunning;
-        m_reservoirLock.unlock();
+    requests = m_pending;
+    m_pending.clear();
+    return true;
+}
 
-        if(!l_reservoirIsRunning)
-        {                
-            // check parameter port
-            l_parametersBottle = m_parametersPort.read(false);
-            if(l_parametersBottle)
+void ReservoirStreamBatcher::processRequests(const QVector<StreamRequest> &requests)
+{
+    for(int ii = 0; ii < requests.size(); ++ii)
+    {
+        const StreamRequest &l_request = requests[ii];
+
+        if(l_request.m_command == "step")
+        {
+            ReservoirSession *l_session = m_sessions.value(l_request.m_sessionId, NULL);
+            if(!l_session)
             {
-                readParameters(l_parametersBottle);
+                sendError(l_request.m_sessionId, "Unknown session.");
+                continue;
             }
-            // check control port
-            l_controlBottle = m_controlPort.read(false);
-            if(l_controlBottle)
+
+            if(static_cast<int>(l_request.m_input.size()) != l_session->inputDimension())
             {
-                m_startReservoir        =                       (l_controlBottle->get(0).asInt()==1); // 0 -> START RESERVOIR (int) (if 1 start, else do nothing)
-                m_pathTrainingToBeSaved = QString::fromStdString(l_controlBottle->get(1).asString()); // 1 -> directory of the training to be saved (string) (if "", no saving is perfomed)
-                m_pathWToBeSaved        = QString::fromStdString(l_controlBottle->get(2).asString()); // 2 -> directory of the matrice W to be saved (string) (if "", no saving is perfomed)
-                m_pathWInToBeSaved      = QString::fromStdString(l_controlBottle->get(3).asString()); // 3 -> directory of the matrice WIn to be saved (string) (if "", no saving is perfomed)
+                sendError(l_request.m_sessionId, "Input size " + QString::number(l_request.m_input.size()) + " instead of " +
+                          QString::number(l_session->inputDimension()) + ".");
+                continue;
             }
 
-            if(m_startReservoir && m_isParameters && !l_reservoirIsRunning)
+            // a session can't do two steps in the same batch
+                if(std::find(m_stepSessions.begin(), m_stepSessions.end(), l_session) != m_stepSessions.end() ||
+                   static_cast<int>(m_steps.size()) == m_maxBatchSize)
+                {
+                    flushSteps();
+                }
+
+            m_stepSessions.push_back(l_session);
+            m_steps.push_back(&l_request);
+            continue;
+        }
+
+        // the other commands are executed after the accumulated steps
+            flushSteps();
+
+        yarp::os::Bottle l_answer;
+        if(l_request.m_command == "open")
+        {
+            QString l_error = openSession(l_request.m_sessionId, l_request.m_training);
+            if(l_error.size() > 0)
+            {
+                sendError(l_request.m_sessionId, l_error);
+                continue;
+            }
+
+            l_answer.addString("opened");
+            l_answer.addString(l_request.m_sessionId.toStdString());
+            l_answer.addInt(m_sessions[l_request.m_sessionId]->inputDimension());     // 2 -> input dimension (int)
+            l_answer.addInt(m_sessions[l_request.m_sessionId]->outputDimension());    // 3 -> output dimension (int)
+        }
+        else if(l_request.m_command == "reset" || l_request.m_command == "close")
+        {
+            if(!m_sessions.contains(l_request.m_sessionId))
+            {
+                sendError(l_request.m_sessionId, "Unknown session.");
+                continue;
+            }
+
+            if(l_request.m_command == "reset")
+            {
+                m_sessions[l_request.m_sessionId]->reset();
+            }
+            else
+            {
+                delete m_sessions.take(l_request.m_sessionId);
+            }
+
+            l_answer.addString(l_request.m_command == "reset" ? "reset" : "closed");
+            l_answer.addString(l_request.m_sessionId.toStdString());
+        }
+        else
+        {
+            sendError(l_request.m_sessionId, "Unknown stream command " + l_request.m_command + ".");
+            continue;
+        }
+
+        yarp::os::Bottle &l_answerBottle = m_outputPort->prepare();
+        l_answerBottle = l_answer;
+        m_outputPort->writeStrict();
+    }
+
+    flushSteps();
+}
+
+void ReservoirStreamBatcher::flushSteps()
+{
+    int l_stepsNumber = static_cast<int>(m_steps.size());
+    if(l_stepsNumber == 0)
+    {
+        return;
+    }
+
+    if(static_cast<int>(m_outputs.size()) < l_stepsNumber)
+    {
+        m_outputs.resize(l_stepsNumber);
+    }
+
+    // group the steps by training, each group is computed with one product per matrix
+        std::vector<bool> l_done(l_stepsNumber, false);
+        std::vector<ReservoirSession*> l_sessions;
+        std::vector<const float*> l_inputs;
+        std::vector<float*> l_outputs;
+
+        for(int ii = 0; ii < l_stepsNumber; ++ii)
+        {
+            if(l_done[ii])
+            {
+                continue;
+            }
+
+            l_sessions.clear();
+            l_inputs.clear();
+            l_outputs.clear();
+
+            for(int jj = ii; jj < l_stepsNumber; ++jj)
+            {
+                if(!l_done[jj] && m_stepSessions[jj]->sharesTraining(*m_stepSessions[ii]))
+                {
+                    l_done[jj] = true;
+                    m_outputs[jj].resize(m_stepSessions[jj]->outputDimension());
+
+                    l_sessions.push_back(m_stepSessions[jj]);
+                    l_inputs.push_back(m_steps[jj]->m_input.size() > 0 ? &m_steps[jj]->m_input[0] : NULL);
+                    l_outputs.push_back(m_outputs[jj].size() > 0 ? &m_outputs[jj][0] : NULL);
+                }
+            }
+
+            if(l_sessions.size() == 1)
+            {
+                l_sessions[0]->step(l_inputs[0], l_outputs[0]);
+            }
+            else
             {
-                emit sendDataToReservoirSignal(m_actionToDo, m_currentModelParameters, m_CCWSentence, m_structureSentence,
-                                               m_pathTrainingToBeSaved, m_pathWToBeSaved, m_pathTrainingToBeSaved, m_pathTrainingToBeLoaded, m_pathWToBeLoaded, m_pathTrainingToBeLoaded);
-                m_startReservoir = false;
+                m_batch.step(l_sessions, l_inputs, l_outputs);
             }
         }
 
-        // check results
-        // ...
+    // scatter the readouts, in the order of arrival
+        for(int ii = 0; ii < l_stepsNumber; ++ii)
+        {
+            yarp::os::Bottle &l_outputBottle = m_outputPort->prepare();
+            l_outputBottle.clear();
+            l_outputBottle.addString("output");                                 // 0 -> "output"
+            l_outputBottle.addString(m_steps[ii]->m_sessionId.toStdString());   // 1 -> session id (string)
+            for(int jj = 0; jj < static_cast<int>(m_outputs[ii].size()); ++jj)
+            {
+                l_outputBottle.addDouble(m_outputs[ii][jj]);                    // 2.. -> readout values (double)
+            }
+            m_outputPort->writeStrict();
+        }
+
+    m_stepSessions.clear();
+    m_steps.clear();
+}
+
+QString ReservoirStreamBatcher::openSession(const QString &sessionId, const QString &training)
+{
+    ResidentTraining l_training;
+    if(!m_registry->acquire(training, l_training))
+    {
+        return "Can not load the training " + training + ".";
+    }
+
+    // leak rate : 5th value of param.txt
+        if(l_training.m_parameters.size() < 5)
+        {
+            return "No leak rate in the parameters of the training " + training + ".";
+        }
+
+    ReservoirSession *l_session = new ReservoirSession(l_training.m_w, l_training.m_wIn, l_training.m_wOut, l_training.m_parameters[4].toFloat());
+    if(!l_session->isValid())
+    {
+        delete l_session;
+        return "Invalid matrices in the training " + training + ".";
+    }
+
+    // replace an existing session with the same id
+        delete m_sessions.value(sessionId, NULL);
+        m_sessions[sessionId] = l_session;
+
+    return "";
+}
+
+void ReservoirStreamBatcher::sendError(const QString &sessionId, const QString &message)
+{
+    std::cerr << "-ERROR : ReservoirStreamBatcher -> " << message.toStdString() << " " << std::endl;
+
+    yarp::os::Bottle &l_errorBottle = m_outputPort->prepare();
+    l_errorBottle.clear();
+    l_errorBottle.addString("error");                                           // 0 -> "error"
+    l_errorBottle.addString(message.toStdString());                             // 1 -> message (string)
+    l_errorBottle.addString(sessionId.toStdString());                           // 2 -> session id (string)
+    m_outputPort->writeStrict();
+}
+
+
+YarpWorkerInputPort::YarpWorkerInputPort(YarpInterfaceWorker *worker, const PortType type) : m_worker(worker), m_type(type)
+{}
+
+void YarpWorkerInputPort::onRead(yarp::os::Bottle &bottle)
+{
+    if(m_type == PARAMETERS)
+    {
+        m_worker->receiveParameters(bottle);
+    }
+    else if(m_type == CONTROL)
+    {
+        m_worker->receiveControl(bottle);
+    }
+    else
+    {
+        m_worker->receiveStream(bottle);
+    }
+}
+
+
+YarpInterfaceWorker::YarpInterfaceWorker(QString absolutePath, ReservoirJobQueue *jobQueue, TrainingRegistry *registry, cint batchWindowMs, cint maxBatchSize) :
+    m_absolutePath(absolutePath), m_jobsCounter(0), m_jobQueue(jobQueue), m_registry(registry),
+    m_controlPort(this, YarpWorkerInputPort::CONTROL), m_parametersPort(this, YarpWorkerInputPort::PARAMETERS), m_streamPort(this, YarpWorkerInputPort::STREAM),
+    m_streamBatcher(registry, &m_streamOutPort, batchWindowMs, maxBatchSize)
+{
+     // init yarp ports
+    m_parametersPort.open("/reservoir/parameters/in");
+    m_controlPort.open("/reservoir/control/in");
+    m_resultsPort.open("/reservoir/results/out");
+    m_streamPort.open("/reservoir/stream/in");
+    m_streamOutPort.open("/reservoir/stream/out");
+}
+
+YarpInterfaceWorker::~YarpInterfaceWorker()
+{
+    stopListening();
+    m_resultsPort.close();
+    m_streamOutPort.close();
+}
+
+void YarpInterfaceWorker::startListening()
+{
+    m_streamBatcher.start();
+
+    m_parametersPort.useCallback();
+    m_controlPort.useCallback();
+    m_streamPort.useCallback();
+}
+
+void YarpInterfaceWorker::stopListening()
+{
+    m_parametersPort.disableCallback();
+    m_controlPort.disableCallback();
+    m_streamPort.disableCallback();
+
+    m_parametersPort.interrupt();
+    m_controlPort.interrupt();
+    m_streamPort.interrupt();
+
+    m_parametersPort.close();
+    m_controlPort.close();
+    m_streamPort.close();
+
+    // the stream requests already received are executed
+        m_streamBatcher.close();
+        m_streamBatcher.wait();
+}
+
+void YarpInterfaceWorker::receiveParameters(yarp::os::Bottle &parametersBottle)
+{
+    ReservoirJob l_job;
+    readParameters(&parametersBottle, l_job);
+
+    QMutexLocker l_locker(&m_requestLock);
+    m_pendingJobs[l_job.m_id] = l_job;
+    QStringList l_evicted;
+    useRequestId(l_job.m_id, l_evicted);
+
+    // the parameters and the controls are read by two different threads, the controls received before their parameters are executed now
+        QList<yarp::os::Bottle> l_earlyControls = m_earlyControls.take(l_job.m_id);
+        l_locker.unlock();
+
+        sendEvicted(l_evicted);
+        for(int ii = 0; ii < l_earlyControls.size(); ++ii)
+        {
+            receiveControl(l_earlyControls[ii]);
+        }
+}
+
+bool YarpInterfaceWorker::keepEarlyControl(const QString &jobId, const yarp::os::Bottle &controlBottle, QStringList &evicted)
+{
+    QList<yarp::os::Bottle> &l_controls = m_earlyControls[jobId];
+    if(l_controls.size() >= g_maxEarlyControls)
+    {
+        return false;
+    }
+
+    l_controls.push_back(controlBottle);
+    useRequestId(jobId, evicted);
+    return true;
+}
 
+void YarpInterfaceWorker::useRequestId(const QString &jobId, QStringList &evicted)
+{
+    m_requestIds.removeOne(jobId);
+    m_requestIds.push_back(jobId);
+
+    // the least recently used ids are dropped
+        while(m_requestIds.size() > g_maxRequestIds)
+        {
+            QString l_id = m_requestIds.takeFirst();
+            m_pendingJobs.remove(l_id);
+            m_earlyControls.remove(l_id);
+            evicted << l_id;
+        }
+}
 
-        // check if must leave the loop
-        m_loopLock.lockForRead();
-            l_doLoop = m_doLoop;
-        m_loopLock.unlock();
+void YarpInterfaceWorker::sendEvicted(const QStringList &evicted)
+{
+    for(int ii = 0; ii < evicted.size(); ++ii)
+    {
+        sendError(evicted[ii], "Job id dropped : too many job ids are waiting, its parameters must be sent again.");
     }
 }
 
-void YarpInterfaceWorker::stopLoop()
+void YarpInterfaceWorker::receiveControl(yarp::os::Bottle &controlBottle)
 {
-    m_loopLock.lockForWrite();
-        m_doLoop = false;
-    m_loopLock.unlock();
+    if(controlBottle.get(0).isString())                                                 // 0 -> COMMAND (string) : "load" / "unload" / "list" / "grid" / "cancel"
+    {
+        std::string l_command = controlBottle.get(0).asString();
+        if(l_command == "grid")
+        {
+            submitGrid(controlBottle);
+        }
+        else if(l_command == "cancel")
+        {
+            cancelJobs(controlBottle);
+        }
+        else
+        {
+            registryCommand(controlBottle);
+        }
+        return;
+    }
+
+    if(controlBottle.get(0).asInt() != 1)                                               // 0 -> START RESERVOIR (int) (if 1 start, else do nothing)
+    {
+        return;
+    }
+
+    QString l_clientJobId = controlBottle.size() > 4 ? QString::fromStdString(controlBottle.get(4).asString()) : QString(""); // 4 -> JOB ID (string) (optional, must be the same as the parameters one)
+
+    QMutexLocker l_locker(&m_requestLock);
+
+    QStringList l_evicted;
+    if(!m_pendingJobs.contains(l_clientJobId))
+    {
+        bool l_kept = keepEarlyControl(l_clientJobId, controlBottle, l_evicted);
+        l_locker.unlock();
+
+        sendEvicted(l_evicted);
+        if(!l_kept)
+        {
+            sendError(l_clientJobId, "No parameters received for this job id.");
+        }
+        return;
+    }
+    useRequestId(l_clientJobId, l_evicted);
+
+    // the parameters are kept for the next control bottles of the same client
+        ReservoirJob l_job = m_pendingJobs[l_clientJobId];
+        l_job.m_number                = m_jobsCounter++;
+        l_job.m_id                    = l_clientJobId.size() > 0 ? l_clientJobId : QString::number(l_job.m_number);
+        l_job.m_pathTrainingToBeSaved = QString::fromStdString(controlBottle.get(1).asString()); // 1 -> directory of the training to be saved (string) (if "", no saving is perfomed)
+        l_job.m_pathWToBeSaved        = QString::fromStdString(controlBottle.get(2).asString()); // 2 -> directory of the matrice W to be saved (string) (if "", no saving is perfomed)
+        l_job.m_pathWInToBeSaved      = QString::fromStdString(controlBottle.get(3).asString()); // 3 -> directory of the matrice WIn to be saved (string) (if "", no saving is perfomed)
+
+    l_locker.unlock();
+
+    sendEvicted(l_evicted);
+
+    if(!m_jobQueue->push(l_job))
+    {
+        sendError(l_job.m_id, "Jobs queue is full.");
+    }
 }
 
 
-void YarpInterfaceWorker::readParameters(yarp::os::Bottle *parametersBottle)
+void YarpInterfaceWorker::readParameters(yarp::os::Bottle *parametersBottle, ReservoirJob &job)
 {   
-    m_actionToDo        = parametersBottle->get(0).asInt();                             // 0 -> action to do : 0 train / 1 test / 2 the both
-    QString l_corpus    = QString::fromStdString(parametersBottle->get(1).asString());  // 1 -> corpus (string)
+    job.m_actionToDo    = parametersBottle->get(0).asInt();                             // 0 -> action to do : 0 train / 1 test / 2 the both
+    job.m_corpus        = QString::fromStdString(parametersBottle->get(1).asString());  // 1 -> corpus (string)
     QString l_structure = QString::fromStdString(parametersBottle->get(2).asString());  // 2 -> structure (P0 A1 O2 R3) (string)
     QString l_CCW       = QString::fromStdString(parametersBottle->get(3).asString());  // 3 -> CCW (string)
-    m_currentModelParameters.m_nbNeurons         = parametersBottle->get(4).asInt();    // 4 -> NEURONS (int) (if -1 -> default value)
-    m_currentModelParameters.m_leakRate          = parametersBottle->get(5).asDouble(); // 5 -> LEAKRATE (double) (if -1 -> default value)
-    m_currentModelParameters.m_inputScaling      = parametersBottle->get(6).asDouble(); // 6 -> INPUT SCALING (double) (if -1 -> default value)
-    m_currentModelParameters.m_spectralRadius    = parametersBottle->get(7).asDouble(); // 7 -> SPECTRAL RADIUS (double) (if -1 -> default value)
-    m_currentModelParameters.m_ridge             = parametersBottle->get(8).asDouble(); // 8 -> RIDGE(double)(if -1 -> default value)
-    m_currentModelParameters.m_sparcity          = parametersBottle->get(9).asDouble(); // 9 -> SPARCITY (double)   (if -1 -> automatic recommanded value )
-    bool l_useCuda                               = (parametersBottle->get(10).asInt()==1);  // 10 -> USE CUDA (int) (1 -> true / else false)
-    m_currentModelParameters.m_useCudaInv        = l_useCuda;
-    m_currentModelParameters.m_useCudaMult       = l_useCuda;
-    m_pathTrainingToBeLoaded                     = QString::fromStdString(parametersBottle->get(11).asString());  // 11-> directory path of the training file to be used (string) (if "", no training file will be used)
-    m_pathWToBeLoaded                            = QString::fromStdString(parametersBottle->get(12).asString());  // 12-> directory path of the W matrice file to be used (string) (if "", no W matrice file will be used)
-    m_pathWInToBeLoaded                          = QString::fromStdString(parametersBottle->get(13).asString());  // 13-> directory path of the WIn matrice file to be used (string) (if "", no WIn matrice file will be used)
-
-    m_currentModelParameters.m_useLoadedTraining = m_pathTrainingToBeLoaded.size() > 0;
-    m_currentModelParameters.m_useLoadedW        = m_pathWToBeLoaded.size() > 0;
-    m_currentModelParameters.m_useLoadedWIn      = m_pathWInToBeLoaded.size() > 0;
+    job.m_parameters.m_nbNeurons         = parametersBottle->get(4).asInt();    // 4 -> NEURONS (int) (if -1 -> default value)
+    job.m_parameters.m_leakRate          = parametersBottle->get(5).asDouble(); // 5 -> LEAKRATE (double) (if -1 -> default value)
+    job.m_parameters.m_inputScaling      = parametersBottle->get(6).asDouble(); // 6 -> INPUT SCALING (double) (if -1 -> default value)
+    job.m_parameters.m_spectralRadius    = parametersBottle->get(7).asDouble(); // 7 -> SPECTRAL RADIUS (double) (if -1 -> default value)
+    job.m_parameters.m_ridge             = parametersBottle->get(8).asDouble(); // 8 -> RIDGE(double)(if -1 -> default value)
+    job.m_parameters.m_sparcity          = parametersBottle->get(9).asDouble(); // 9 -> SPARCITY (double)   (if -1 -> automatic recommanded value )
+    bool l_useCuda                       = (parametersBottle->get(10).asInt()==1);  // 10 -> USE CUDA (int) (1 -> true / else false)
+    job.m_parameters.m_useCudaInv        = l_useCuda;
+    job.m_parameters.m_useCudaMult       = l_useCuda;
+    job.m_pathTrainingToBeLoaded         = QString::fromStdString(parametersBottle->get(11).asString());  // 11-> directory path of the training file to be used (string) (if "", no training file will be used)
+    job.m_pathWToBeLoaded                = QString::fromStdString(parametersBottle->get(12).asString());  // 12-> directory path of the W matrice file to be used (string) (if "", no W matrice file will be used)
+    job.m_pathWInToBeLoaded              = QString::fromStdString(parametersBottle->get(13).asString());  // 13-> directory path of the WIn matrice file to be used (string) (if "", no WIn matrice file will be used)
+    job.m_id                             = parametersBottle->size() > 14 ? QString::fromStdString(parametersBottle->get(14).asString()) : QString(""); // 14-> JOB ID (string) (optional, "" for a single client)
+    job.m_binaryResults                  = parametersBottle->size() > 15 && parametersBottle->get(15).asInt() == 1; // 15-> RESULTS FORMAT (int) (optional, 1 -> binary / else strings)
+    // 16-> SEQUENCE TAIL (int) (ignored, the sentences are always trained and tested on their padded length)
+    job.m_cpuBackend                     = parametersBottle->size() > 17 && parametersBottle->get(17).asInt() == 0 ? LinearAlgebraBackend::OPENCV : LinearAlgebraBackend::LAPACK; // 17-> CPU BACKEND (int) (optional, 0 -> OpenCV / else LAPACK)
+    job.m_sketchRank                     = parametersBottle->size() > 18 ? parametersBottle->get(18).asInt() : 0; // 18-> SKETCH RANK (int) (optional, rank of the randomized readout, 0 -> exact readout)
+    job.m_solverIterations               = parametersBottle->size() > 19 ? parametersBottle->get(19).asInt() : 0; // 19-> SOLVER ITERATIONS (int) (optional, maximum iterations of the conjugate gradient readout, 0 -> closed-form readout)
+    job.m_streamChunkSize                = parametersBottle->size() > 20 ? parametersBottle->get(20).asInt() : 0; // 20-> STREAM CHUNK SIZE (int) (optional, sentences per chunk of a mini-batch Adam training, 0 -> closed-form training on the whole corpus)
+    job.m_streamEpochs                   = parametersBottle->size() > 21 ? parametersBottle->get(21).asInt() : 1; // 21-> STREAM EPOCHS (int) (optional)
+    job.m_streamLearningRate             = parametersBottle->size() > 22 ? parametersBottle->get(22).asDouble() : 1e-3; // 22-> STREAM LEARNING RATE (double) (optional)
+
+    job.m_parameters.m_useLoadedTraining = job.m_pathTrainingToBeLoaded.size() > 0;
+    job.m_parameters.m_useLoadedW        = job.m_pathWToBeLoaded.size() > 0;
+    job.m_parameters.m_useLoadedWIn      = job.m_pathWInToBeLoaded.size() > 0;
 
     // transform strings
-    QFile l_fileCorpus(m_absolutePath + "../data/input/Corpus/received.txt");
-    if(l_fileCorpus.open(QIODevice::WriteOnly | QIODevice::Text))
-    {
-        QTextStream in(&l_fileCorpus);
-        in << l_corpus;
-        m_currentModelParameters.m_corpusFilePath = (m_absolutePath + "../data/input/Corpus/received.txt").toStdString();
-    }
-
     QStringList l_CCWList = l_CCW.split(" ");
     QStringList l_structureList = l_structure.split(" ");
 
+    job.m_CCW.clear();
+    job.m_structure.clear();
+
     for(QStringList::iterator ii = l_CCWList.begin(); ii != l_CCWList.end(); ++ii)
     {
-        m_CCWSentence.push_back((*ii).toStdString());
+        job.m_CCW.push_back((*ii).toStdString());
     }
     for(QStringList::iterator ii = l_structureList.begin(); ii != l_structureList.end(); ++ii)
     {
-        m_structureSentence.push_back((*ii).toStdString());
+        job.m_structure.push_back((*ii).toStdString());
+    }
+}
+
+void YarpInterfaceWorker::registryCommand(yarp::os::Bottle &controlBottle)
+{
+    QString l_command = QString::fromStdString(controlBottle.get(0).asString());
+    QString l_name    = QString::fromStdString(controlBottle.get(1).asString());   // 1 -> name of the training (string)
+    QString l_status;
+
+    if(l_command == "load")
+    {
+        QString l_path = QString::fromStdString(controlBottle.get(2).asString()); // 2 -> training directory (string) (if "", the name is used as directory)
+        l_status = m_registry->load(l_name, l_path.size() > 0 ? l_path : l_name) ? "loaded" : "error";
+    }
+    else if(l_command == "unload")
+    {
+        l_status = m_registry->unload(l_name) ? "unloaded" : "error";
+    }
+    else if(l_command == "list")
+    {
+        l_status = "list";
+    }
+    else
+    {
+        sendError("", "Unknown registry command " + l_command + ".");
+        return;
     }
 
-    m_isParameters = true;
+    QStringList l_names = m_registry->names();
+
+    QMutexLocker l_locker(&m_resultsLock);
+
+    yarp::os::Bottle &l_registryBottle = m_resultsPort.prepare();
+    l_registryBottle.clear();
+    l_registryBottle.addString("registry");                                     // 0 -> "registry"
+    l_registryBottle.addString(l_status.toStdString());                         // 1 -> status : loaded / unloaded / list / error
+    l_registryBottle.addString(l_name.toStdString());                           // 2 -> name of the training (string)
+    l_registryBottle.addString(l_names.join(" ").toStdString());                // 3 -> resident trainings (string)
+    l_registryBottle.addInt(static_cast<int>(m_registry->usedMemory() / (1024*1024))); // 4 -> memory used by the resident trainings in MB (int)
+    m_resultsPort.writeStrict();
 }
 
-void YarpInterfaceWorker::updateResultsFromReservoir(QVector<std::vector<double> > resultsTrain, QVector<std::vector<double> > resultsTest, Sentences trainSentences, Sentences trainResults, Sentences testResults)
+void YarpInterfaceWorker::submitGrid(yarp::os::Bottle &controlBottle)
 {
-    QString l_trainSentences, l_trainResults, l_testResults;
-    for(int ii = 0; ii < trainSentences.size(); ++ii)
+    QString l_gridId = QString::fromStdString(controlBottle.get(1).asString());        // 1 -> grid id (string)
+
+    // values of each parameter, the parameters not in the grid keep the values of the parameters bottle
+        QStringList l_names;
+        l_names << "neurons" << "leakRate" << "inputScaling" << "spectralRadius" << "ridge" << "sparcity";
+        QVector<std::vector<double> > l_values(l_names.size());
+
+        for(int ii = 2; ii < controlBottle.size(); ++ii)                                // 2.. -> (parameter start end operation [onlyStart]) (list)
+        {
+            yarp::os::Bottle *l_range = controlBottle.get(ii).asList();
+            int l_id = l_range ? l_names.indexOf(QString::fromStdString(l_range->get(0).asString())) : -1;
+            if(l_id < 0)
+            {
+                sendError(l_gridId, "Invalid grid parameter " + QString::number(ii) + ".");
+                return;
+            }
+
+            if(!GridSearch::rangeValues(l_range->get(1).asDouble(), l_range->get(2).asDouble(), l_range->get(3).asString(), l_range->get(4).asInt() == 1, l_values[l_id]))
+            {
+                sendError(l_gridId, "Bad operation for the grid parameter " + l_names[l_id] + ".");
+                return;
+            }
+        }
+
+    QMutexLocker l_locker(&m_requestLock);
+
+    QStringList l_evicted;
+    if(!m_pendingJobs.contains(l_gridId))
+    {
+        bool l_kept = keepEarlyControl(l_gridId, controlBottle, l_evicted);
+        l_locker.unlock();
+
+        sendEvicted(l_evicted);
+        if(!l_kept)
+        {
+            sendError(l_gridId, "No parameters received for this grid id.");
+        }
+        return;
+    }
+    useRequestId(l_gridId, l_evicted);
+
+    ReservoirJob l_baseJob = m_pendingJobs[l_gridId];
+    for(int ii = 0; ii < l_values.size(); ++ii)
     {
-        for(int jj = 0; jj < trainSentences[0].size(); ++jj)
+        if(l_values[ii].size() == 0)
+        {
+            double l_base[] = {static_cast<double>(l_baseJob.m_parameters.m_nbNeurons), l_baseJob.m_parameters.m_leakRate, l_baseJob.m_parameters.m_inputScaling,
+                               l_baseJob.m_parameters.m_spectralRadius, l_baseJob.m_parameters.m_ridge, l_baseJob.m_parameters.m_sparcity};
+            l_values[ii].push_back(l_base[ii]);
+        }
+    }
+
+    // cartesian product of the values, each point is a job
+        qint64 l_pointsNumber = 1;
+        for(int ii = 0; ii < l_values.size(); ++ii)
         {
-            l_trainSentences += QString::fromStdString(trainSentences[ii][jj]) + " ";
-            l_trainResults   += QString::fromStdString(trainResults[ii][jj]) + " ";
+            l_pointsNumber *= static_cast<qint64>(l_values[ii].size());
+            if(l_pointsNumber > 100000)
+            {
+                l_locker.unlock();
+                sendEvicted(l_evicted);
+                sendError(l_gridId, "Too many points in the grid.");
+                return;
+            }
+        }
+
+        QVector<ReservoirJob> l_jobs;
+        l_jobs.reserve(static_cast<int>(l_pointsNumber));
+        yarp::os::Bottle l_points;
+        for(int ii = 0; ii < static_cast<int>(l_pointsNumber); ++ii)
+        {
+            double l_point[6];
+            qint64 l_index = ii;
+            for(int jj = l_values.size() - 1; jj >= 0; --jj)
+            {
+                int l_size = static_cast<int>(l_values[jj].size());
+                l_point[jj] = l_values[jj][l_index % l_size];
+                l_index /= l_size;
+            }
+
+            ReservoirJob l_job = l_baseJob;
+            l_job.m_id     = l_gridId + "/" + QString::number(ii);
+            l_job.m_number = m_jobsCounter++;
+            l_job.m_parameters.m_nbNeurons      = static_cast<int>(l_point[0]);
+            l_job.m_parameters.m_leakRate       = l_point[1];
+            l_job.m_parameters.m_inputScaling   = l_point[2];
+            l_job.m_parameters.m_spectralRadius = l_point[3];
+            l_job.m_parameters.m_ridge          = l_point[4];
+            l_job.m_parameters.m_sparcity       = l_point[5];
+            l_jobs.push_back(l_job);
+
+            yarp::os::Bottle &l_pointBottle = l_points.addList();
+            l_pointBottle.addInt(l_job.m_parameters.m_nbNeurons);
+            for(int jj = 1; jj < 6; ++jj)
+            {
+                l_pointBottle.addDouble(l_point[jj]);
+            }
         }
 
-        l_trainSentences += "\n";
-        l_trainResults += "\n";
+    l_locker.unlock();
+
+    sendEvicted(l_evicted);
+    if(!m_jobQueue->pushAll(l_jobs))
+    {
+        sendError(l_gridId, "Jobs queue is full.");
+        return;
+    }
+
+    QMutexLocker l_resultsLocker(&m_resultsLock);
+
+    yarp::os::Bottle &l_gridBottle = m_resultsPort.prepare();
+    l_gridBottle.clear();
+    l_gridBottle.addString("grid");                                             // 0 -> "grid"
+    l_gridBottle.addString("submitted");                                        // 1 -> status
+    l_gridBottle.addInt(static_cast<int>(l_pointsNumber));                                        // 2 -> number of points, the results of the point ii have the job id gridId/ii
+    l_gridBottle.addList() = l_points;                                          // 3 -> (neurons leakRate inputScaling spectralRadius ridge sparcity) of each point (list)
+    l_gridBottle.addString(l_gridId.toStdString());                             // 4 -> grid id (string)
+    m_resultsPort.writeStrict();
+}
+
+void YarpInterfaceWorker::cancelJobs(yarp::os::Bottle &controlBottle)
+{
+    QString l_id = QString::fromStdString(controlBottle.get(1).asString());            // 1 -> job id or grid id (string)
+
+    int l_removed = m_jobQueue->remove(l_id);
+
+    // the controls still waiting for their parameters are dropped
+    {
+        QMutexLocker l_requestLocker(&m_requestLock);
+        l_removed += m_earlyControls.take(l_id).size();
+        if(!m_pendingJobs.contains(l_id))
+        {
+            m_requestIds.removeOne(l_id);
+        }
     }
 
-    for(int ii = 0; ii < testResults.size(); ++ii)
+    int l_stopped = 0;
+    for(int ii = 0; ii < m_jobWorkers.size(); ++ii)
     {
-        for(int jj = 0; jj < testResults[0].size(); ++jj)
+        if(m_jobWorkers[ii]->cancel(l_id))
         {
-            l_testResults += QString::fromStdString(testResults[ii][jj]) + " ";
+            ++l_stopped;
         }
+    }
+
+    QMutexLocker l_resultsLocker(&m_resultsLock);
+
+    yarp::os::Bottle &l_cancelBottle = m_resultsPort.prepare();
+    l_cancelBottle.clear();
+    l_cancelBottle.addString("cancel");                                         // 0 -> "cancel"
+    l_cancelBottle.addInt(l_removed);                                           // 1 -> number of waiting jobs removed
+    l_cancelBottle.addInt(l_stopped);                                           // 2 -> number of running jobs stopped
+    l_cancelBottle.addString(l_id.toStdString());                               // 3 -> job id or grid id (string)
+    m_resultsPort.writeStrict();
+}
+
+void YarpInterfaceWorker::setJobWorkers(const QVector<ReservoirJobWorker*> &workers)
+{
+    m_jobWorkers = workers;
+}
 
-        l_testResults += "\n";
+void YarpInterfaceWorker::receiveStream(yarp::os::Bottle &streamBottle)
+{
+    StreamRequest l_request;
+    l_request.m_command   = QString::fromStdString(streamBottle.get(0).asString());    // 0 -> command (string)
+    l_request.m_sessionId = QString::fromStdString(streamBottle.get(1).asString());    // 1 -> session id (string)
+
+    if(l_request.m_command == "open")
+    {
+        l_request.m_training = QString::fromStdString(streamBottle.get(2).asString()); // 2 -> name or directory of the training (string)
+    }
+    else if(l_request.m_command == "step")
+    {
+        l_request.m_input.resize(std::max(0, streamBottle.size() - 2));
+        for(int ii = 0; ii < static_cast<int>(l_request.m_input.size()); ++ii)
+        {
+            l_request.m_input[ii] = static_cast<float>(streamBottle.get(ii + 2).asDouble()); // 2.. -> input values (double)
+        }
     }
 
+    m_streamBatcher.push(l_request);
+}
+
+void YarpInterfaceWorker::sendError(const QString &jobId, const QString &message)
+{
+    std::cerr << "-ERROR : job " << jobId.toStdString() << " -> " << message.toStdString() << std::endl;
+
+    QMutexLocker l_locker(&m_resultsLock);
+
+    yarp::os::Bottle &l_errorBottle = m_resultsPort.prepare();
+    l_errorBottle.clear();
+    l_errorBottle.addString("error");                   // 0 -> "error"
+    l_errorBottle.addString(message.toStdString());     // 1 -> message (string)
+    l_errorBottle.addString(jobId.toStdString());       // 2 -> job id (string)
+    m_resultsPort.writeStrict();
+}
+
+void YarpInterfaceWorker::sendResults(const QString &jobId, cbool binary, const QVector<std::vector<double> > &resultsTrain, const QVector<std::vector<double> > &resultsTest,
+                                      const Model &model)
+{
     std::vector<double> l_trainCCWContinuous, l_trainAllContinuous, l_testsCCWContinuous, l_testsAllContinuous;
-    if(resultsTrain.size() > 0)
+    if(resultsTrain.size() > 1)
     {
         l_trainCCWContinuous = resultsTrain[0];
         l_trainAllContinuous = resultsTrain[1];
     }
-    if(resultsTest.size() > 0)
+    if(resultsTest.size() > 1)
     {
         l_testsCCWContinuous = resultsTest[0];
         l_testsAllContinuous = resultsTest[1];
     }
-    QString l_trainCCWContinuousString, l_trainAllContinuousString, l_testsCCWContinuousString, l_testsAllContinuousString;
-    for(int ii = 0; ii < l_trainCCWContinuous.size(); ++ii)
+
+    yarp::os::Bottle l_results;
+
+    if(binary)
     {
-        l_trainCCWContinuousString += QString::number(l_trainCCWContinuous[ii]) + " ";
-        l_trainAllContinuousString += QString::number(l_trainAllContinuous[ii]) + " ";
+        // words are sent as their id in the vocabulary of the model, the ids of the corpus words are the same for all the jobs of a corpus
+            TokenizedSentences l_trainSentences, l_trainResults, l_testResults;
+            model.tokenizedSentences(l_trainSentences, l_trainResults, l_testResults);
+
+            const Vocabulary &l_words = model.vocabulary();
+            yarp::os::Bottle l_vocabulary;
+            for(int ii = 0; ii < l_words.size(); ++ii)
+            {
+                l_vocabulary.addString(l_words.word(ii));
+            }
+
+            std::vector<qint32> l_trainSentencesIds, l_trainResultsIds, l_testResultsIds;
+            encodeSentences(l_trainSentences, l_trainSentencesIds);
+            encodeSentences(l_trainResults,   l_trainResultsIds);
+            encodeSentences(l_testResults,    l_testResultsIds);
+
+        l_results.addString("binary");                                          // 0 -> "binary"
+        l_results.addList() = l_vocabulary;                                     // 1 -> vocabulary (list of strings), the id of a word is its index
+        addBlob(l_results, l_trainSentencesIds);                                // 2 -> train sentences (int32 blob)
+        addBlob(l_results, l_trainResultsIds);                                  // 3 -> train results (int32 blob)
+        addBlob(l_results, l_testResultsIds);                                   // 4 -> test results (int32 blob)
+        addBlob(l_results, l_trainCCWContinuous);                               // 5 -> train CCW continuous scores (double blob)
+        addBlob(l_results, l_trainAllContinuous);                               // 6 -> train all continuous scores (double blob)
+        addBlob(l_results, l_testsCCWContinuous);                               // 7 -> tests CCW continuous scores (double blob)
+        addBlob(l_results, l_testsAllContinuous);                               // 8 -> tests all continuous scores (double blob)
+        l_results.addString(jobId.toStdString());                               // 9 -> job id (string)
     }
-    for(int ii = 0; ii < l_testsCCWContinuousString.size(); ++ii)
+    else
     {
-        l_testsCCWContinuousString += QString::number(l_testsCCWContinuous[ii]) + " ";
-        l_testsAllContinuousString += QString::number(l_testsAllContinuous[ii]) + " ";
+        Sentences l_trainSentences, l_trainResults, l_testResults;
+        model.sentences(l_trainSentences, l_trainResults, l_testResults);
+
+        l_results.addString(sentencesToString(l_trainSentences));              // 0 -> train sentences (string)
+        l_results.addString(sentencesToString(l_trainResults));                // 1 -> train results (string)
+        l_results.addString(sentencesToString(l_testResults));                 // 2 -> test results (string)
+        l_results.addString(scoresToString(l_trainCCWContinuous));             // 3 -> train CCW continuous scores (string)
+        l_results.addString(scoresToString(l_trainAllContinuous));             // 4 -> train all continuous scores (string)
+        l_results.addString(scoresToString(l_testsCCWContinuous));             // 5 -> tests CCW continuous scores (string)
+        l_results.addString(scoresToString(l_testsAllContinuous));             // 6 -> tests all continuous scores (string)
+        l_results.addString(jobId.toStdString());                              // 7 -> job id (string)
     }
 
+    QMutexLocker l_locker(&m_resultsLock);
+
     yarp::os::Bottle &l_resultsBottle = m_resultsPort.prepare();
-    l_resultsBottle.addString(l_trainSentences.toStdString());
-    l_resultsBottle.addString(l_trainResults.toStdString());
-    l_resultsBottle.addString(l_testResults.toStdString());
-    l_resultsBottle.addString(l_trainCCWContinuousString.toStdString());
-    l_resultsBottle.addString(l_trainAllContinuousString.toStdString());
-    l_resultsBottle.addString(l_testsCCWContinuousString.toStdString());
-    l_resultsBottle.addString(l_testsAllContinuousString.toStdString());
-
-    m_resultsPort.write();
-
-    m_reservoirLock.lockForWrite();
-        m_reservoirIsRunning = false;
-    m_reservoirLock.unlock();
+    l_resultsBottle = l_results;
+    m_resultsPort.writeStrict();
 }
@@ -35,6 +35,15 @@ def write3DArrays(data, fileToCreate):
                 # Writing out a break to indicate different slices...            
                 slice_nb += 1
 
+def writeStimArrays(data, fileToCreateWithoutExt, fileFormat='txt'):
+    # Write the stimulus array with the format expected by the C++ model :
+    # 'txt' -> text file with slices (write3DArrays), 'npy' -> numpy binary file (float32)
+    if fileFormat == 'npy':
+        if len(data) > 0:
+            np.save(fileToCreateWithoutExt + '.npy', np.asarray(data, dtype=np.float32))
+    else:
+        write3DArrays(data, fileToCreateWithoutExt + '.txt')
+
 ### Extraction Methods ###
 ##########################
 
@@ -482,7 +491,7 @@ def treshold_signal(vect, sup, inf):
 ### Main Methods ###
 ##########################
 #COLAS : function modified in order to give parameters in argument. New reservoir as well. Feedback implemented but it doesn't work for now (see report and readme)
-def main(path_file_in, generate, ccw, sLetters, sValues):
+def main(path_file_in, generate, ccw, sLetters, sValues, fileFormat='txt', outputDir='../data/input/'):
     def write_list_in_file(l, file=None, file_path=None, ccw= None, sLetters= None, sValues = None):
         """
         Write a list in a file with with one item per line (like a one column csv).
@@ -575,8 +584,8 @@ def main(path_file_in, generate, ccw, sLetters, sValues):
     if generate == "train":
         #print "*** Generating meaning for train set ... ***"
         (stim_mean_train, l_meaning_code_train) = generate_meaning_stim(l_structure=sent_form_info_train, full_time=stim_sent_train[0].shape[0], l_m_elt=l_m_elt)
-        write3DArrays(stim_mean_train, '../data/input/stim_mean_train.txt')
-        write3DArrays(stim_sent_train, '../data/input/stim_sent_train.txt')
+        writeStimArrays(stim_mean_train, outputDir + 'stim_mean_train', fileFormat)
+        writeStimArrays(stim_sent_train, outputDir + 'stim_sent_train', fileFormat)
         
     
 
@@ -586,7 +595,7 @@ def main(path_file_in, generate, ccw, sLetters, sValues):
             (stim_mean_test, l_meaning_code_test) = generate_meaning_stim(l_structure=sent_form_info_test, full_time=stim_sent_train[0].shape[0], l_m_elt=l_m_elt)
             #print "*** ... meaning generated for test set ***"
             #print ""
-            write3DArrays(stim_mean_test,  '../data/input/stim_mean_test.txt')        
+            writeStimArrays(stim_mean_test,  outputDir + 'stim_mean_test', fileFormat)        
     
 
 import re
@@ -606,6 +615,14 @@ if __name__ == '__main__':
         structureLetters.append(ii[0])
         structureValues.append(ii[1])
 
-    main(path_file_in= corpusFilePath, generate = sys.argv[2], ccw = ccwSplited, sLetters = structureLetters, sValues = structureValues)
+    fileFormat = 'txt'
+    if len(sys.argv) > 5:
+        fileFormat = sys.argv[5]
+
+    outputDir = '../data/input/'
+    if len(sys.argv) > 6:
+        outputDir = sys.argv[6]
+
+    main(path_file_in= corpusFilePath, generate = sys.argv[2], ccw = ccwSplited, sLetters = structureLetters, sValues = structureValues, fileFormat = fileFormat, outputDir = outputDir)
 
 
@@ -13,6 +13,22 @@ import matplotlib.pyplot
 import pylab as pl
 import mdp
 
+def load_reservoir_array(path_file):
+    """
+    Load an array saved by the C++ reservoir (replay, stimulus, weights...).
+    .npy and .npz files are loaded directly with numpy (a dict of arrays is returned for .npz),
+    the text format ("# d0 d1 d2" header and "# i" line before each slice) is still supported.
+    """
+    import numpy
+    if path_file.endswith('.npy'):
+        return numpy.load(path_file)
+    if path_file.endswith('.npz'):
+        archive = numpy.load(path_file)
+        return dict((name, archive[name]) for name in archive.files)
+    with open(path_file, 'r') as f:
+        shape = [int(v) for v in f.readline().strip('# \r\n').split()]
+    return numpy.loadtxt(path_file, comments='#').reshape(shape)
+
 
 def ___info_on_color_map():
     pass